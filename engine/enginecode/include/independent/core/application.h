@@ -7,6 +7,7 @@
 #include "events/events.h"
 #include "core/window.h"
 #include "core/inputPoller.h"
+#include "rendering/renderThread.h"
 
 namespace Engine {
 
@@ -30,6 +31,7 @@ namespace Engine {
 		std::shared_ptr<Timer> m_timerSeconds; //!< Timer for keeping the time in engine in seconds
 		std::shared_ptr<System> m_windowsSystem; //!< Window system
 		std::shared_ptr<Window> m_window; //!< Window
+		RenderThread m_renderThread; //!< Executes recorded frames with the graphics context, one frame behind the game loop
 
 		bool m_updatedView = false; //!< Bool to check if camera/view was changed
 		bool m_EulerCamera = true; //!< Bool to check which camera is currently on
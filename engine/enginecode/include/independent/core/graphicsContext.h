@@ -9,5 +9,7 @@ namespace Engine {
 	public:
 		virtual void init() = 0; //!< Initialize graphics context for the given window
 		virtual void swapBuffers() = 0; //!< Swap the front and back buffer
+		virtual void makeCurrent() = 0; //!< Make the context current on the calling thread
+		virtual void releaseCurrent() = 0; //!< Detach the context from the calling thread so another thread can make it current
 	};
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+/** \file parallelFor.h */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace Engine {
+	//! Split [0, count) into one contiguous range per thread and run a function on each, the calling thread takes the first range
+	/*!
+	\param count uint32_t - number of items
+	\param threadCount uint32_t - threads to split across, 0 for every core
+	\param function F - called as function(begin, end)
+	*/
+	template<typename F>
+	void parallelFor(uint32_t count, uint32_t threadCount, F&& function) {
+		if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+		uint32_t chunks = std::min(threadCount, count);
+		if (chunks <= 1) {
+			function(0u, count);
+			return;
+		}
+
+		std::vector<std::future<void>> tasks;
+		for (uint32_t c = 1; c < chunks; c++) {
+			tasks.push_back(std::async(std::launch::async, function, count * c / chunks, count * (c + 1) / chunks));
+		}
+		function(0u, count / chunks);
+		for (auto& task : tasks) task.get();
+	}
+}
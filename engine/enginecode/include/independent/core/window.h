@@ -34,7 +34,8 @@ namespace Engine {
 
 		virtual ~Window() {}; //!< Default destructor class
 
-		virtual void onUpdate(float timestep) = 0; //!< Update the window
+		virtual void onUpdate(float timestep) = 0; //!< Update the window, polling events and swapping buffers
+		virtual void pollEvents() = 0; //!< Poll events without swapping, for when the render thread swaps
 		virtual void onResize(unsigned int width, unsigned int height) = 0; //!< Resize the window
 		virtual void setVSync(bool Vsync) = 0; //!< Set Vsync of the window 
 		virtual void setEventCallback(const std::function<void(Event&)>& callback) = 0; //!< set event callback from the window
@@ -48,6 +49,7 @@ namespace Engine {
 		virtual bool isVsync() const = 0; //!< Get window vSync status
 
 		inline EventHandler& getEventHandler() { return m_handler; } //!< Get event handler from the window
+		inline std::shared_ptr<GraphicsContext>& getGraphicsContext() { return m_graphicsContext; } //!< Get the graphics context of the window
 
 		static Window* create(const WindowProperties& properties = WindowProperties()); //!< Create window with properties
 	};
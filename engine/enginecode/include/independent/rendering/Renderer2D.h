@@ -4,9 +4,16 @@
 #include "rendering/RendererCommon.h"
 #include "rendering/subTexture.h"
 #include "rendering/textureAtlas.h"
+#include "rendering/quadBatch.h"
+#include "rendering/radixSort.h"
+#include "rendering/glyphCache.h"
+#include "rendering/renderThread.h"
 #include "ft2build.h"
 #include "freetype/freetype.h"
 
+#include <mutex>
+#include <string>
+
 namespace Engine {
 	/** \class VertexRenderer2D
 	*\brief class to batch 2d rendering objects and text
@@ -24,6 +31,41 @@ namespace Engine {
 		static uint32_t pack(const glm::vec4& tint); //!< Pack the tint
 	};
 
+	/** \class Renderer2DInstance
+	*\brief one sprite for instanced 2D rendering, the corners are expanded in the vertex shader
+	*/
+	class Renderer2DInstance {
+	public:
+		glm::vec2 translate; //!< Centre of the quad
+		glm::vec2 scale; //!< Width and height of the quad
+		uint16_t uvRect[4]; //!< UV start and end, normalised to 16 bits
+		glm::vec2 rotation; //!< Cosine and sine of the rotation
+		uint32_t texUnit; //!< Texture unit
+		uint32_t tint; //!< Packed tint ( Colour / Albedo ) for the quad
+		static VertexBufferLayout layout; //!< Instance buffer layout
+		static void packUVs(const glm::vec2& UVStart, const glm::vec2& UVEnd, uint16_t* uvRect); //!< Pack the UV rectangle
+	};
+
+	/** \enum Renderer2DMode
+	*\brief How Renderer2D sends quads to the GPU
+	*/
+	enum class Renderer2DMode {
+		Batched, //!< Four vertices per quad expanded on the CPU
+		Instanced //!< One instance record per quad expanded in the vertex shader
+	};
+
+	/** \struct Renderer2DProps
+	*\brief properties chosen when initialising Renderer2D
+	\param mode Renderer2DMode - batched vertices or instanced sprites
+	\param deferred bool - hold every submission until end() and sort it by layer, blend class and texture
+	\param sdfText bool - store glyphs as signed distance fields at a small base size so text stays sharp at any scale
+	*/
+	struct Renderer2DProps {
+		Renderer2DMode mode = Renderer2DMode::Batched; //!< How quads are sent to the GPU
+		bool deferred = false; //!< Sort submissions at end() so each set of up to 32 textures is drawn once
+		bool sdfText = false; //!< Distance field glyphs
+	};
+
 	/** \class Quad
 	*\brief class to render 2D quad
 	*/
@@ -32,81 +74,255 @@ namespace Engine {
 		glm::vec3 m_translate = glm::vec3(0.f); //!< Translation vector
 		glm::vec3 m_scale = glm::vec3(1.f); //!< Scale vector
 		friend class Renderer2D; //!< Setting Renderer2D as a friend class to be used by the Quad
+		friend class Renderer2DRecorder; //!< Recorders read the quad when it is submitted
 	public:
 		Quad() = default;
 		static Quad createCentralHalfExtents(const glm::vec2& centre, const glm::vec2& halfExtents); //!< Calculate central half extents of the quad
 	};
 
-	/** \class Renderer2D
-	** \brief Class which allows the rendering of simple 2D primitive
+	/** \class Renderer2DRecorder
+	** \brief Records quads and text on one thread into its own staging buffer, merged into the GPU batches by Renderer2D::end
+	*
+	* Each recorder must only be used by one thread at a time, different recorders can record concurrently.
+	* Nothing touches OpenGL or the TextureUnitManager while recording, textures must stay alive until Renderer2D::end.
+	*
+	* Recorded commands are merged by layer, then recorder creation order, then submission order, so the result does
+	* not depend on thread timing. Without deferred mode Renderer2D::submit draws straight away, so every recorded quad
+	* draws after every direct one whatever the layers. In deferred mode recorded quads are sorted with the direct ones
+	* on their recorded layer, and count as submitted after every direct quad wherever submission order decides.
+	*
+	* A recorder which is not created by Renderer2D::createRecorder is never merged. Its submissions can instead be
+	* copied into a frame packet with snapshot() on the game thread and replayed on the render thread with
+	* Renderer2D::submit, where they are treated like direct submissions made at that point.
 	*/
-	class Renderer2D {
+	class Renderer2DRecorder {
+	public:
+		/** \struct Command
+		*\brief one recorded submission
+		\param quad QuadInstance - the quad, or the position and tint of a line of text
+		\param layer int32_t - layer the submission was made on
+		\param textOffset uint32_t - start of the text in the recorder's text storage
+		\param textLength uint32_t - length of the text, zero for a quad
+		*/
+		struct Command {
+			QuadInstance quad; //!< Quad or text position and tint
+			int32_t layer; //!< Layer, lower layers are drawn first
+			uint32_t textOffset; //!< Start of the text
+			uint32_t textLength; //!< Length of the text, zero for quads
+		};
+
+		/** \struct MergedCommand
+		*\brief a recorded command and the text storage of its recorder
+		\param command const Command* - the command
+		\param text const char* - the recorder's text storage, the command's text starts at its textOffset
+		*/
+		struct MergedCommand {
+			const Command* command; //!< Command
+			const char* text; //!< Text storage
+		};
+
+		//! Gather the commands of recorders in the order Renderer2D draws them
+		/*!
+		\param recorders const std::vector<std::shared_ptr<Renderer2DRecorder>>& - recorders in creation order
+		\param merged std::vector<MergedCommand>& - filled with every command, stably sorted by layer
+		*/
+		static void merge(const std::vector<std::shared_ptr<Renderer2DRecorder>>& recorders, std::vector<MergedCommand>& merged);
+
+		/** \struct Snapshot
+		*\brief recorded commands copied into a frame packet, replayed with Renderer2D::submit
+		\param commands const Command* - commands in submission order
+		\param count uint32_t - number of commands
+		\param text const char* - text storage, each command's text starts at its textOffset
+		*/
+		struct Snapshot {
+			const Command* commands; //!< Commands
+			uint32_t count; //!< Command count
+			const char* text; //!< Text storage
+		};
 	private:
+		std::vector<Command> m_commands; //!< Commands in submission order
+		std::string m_text; //!< Characters of every recorded line of text
+		int32_t m_layer = 0; //!< Layer given to new submissions
+		friend class Renderer2D; //!< Renderer2D merges the commands
+	public:
+		void setLayer(int32_t layer) { m_layer = layer; } //!< Set the layer for the following submissions
+		inline int32_t getLayer() const { return m_layer; } //!< Get the current layer
+		inline uint32_t getCommandCount() const { return static_cast<uint32_t>(m_commands.size()); } //!< Get the number of recorded submissions
 
-		/** \struct GlyphData
-		*\brief properties for the character glyph
-		\param size vec2 - size of the character
-		\param bearing vec2 - bearing of the character glyph
-		\param advance float - offset value for the character
-		\param texture shared_ptr<SubTexture> - texture for the glyph
+		void submit(const Quad& quad, const glm::vec4& tint); //!< Record a tinted quad
+		void submit(const Quad& quad, const std::shared_ptr<SubTexture>& texture); //!< Record a textured quad
+		void submit(const Quad& quad, const glm::vec4& tint, const std::shared_ptr<SubTexture>& texture); //!< Record a textured and tinted quad
+		void submit(const Quad& quad, const glm::vec4& tint, float angle, bool degrees = false); //!< Record a tinted quad with rotation
+		void submit(const Quad& quad, const std::shared_ptr<SubTexture>& texture, float angle, bool degrees = false); //!< Record a textured quad with rotation
+		void submit(const Quad& quad, const glm::vec4& tint, const std::shared_ptr<SubTexture>& texture, float angle, bool degrees = false); //!< Record a textured and tinted quad with rotation
+		void submit(const QuadInstance& quad); //!< Record a quad already in bulk form
+		void submit(const char* text, const glm::vec2& position, const glm::vec4& tint); //!< Record a line of text, laid out when merged
+		void clear(); //!< Drop all recorded submissions
+		Snapshot snapshot(FramePacket& packet); //!< Copy the recorded submissions into a frame packet then clear the recorder, the snapshot lives as long as the packet's contents
+	};
+
+	/** \class TextRun
+	** \brief A line of text laid out once into glyph quads, redrawn by Renderer2D without touching the glyph data
+	*
+	* Layout happens on the first submit and again only when the text or the font changes.
+	*/
+	class TextRun {
+	private:
+		/** \struct Glyph
+		*\brief one laid out glyph relative to the run origin
+		\param rect vec4 - min (xy) and max (zw) corner
+		\param uvRect vec4 - UV start (xy) and end (zw)
+		\param packedUVs uint16_t[4] - UV rect for instanced rendering
+		\param subTexture SubTexture* - glyph texture, owned by Renderer2D
 		*/
-		struct GlyphData {
-			glm::vec2 size; //!< Size of the character 
-			glm::vec2 bearing; //!< Bearing of the character
-			float advance; //!< Advance of the character
-			std::shared_ptr<SubTexture> subTexture; //!< Texture for the character
+		struct Glyph {
+			glm::vec4 rect; //!< Min and max corner
+			glm::vec4 uvRect; //!< UV start and end
+			uint16_t packedUVs[4]; //!< UV rect packed to 16 bits
+			const SubTexture* subTexture; //!< Glyph texture
 		};
 
+		std::string m_text; //!< Text of the run
+		std::vector<Glyph> m_glyphs; //!< Laid out glyphs
+		std::shared_ptr<OpenGLTexture> m_texture; //!< Atlas the glyphs are in
+		glm::vec4 m_bounds = glm::vec4(0.f); //!< Min (xy) and max (zw) corner of all glyphs
+		uint32_t m_fontGeneration = 0; //!< Font generation the layout was made with, zero when not laid out
+		friend class Renderer2D; //!< Renderer2D lays out and draws the run
+	public:
+		TextRun() = default; //!< Default constructor
+		TextRun(const char* text) : m_text(text) {} //!< Constructor with the text
+		inline void setText(const char* text) { if (m_text != text) { m_text = text; m_fontGeneration = 0; } } //!< Set the text, only invalidating the layout when it changed
+		inline const std::string& getText() const { return m_text; } //!< Get the text
+		inline uint32_t getGlyphCount() const { return static_cast<uint32_t>(m_glyphs.size()); } //!< Get the number of laid out glyphs
+		inline const glm::vec4& getBounds() const { return m_bounds; } //!< Get the min (xy) and max (zw) corner of the last layout, relative to the run origin
+	};
+
+	/** \class Renderer2D
+	** \brief Class which allows the rendering of simple 2D primitive
+	*/
+	class Renderer2D {
+	private:
+
 		/** \struct InternalData
 		*\brief all Renderer properties used for rendering to be used as a static object
 		\param defaultTexture shared_ptr<OpenGLTexture> - default white texture
 		\param fontTexture shared_ptr<OpenGLTexture> - font texture
 		\param shader shared_ptr<OpenGLShader> - shader used for the 2D object
+		\param texDataUniform UniformHandle<int32_t> - handle of the sampler array in the shader
 		\param VAO shared_ptr<VertexArray> - vertex array for the 2D quad
+		\param VBO shared_ptr<OpenGLVertexBuffer> - persistently mapped streaming vertex buffer
 		\param quadUBO shared_ptr<UniformBuffer> - uniform buffer for the 2D quad
 		\param defaultSubTexture shared_ptr<SubTexture> - default sub texture
 		\param quad array<vec4, 4> - Quad position
 		\param textureUnits array<int32_t, 32> - Texture units
-		\param vertices vector<Render2DVertex> - Quad vertices
-		\param glyphData vector<GlyphData> - Struct of glyph data
+		\param vertices Render2DVertex* - Quad vertices, written straight into the mapped region of the VBO
+		\param instances Renderer2DInstance* - Quad instances in instanced mode, written straight into the mapped region of the VBO
+		\param mode Renderer2DMode - batched vertices or instanced sprites
+		\param batchTexUnits vector<uint32_t> - texture unit of each quad in a bulk submission
+		\param batchUVRects vector<vec4> - UV start and end of each quad in a bulk submission
 		\param batchSize uint32_t - batch size per draw call
+		\param batchesPerRegion uint32_t - full batches one frame can write before its region of the VBO is used up
+		\param regionCapacity uint32_t - quads in one frame's region of the VBO
+		\param regionCount uint32_t - number of frames the VBO can have in flight
+		\param region void* - start of the current frame's region in the mapped VBO, null outside begin() and end()
+		\param regionUsed uint32_t - quads drawn from the current frame's region by earlier batches
+		\param batchCapacity uint32_t - vertices the current batch can hold, the batch size or less when the region is nearly full
 		\param defaultTint vec4 - Default white tint
 		\param model mat4 - Model matrix
-		\param drawCount uint32_t - draw count
+		\param drawCount uint32_t - draw count, in vertices (four per quad) in both modes
+		\param recorders vector<weak_ptr<Renderer2DRecorder>> - recorders merged at the end of the scene, in creation order
+		\param recorderMutex mutex - guards the list of recorders
+		\param mergeCommands vector<Renderer2DRecorder::MergedCommand> - recorded commands in drawing order
+		\param mergedQuads vector<QuadInstance> - merged quads handed to submitBatch
+		\param deferred bool - submissions are sorted at end() rather than drawn in submission order
+		\param layer int32_t - layer given to deferred submissions
+		\param strictOrder bool - deferred submissions keep submission order within their layer
+		\param sortSegment uint32_t - times strict order was toggled since begin(), quads are never sorted across a toggle
+		\param deferredQuads vector<QuadInstance> - deferred submissions
+		\param sortEntries vector<SortEntry> - sort key of each deferred submission
+		\param sortScratch vector<SortEntry> - scratch space for the radix sort
+		\param drawCalls uint32_t - draws issued since begin()
+		\param fontGeneration uint32_t - changes whenever the glyph data changes, so text runs know to lay out again
 
-		\param ft FT_Library - freetype library
-		\param font FT_Face - freetype font face
-		\param glyphAtlas TextureAtlas - texture atlas for the font
-		\param firstChar char - first typeable char ascii code (32 = Space)
-		\param lastChar char - last typeable char ascii code (126 = ~)
+		\param ft FT_Library - freetype library, null until a glyph is missing from the glyph cache
+		\param font FT_Face - freetype font face, null until a glyph is missing from the glyph cache
+		\param sdfText bool - glyphs are signed distance fields
+		\param sdfBaseSize uint32_t - pixel size distance field glyphs are rasterized at
+		\param sdfSpread uint32_t - distance in pixels the field reaches outside the glyph
+		\param sdfTextureID uint32_t - render ID of the distance field atlas, zero when not used
+		\param glyphCache shared_ptr<GlyphCache> - glyphs rasterized on first use into the font atlas
+		\param firstChar char - first char rasterized at init, ascii code (32 = Space)
+		\param lastChar char - last char rasterized at init, ascii code (126 = ~)
 		*/
 		struct InternalData {
 			std::shared_ptr<OpenGLTexture> defaultTexture; //!< Empty white texture
 			std::shared_ptr<OpenGLTexture> fontTexture; //!< Font texture
 			std::shared_ptr<OpenGLShader> shader; //!< Shader
+			UniformHandle<int32_t> texDataUniform; //!< Sampler array handle
 			std::shared_ptr<OpenGLVertexArray> VAO; //!< Vertex array for the 2D quad
+			std::shared_ptr<OpenGLVertexBuffer> VBO; //!< Streaming vertex buffer for the 2D quad
 			std::shared_ptr<OpenGLUniformBuffer> quadUBO; //!< Uniform buffer for the 2D quad
 			std::shared_ptr <SubTexture> defaultSubTexture; //!< Default sub texture
 			std::array<glm::vec4, 4> quad; //!< Quad postion
 			std::array<int32_t, 32> textureUnits; //!< Texture units / slots
-			std::vector<Renderer2DVertex> vertices; //!< Quad verticies
-			std::vector<GlyphData> glyphData; //!< Glyph data structure
+			Renderer2DVertex* vertices; //!< Quad verticies
+			Renderer2DInstance* instances; //!< Quad instances
+			Renderer2DMode mode; //!< Batched or instanced
+			std::vector<uint32_t> batchTexUnits; //!< Scratch texture units for submitBatch
+			std::vector<glm::vec4> batchUVRects; //!< Scratch UV rectangles for submitBatch
 			static const uint32_t batchSize = 8192; //!< Batch size per draw call
+			static const uint32_t batchesPerRegion = 4; //!< Full batches in a frame's region
+			static const uint32_t regionCapacity = batchSize / 4 * batchesPerRegion; //!< Quads in a frame's region
+			static const uint32_t regionCount = 3; //!< Frames in flight before the CPU waits on the GPU
+			void* region; //!< Current frame's region
+			uint32_t regionUsed; //!< Quads already drawn from the region
+			uint32_t batchCapacity; //!< Vertices the current batch can hold
 			glm::vec4 defaultTint; //!< Default white tint ( Colour / Albedo )
 			glm::mat4 model; //!< Matrix model
 			uint32_t drawCount; //!< Draw count
 
+			std::vector<std::weak_ptr<Renderer2DRecorder>> recorders; //!< Registered recorders
+			std::mutex recorderMutex; //!< Guards registration
+			std::vector<Renderer2DRecorder::MergedCommand> mergeCommands; //!< Commands being merged
+			std::vector<QuadInstance> mergedQuads; //!< Merged quads
+
+			bool deferred; //!< Sort submissions at end()
+			int32_t layer; //!< Current layer
+			bool strictOrder; //!< Keep submission order within a layer
+			uint32_t sortSegment; //!< Strict order segment
+			std::vector<QuadInstance> deferredQuads; //!< Deferred submissions
+			std::vector<SortEntry> sortEntries; //!< Sort keys
+			std::vector<SortEntry> sortScratch; //!< Radix sort scratch
+			uint32_t drawCalls; //!< Draws this scene
+			uint32_t fontGeneration; //!< Glyph data version
+
 			FT_Library ft; //!< Freetype library
 			FT_Face font; //!< Freetype font face
-			TextureAtlas glyphAtlas; //!< Texture atlas for the font
-			unsigned char firstGlyph = 32; //!< First character
-			unsigned char lastGlyph = 126; //!< Last character
+			bool sdfText; //!< Distance field glyphs
+			static const uint32_t sdfBaseSize = 32; //!< Distance field raster size
+			static const uint32_t sdfSpread = 4; //!< Distance field reach
+			uint32_t sdfTextureID; //!< Distance field atlas
+			std::shared_ptr<GlyphCache> glyphCache; //!< Glyph cache for the font
+			unsigned char firstGlyph = 32; //!< First character rasterized at init
+			unsigned char lastGlyph = 126; //!< Last character rasterized at init
 		};
 
-		static void RtoRGBA(unsigned char* DSTbuffer, unsigned char* SRCBuffer, uint32_t width, uint32_t height); //! Function to convert the buffer to RGBA format
+		static void startBatch(); //!< Point the vertex or instance pointer after the batches already in the frame's region
+		static void writeInstance(const Quad& quad, float angle, uint32_t packedTint, uint32_t textSlot, const std::shared_ptr<SubTexture>& texture); //!< Write a quad as one instance record
+		static void layoutText(const char* text, uint32_t length, const glm::vec2& position, const glm::vec4& tint, std::vector<QuadInstance>& out); //!< Lay out a line of text as quads
+		static void mergeRecorders(); //!< Merge every recorder's commands by layer and submission order and submit them
+		static void submitRecorded(); //!< Lay out and submit the merged commands, deferring them on their recorded layers in deferred mode
+		static void layoutRun(TextRun& run); //!< Lay out a text run against the current glyph data
+		static void layoutRunGlyphs(TextRun& run); //!< One layout pass over the glyphs of a text run
+		static void writeBatch(const QuadInstance* quads, uint32_t count); //!< Write quads into the batch, flushing when it or the texture units fill up
+		static void defer(const QuadInstance& quad, int32_t layer); //!< Hold a quad with its sort key until end(), see QuadBatch::sortKey
+		static void submitDeferred(); //!< Radix sort the deferred quads and write them into batches
+		static void submitGlyph(uint32_t codepoint, const glm::vec2& position, float& advance, const glm::vec4& tint, float scale); //!< Render a single glyph by codepoint
+		static const uint32_t sdfUnitFlag = 0x100; //!< Set on a texture unit to sample it as a distance field
+		static uint32_t unitFlags(uint32_t textureID); //!< Shader flags to combine with the unit of a texture
 		static std::shared_ptr<InternalData> s_data; //!< Internal data of the renderer
 	public:
-		static void init(); //!< Init the renderer
+		static void init(const Renderer2DProps& props = Renderer2DProps()); //!< Init the renderer
 		static void begin(const SceneWideUniforms& sceneWideUniforms); //!< Begin a new 2D scene
 		static void submit(const Quad& quad, const glm::vec4& tint); //!< Render a tinted quad
 		static void submit(const Quad& quad, const std::shared_ptr<SubTexture>& texture); //!< Render a textured quad
@@ -115,9 +331,19 @@ namespace Engine {
 		static void submit(const Quad& quad, const std::shared_ptr<SubTexture>& texture, float angle, bool degrees = false); //!< Render a textured with rotation
 		static void submit(const Quad& quad, const glm::vec4& tint, const std::shared_ptr<SubTexture>& texture, float angle, bool degrees = false); //!< Render a textured and tinted quad with rotation
 
+		static void submitBatch(const QuadInstance* quads, uint32_t count); //!< Render many quads at once, transformed four at a time with SIMD
+		static void setLayer(int32_t layer); //!< Set the layer for deferred submissions, lower layers are drawn first
+		static void setStrictOrder(bool strict); //!< Keep following deferred submissions in submission order within their layer, for overlapping translucent sprites
+		static uint32_t getDrawCalls(); //!< Get the number of draws issued since begin()
+		static const GlyphCacheStats& getGlyphCacheStats(); //!< Get the glyph cache hit, miss and eviction counters
+		static std::shared_ptr<Renderer2DRecorder> createRecorder(); //!< Create a recorder for a worker thread, it is merged by every end() while it is alive
+		static void submit(const Renderer2DRecorder::Snapshot& snapshot); //!< Render recorded submissions copied into a frame packet, in submission order or on their recorded layers in deferred mode
+
 		static void submit(char ch, const glm::vec2& position, float& advance, const glm::vec4& tint); //!< Render a single character with a tint
-		static void submit(const char * text, const glm::vec2& position, const glm::vec4& tint); //!< Render a line of character with a tint
-		static void end(); //!< End the current 2D scene
+		static void submit(const char * text, const glm::vec2& position, const glm::vec4& tint); //!< Render a line of UTF-8 text with a tint
+		static void submit(const char * text, const glm::vec2& position, const glm::vec4& tint, float scale); //!< Render a line of UTF-8 text with a tint at a scale of the font size
+		static void submit(TextRun& run, const glm::vec2& offset, const glm::vec4& tint, float scale = 1.f); //!< Render a laid out line of text, laying it out first if the text or font changed
+		static void end(); //!< End the current 2D scene, merging every recorder, see Renderer2DRecorder for how recorded and direct quads are ordered
 		static void flush(); //!< Render all geometry
 	};
 }
\ No newline at end of file
@@ -1,6 +1,15 @@
 /** \file Renderer3D.h */
 #pragma once
 #include "rendering/RendererCommon.h"
+#include "rendering/radixSort.h"
+#include "rendering/transformBatch.h"
+#include "rendering/culling.h"
+#include "rendering/lodSet.h"
+#include "rendering/lightClusters.h"
+#include "rendering/occlusionCuller.h"
+#include "rendering/renderThread.h"
+#include "platform/OpenGL/OpenGLStorageBuffer.h"
+#include "platform/OpenGL/OpenGLGeometryArena.h"
 
 namespace Engine {
 
@@ -13,6 +22,8 @@ namespace Engine {
 		std::shared_ptr<OpenGLShader> m_shader; //!< The material shader
 		std::shared_ptr<OpenGLTexture> m_texture; //!< The texture to be applied to the material
 		glm::vec4 m_tint; //!< Colour tint ( Albedo ) to be applied to the geometry
+		static uint32_t s_nextID; //!< ID given to the next material
+		uint32_t m_id = s_nextID++; //!< Sequential ID used to sort draws by material
 
 		void setFlag(uint32_t flag) { m_flags = m_flags | flag; } //!<  Set the flag for material
 	public:
@@ -33,6 +44,7 @@ namespace Engine {
 		inline std::shared_ptr<OpenGLShader> getShader() const { return m_shader; } //!< Get the shader
 		inline std::shared_ptr<OpenGLTexture> getTexture() const { return m_texture; } //!< Get the texture
 		inline glm::vec4 getTint() const { return m_tint; } //!< Get the tint
+		inline uint32_t getID() const { return m_id; } //!< Get the sequential material ID
 		bool isFlagSet(uint32_t flag) const { return m_flags & flag; } //!< Check if the flag is set
 
 		void setTexture(const std::shared_ptr<OpenGLTexture>& texture) { m_texture = texture; } //!< Set the texture
@@ -42,11 +54,138 @@ namespace Engine {
 		constexpr static uint32_t flag_tint = 1 << 1;		//!< 00000010
 	};
 
+	/** \struct Renderer3DStats
+	*\brief counters for the last scene drawn by Renderer3D
+	\param draws uint32_t - draw calls
+	\param shaderChanges uint32_t - programs bound
+	\param vaoChanges uint32_t - vertex arrays bound
+	\param materialChanges uint32_t - material uniforms uploaded
+	\param textureBinds uint32_t - textures bound to a unit
+	\param instancedDraws uint32_t - draws which drew more than one instance, counting each indirect command
+	\param instances uint32_t - submissions drawn by instanced draws
+	\param indirectCommands uint32_t - commands drawn by glMultiDrawElementsIndirect
+	\param pageChanges uint32_t - geometry arena page buffers attached
+	\param visible uint32_t - submissions inside the view frustum and not occluded
+	\param culled uint32_t - submissions outside the view frustum, never drawn
+	\param occluded uint32_t - submissions inside the view frustum but hidden behind occluders, never drawn
+	\param occluderTriangles uint32_t - occluder triangles rasterized by the occlusion culler
+	\param lodObjects uint32_t[] - LOD submissions drawn at each level, counting both levels of a cross-fade
+	\param lodTriangles uint32_t[] - triangles submitted at each LOD level
+	\param lights uint32_t - lights binned into clusters
+	\param lightAssignments uint32_t - entries in the cluster light index list
+	*/
+	struct Renderer3DStats {
+		uint32_t draws = 0; //!< Draw calls
+		uint32_t shaderChanges = 0; //!< Program changes
+		uint32_t vaoChanges = 0; //!< Vertex array changes
+		uint32_t materialChanges = 0; //!< Material uploads
+		uint32_t textureBinds = 0; //!< Texture binds
+		uint32_t instancedDraws = 0; //!< Instanced draw calls
+		uint32_t instances = 0; //!< Submissions drawn instanced
+		uint32_t indirectCommands = 0; //!< Indirect commands
+		uint32_t pageChanges = 0; //!< Arena page changes
+		uint32_t visible = 0; //!< Visible submissions
+		uint32_t culled = 0; //!< Culled submissions
+		uint32_t occluded = 0; //!< Occluded submissions
+		uint32_t occluderTriangles = 0; //!< Occluder triangles
+		uint32_t lodObjects[LODSet::maxLevels] = {}; //!< Submissions per LOD level
+		uint32_t lodTriangles[LODSet::maxLevels] = {}; //!< Triangles per LOD level
+		uint32_t lights = 0; //!< Clustered lights
+		uint32_t lightAssignments = 0; //!< Light index list entries
+	};
+
+	/** \struct DrawMaterial
+	*\brief per draw material entry read by shaders which take a_drawId, laid out to match a std430 { vec4; int; float; int; } block
+	\param tint vec4 - tint
+	\param texUnit int32_t - texture unit of the albedo texture, shared by every draw of a multi draw which samples it through u_texData
+	\param fade float - LOD cross-fade progress, 1 when not fading
+	\param fadeOut int32_t - 1 when this is the level fading out, which draws the complement of the dither mask
+	*/
+	struct DrawMaterial {
+		glm::vec4 tint; //!< Tint
+		int32_t texUnit; //!< Texture unit
+		float fade; //!< Cross-fade progress
+		int32_t fadeOut; //!< Is the level fading out
+		int32_t padding; //!< Pads to the std430 struct size
+	};
+
 	/** \class Renderer3D 
-	** \brief A class which renders 3D geometry
+	** \brief A class which renders 3D geometry, submissions are recorded and drawn sorted by state at end()
+	*
+	* With a render thread the game thread records the scene and ends it into the frame packet, which culls, sorts and
+	* bins lights there and copies the result into the packet. Only draw() runs on the thread owning the context.
 	*/
 	class Renderer3D {
 	private:
+		/** \struct DrawPacket
+		*\brief one recorded submission
+		\param geometry OpenGLVertexArray* - geometry, must stay alive until the scene is drawn, nullptr for arena meshes
+		\param mesh ArenaMesh - arena mesh, when geometry is nullptr
+		\param material Material* - material, must stay alive until the scene is drawn
+		\param model mat4 - model matrix
+		\param fade float - LOD cross-fade progress, 1 when not fading
+		\param fadeOut bool - is this the LOD level fading out
+		*/
+		struct DrawPacket {
+			OpenGLVertexArray* geometry; //!< Geometry
+			ArenaMesh mesh; //!< Arena mesh
+			Material* material; //!< Material
+			glm::mat4 model; //!< Model matrix
+			float fade = 1.f; //!< Cross-fade progress
+			bool fadeOut = false; //!< Is the level fading out
+		};
+
+		/** \struct DrawUniforms
+		*\brief uniforms of a shader which takes its transform and material per draw, resolved when the program changes
+		\param texData UniformHandle<int32_t> - texture unit, also set once per bucket by shaders which take a_drawId
+		\param tint UniformHandle<vec4> - material tint
+		\param model UniformHandle<mat4> - model matrix
+		\param fade UniformHandle<float> - LOD cross-fade progress, invalid when the shader cannot dither
+		\param fadeOut UniformHandle<int32_t> - is the level fading out
+		*/
+		struct DrawUniforms {
+			UniformHandle<int32_t> texData; //!< Texture unit
+			UniformHandle<glm::vec4> tint; //!< Tint
+			UniformHandle<glm::mat4> model; //!< Model matrix
+			UniformHandle<float> fade; //!< Cross-fade progress
+			UniformHandle<int32_t> fadeOut; //!< Fading out
+		};
+	public:
+		/** \struct Scene
+		*\brief a scene ended on the recording thread, holding everything draw() reads
+		\param view mat4 - view matrix
+		\param projection mat4 - projection matrix
+		\param packets const DrawPacket* - every packet recorded in the scene
+		\param entries const SortEntry* - visible packets in draw order
+		\param count uint32_t - number of visible packets
+		\param transforms const ObjectTransform* - transform of each visible packet in draw order
+		\param lights const Light* - lights of the scene
+		\param lightCount uint32_t - number of lights
+		\param clusterHeader ClusterHeader - light cluster grid
+		\param clusters const LightCluster* - range of each cluster in the light index list
+		\param clusterCount uint32_t - number of clusters
+		\param lightIndices const uint32_t* - light indices of every cluster
+		\param lightIndexCount uint32_t - number of light indices
+		\param stats Renderer3DStats - culling, LOD and light counters gathered while recording
+		*/
+		struct Scene {
+			glm::mat4 view; //!< View matrix
+			glm::mat4 projection; //!< Projection matrix
+			const DrawPacket* packets; //!< Recorded packets
+			const SortEntry* entries; //!< Draw order
+			uint32_t count; //!< Visible packets
+			const ObjectTransform* transforms; //!< Transforms in draw order
+			const Light* lights; //!< Lights
+			uint32_t lightCount; //!< Light count
+			ClusterHeader clusterHeader; //!< Cluster grid
+			const LightCluster* clusters; //!< Clusters
+			uint32_t clusterCount; //!< Cluster count
+			const uint32_t* lightIndices; //!< Cluster light indices
+			uint32_t lightIndexCount; //!< Light index count
+			Renderer3DStats stats; //!< Recording counters
+		};
+	private:
+
 		/** \struct InternalData
 		*\brief all Renderer properties used for rendering to be used as a static object
 		\param sceneWideUniforms SceneWideUniforms - scene wide uniform values
@@ -58,6 +197,38 @@ namespace Engine {
 		\param lightPos vec3 - Position of light
 		\param lightCol vec3 - Light color
 		\param viewPos vec3 - View position
+		\param view mat4 - view matrix of the scene, used for the depth in sort keys
+		\param projection mat4 - projection matrix of the scene, used for LOD screen sizes
+		\param lodBias float - global LOD bias, each step halves the screen size levels are selected with
+		\param lodScale float - 2 to the power of -lodBias
+		\param packets vector<DrawPacket> - submissions recorded this scene
+		\param sortEntries vector<SortEntry> - sort key of each packet
+		\param sortScratch vector<SortEntry> - scratch space for the radix sort
+		\param depthRange float - view depth mapped onto the depth bits of the sort key
+		\param stats Renderer3DStats - counters gathered while recording the current scene
+		\param drawStats Renderer3DStats - counters of the last drawn scene
+		\param transformSSBO shared_ptr<OpenGLStorageBuffer> - model and normal matrices of every packet in draw order
+		\param transforms vector<ObjectTransform> - transforms in draw order, built when the scene ends
+		\param transformBinding uint32_t - shader storage binding of the transforms
+		\param materialSSBO shared_ptr<OpenGLStorageBuffer> - tint and texture unit of every packet in draw order
+		\param drawMaterials vector<DrawMaterial> - CPU copy of the draw materials
+		\param materialBinding uint32_t - shader storage binding of the draw materials
+		\param geometryArena shared_ptr<OpenGLGeometryArena> - static geometry shared by all meshes added with addGeometry
+		\param indirectBuffer shared_ptr<OpenGLStorageBuffer> - indirect commands of the scene
+		\param commands vector<DrawElementsIndirectCommand> - CPU copy of the indirect commands
+		\param drawIDLocation uint32_t - attribute location of a_drawId
+		\param frustum Frustum - view frustum of the scene
+		\param spheres vector<vec4> - world space bounding sphere of each packet
+		\param visibility vector<uint8_t> - frustum test result of each packet
+		\param lights vector<Light> - point and spot lights submitted this scene
+		\param lightClusters LightClusters - CPU binning of the lights into view clusters
+		\param lightSSBO shared_ptr<OpenGLStorageBuffer> - lights of the scene
+		\param clusterSSBO shared_ptr<OpenGLStorageBuffer> - cluster header followed by the offset and count of every cluster
+		\param lightIndexSSBO shared_ptr<OpenGLStorageBuffer> - light indices of every cluster
+		\param lightBinding uint32_t - shader storage binding of the lights
+		\param clusterBinding uint32_t - shader storage binding of the clusters
+		\param lightIndexBinding uint32_t - shader storage binding of the light indices
+		\param occlusionCuller OcclusionCuller - software depth buffer of the scene's occluders
 		*/
 		struct InternalData {
 			SceneWideUniforms sceneWideUniforms;
@@ -69,13 +240,66 @@ namespace Engine {
 			glm::vec3 lightColour = glm::vec3(1.f, 1.f, 1.f); //!< Colour of the light
 			glm::vec3 lightPos = glm::vec3(1.f, 4.f, 6.f); //!< Position of the light
 			glm::vec3 viewPos = glm::vec3(0.f, 0.f, 0.f); //!< View position
+			glm::mat4 view = glm::mat4(1.f); //!< View matrix
+			glm::mat4 projection = glm::mat4(1.f); //!< Projection matrix
+			float lodBias = 0.f; //!< LOD bias
+			float lodScale = 1.f; //!< Screen size scale from the LOD bias
+			std::vector<DrawPacket> packets; //!< Recorded submissions
+			std::vector<SortEntry> sortEntries; //!< Sort keys
+			std::vector<SortEntry> sortScratch; //!< Radix sort scratch
+			float depthRange = 1000.f; //!< Depth covered by the sort key
+			Renderer3DStats stats; //!< Recording counters
+			Renderer3DStats drawStats; //!< Counters of the last drawn scene
+			std::shared_ptr<OpenGLStorageBuffer> transformSSBO; //!< Per object transforms
+			std::vector<ObjectTransform> transforms; //!< Transforms in draw order
+			uint32_t transformBinding = 0; //!< Storage binding of the transforms
+			std::shared_ptr<OpenGLStorageBuffer> materialSSBO; //!< Per draw materials
+			std::vector<DrawMaterial> drawMaterials; //!< Draw materials in draw order
+			uint32_t materialBinding = 1; //!< Storage binding of the draw materials
+			std::shared_ptr<OpenGLGeometryArena> geometryArena; //!< Static geometry
+			std::shared_ptr<OpenGLStorageBuffer> indirectBuffer; //!< Indirect commands
+			std::vector<DrawElementsIndirectCommand> commands; //!< Indirect commands
+			uint32_t drawIDLocation = 7; //!< a_drawId location
+			Frustum frustum; //!< View frustum
+			std::vector<glm::vec4> spheres; //!< World bounding spheres
+			std::vector<uint8_t> visibility; //!< Frustum test results
+			std::vector<Light> lights; //!< Scene lights
+			LightClusters lightClusters; //!< Light binning
+			std::shared_ptr<OpenGLStorageBuffer> lightSSBO; //!< Lights
+			std::shared_ptr<OpenGLStorageBuffer> clusterSSBO; //!< Clusters
+			std::shared_ptr<OpenGLStorageBuffer> lightIndexSSBO; //!< Cluster light indices
+			uint32_t lightBinding = 2; //!< Storage binding of the lights
+			uint32_t clusterBinding = 3; //!< Storage binding of the clusters
+			uint32_t lightIndexBinding = 4; //!< Storage binding of the light indices
+			OcclusionCuller occlusionCuller; //!< Occlusion culling
 		};
 		static std::shared_ptr<InternalData> s_data; //!< Data internal to the renderer
+		static void record(const DrawPacket& packet); //!< Record a packet with its sort key
+		static uint32_t vertexSource(const DrawPacket& packet); //!< Sort key bits identifying the vertex array and page a packet draws from
+		static Scene prepare(); //!< Cull, sort, build the transforms and bin the lights, pointing a scene at the internal copies
+		static void cull(); //!< Remove the sort entries of packets outside the view frustum or behind occluders
+		static void binLights(); //!< Bin the scene's lights into clusters
+		static void uploadLights(const Scene& scene); //!< Upload a scene's lights and clusters for clustered shaders
+		static uint64_t sortKey(uint32_t vertexSource, const Material& material, const glm::mat4& model); //!< Build the sort key of a submission
+		static bool resolveUnit(const Material& material, uint32_t& unit); //!< Get a texture unit for a material's texture, binding it if needed, false when every unit is held by the current draw
+		static void execute(const Scene& scene); //!< Draw the sorted packets, only changing state which differs from the previous packet
+		static void drawUniforms(const DrawPacket& packet, OpenGLShader& shader, const DrawUniforms& uniforms, bool applyMaterial); //!< Draw one packet with a shader which takes its transform and material as uniforms
+		static uint32_t drawIndirect(const Scene& scene, uint32_t first, OpenGLShader& shader, UniformHandle<int32_t> texData, uint32_t& commandCount); //!< Draw a bucket of packets sharing a shader, vertex source and texture with one glMultiDrawElementsIndirect, returns the packets drawn
 	public:
 		static void init(); //!< Init the renderer
-		static void begin(const SceneWideUniforms& sceneWideUniforms); //!< Begin a new 3D scene
-		static void submit(const std::shared_ptr<OpenGLVertexArray> geometry, const std::shared_ptr<Material>& material, const glm::mat4& model); //!< Submit a piece of geometry to be rendered
-		static void end(); //!< End the current 3D scene
+		static void begin(const SceneWideUniforms& sceneWideUniforms); //!< Begin a new 3D scene, only the view and projection are read and they are copied
+		static ArenaMesh addGeometry(const VertexBufferLayout& layout, const void* vertices, uint32_t size, const uint32_t* indices, uint32_t indexCount); //!< Copy static geometry into the shared geometry arena
+		static void submit(const std::shared_ptr<OpenGLVertexArray> geometry, const std::shared_ptr<Material>& material, const glm::mat4& model); //!< Record a piece of geometry to be rendered at end(), geometry and material must stay alive until then
+		static void submit(const ArenaMesh& mesh, const std::shared_ptr<Material>& material, const glm::mat4& model); //!< Record an arena mesh to be rendered at end(), the material must stay alive until then
+		static void submit(const LODSet& lods, LODState& state, const std::shared_ptr<Material>& material, const glm::mat4& model); //!< Select a level of detail by screen size and record it, the set and materials must stay alive until end()
+		static void submit(const Light& light); //!< Add a point or spot light to the current scene, read by clustered shaders
+		static void submitOccluder(const void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t offset, const uint32_t* indices, uint32_t indexCount, const glm::mat4& model); //!< Add CPU side geometry which hides what is behind it this scene, the data must stay alive until end()
+		static void setLODBias(float bias); //!< Set the global LOD bias, positive values select coarser levels
+		inline static float getLODBias() { return s_data->lodBias; } //!< Get the global LOD bias
+		static void end(); //!< Sort and draw everything submitted, then end the current 3D scene
+		static Scene end(FramePacket& packet); //!< End the current 3D scene without drawing it, culling, sorting and binning lights on this thread and copying the result into the packet
+		static void draw(const Scene& scene); //!< Draw a scene ended into a frame packet, on the thread owning the context before the packet is cleared
+		static const Renderer3DStats& getStats(); //!< Get the counters for the last drawn scene, read on the drawing thread
 		static void attachShader(std::shared_ptr<OpenGLShader>& shader); //!< Attach shader ot the UBO's
 	};
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "platform/OpenGL/OpenGLShader.h"
 #include "platform/OpenGL/OpenGLVertexArray.h"
 #include "platform/OpenGL/OpenGLUniformBuffer.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
 #include "rendering/TextureUnitManager.h"
 #include "rendering/shaderDataType.h"
 #include "systems/loggerSys.h"
@@ -14,7 +15,10 @@
 namespace Engine {
 	using SceneWideUniforms = std::unordered_map<const char*, std::pair<ShaderDataType, void*>>; //!< Declares SceneWideUniforms in dedicated space.
 	class RendererCommon {
+	private:
+		static std::shared_ptr<OpenGLIndexBuffer> s_quadIndexBuffer; //!< Quad index pattern shared by every quad based renderer
 	public:
 		static TextureUnitManager s_textureUnitManager; //!< texture unit manager
+		static std::shared_ptr<OpenGLIndexBuffer> getQuadIndexBuffer(uint32_t quadCount); //!< Get the shared quad index buffer (0,1,2,2,3,0 per quad) holding at least quadCount quads
 	};
 }
\ No newline at end of file
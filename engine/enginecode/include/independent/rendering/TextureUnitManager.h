@@ -1,25 +1,50 @@
 /** \file TextureUnitManager.h */
 #pragma once
 
-#include <vector>
-#include <unordered_map>
+#include <cstdint>
 
 namespace Engine {
 
+	/** \struct TextureUnitStats
+	*\brief counters for a TextureUnitManager
+	\param hits uint64_t - lookups which found the texture already resident
+	\param binds uint64_t - textures which had to be bound to a unit
+	\param evictions uint64_t - resident textures replaced to make space
+	*/
+	struct TextureUnitStats {
+		uint64_t hits = 0; //!< Resident lookups
+		uint64_t binds = 0; //!< Binds needed
+		uint64_t evictions = 0; //!< Textures evicted
+	};
+
 	/**
 	\class TextureUnitManager
-	* \brief class to store texture in a ring buffer
+	* \brief Tracks which texture is resident in each texture unit, evicting the least recently used unit when all are taken
+	*
+	* Texture IDs are held in a fixed array searched 4 units at a time with SSE. Every lookup stamps its unit with a
+	* use counter; units stamped since the last nextBatch() are read by the batch still being recorded, so they are
+	* never evicted. When every unit is held by the batch getUnit gives -1 and the caller must draw before retrying.
 	*/
 	class TextureUnitManager {
-	private:
-		std::vector<uint32_t> m_textureIds; //!< Internal buffer
-		std::unordered_map<uint32_t, uint32_t> m_textureUnits; //!< Unordered map of texture units
-		size_t m_nextUnit = 0; //!< Next unit
 	public:
-		TextureUnitManager(size_t capacity); //!< Constructor which takes a capacity
-		void clear(); //!< Clear and rest the buffer
-		bool getUnit(uint32_t textureID, uint32_t& textureUnit); //!< Returns whether or not the texture need binding needs binding to unit. Texture unit is always set to unit
-		inline bool full() { return m_nextUnit == m_textureIds.capacity(); }; //!< Is the buffer full
+		constexpr static uint32_t maxUnits = 32; //!< Most units the manager can track
+	private:
+		alignas(16) uint32_t m_textureIds[maxUnits]; //!< Texture resident in each unit, empty units hold the max value
+		uint64_t m_lastUsed[maxUnits]; //!< Use counter stamped on each unit when it was last looked up
+		uint32_t m_capacity; //!< Units managed
+		uint64_t m_useCount = 0; //!< Lookups so far, the stamp of the latest lookup
+		uint64_t m_batchStart = 0; //!< Latest stamp before the current batch started
+		TextureUnitStats m_stats; //!< Counters
 
+		int32_t find(uint32_t textureID) const; //!< Unit holding a texture, -1 when it is not resident
+	public:
+		TextureUnitManager(uint32_t capacity); //!< Constructor which takes the number of units, at most maxUnits
+		void clear(); //!< Forget every resident texture
+		void evict(uint32_t textureID); //!< Forget a texture, called when it is deleted so a reused ID is not taken as resident
+		void nextBatch(); //!< The previous batch has been drawn, its units may be evicted again
+		bool getUnit(uint32_t textureID, uint32_t& textureUnit); //!< Returns whether the texture needs binding to textureUnit, the unit is -1 when every unit is held by the current batch
+		bool full() const; //!< Is every unit held by the current batch
+		inline uint32_t getCapacity() const { return m_capacity; } //!< Get the number of units managed
+		inline const TextureUnitStats& getStats() const { return m_stats; } //!< Get the counters
 	};
-}
\ No newline at end of file
+}
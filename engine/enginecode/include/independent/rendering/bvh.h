@@ -0,0 +1,62 @@
+/** \file bvh.h */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "rendering/culling.h"
+
+namespace Engine {
+	/**
+	\class BVH
+	\brief Bounding volume hierarchy over object bounds, one object per leaf
+	*
+	* build() creates the tree top down with a binned surface area heuristic, splitting the top levels across threads.
+	* Objects can then be added and removed one at a time, and moving objects updated in place and refit. Object IDs
+	* stay valid until the object is removed or the tree is rebuilt.
+	*/
+	class BVH {
+	private:
+		/** \struct Node
+		*\brief tree node, a leaf when it has no children
+		*/
+		struct Node {
+			AABB bounds; //!< Bounds of everything below
+			int32_t parent = -1; //!< Parent node, -1 for the root
+			int32_t left = -1; //!< First child, -1 for leaves
+			int32_t right = -1; //!< Second child, -1 for leaves
+			int32_t object = -1; //!< Object of a leaf, -1 for internal nodes
+		};
+
+		std::vector<Node> m_nodes; //!< Node pool
+		std::vector<int32_t> m_freeNodes; //!< Unused nodes in the pool
+		std::vector<int32_t> m_leaves; //!< Leaf node of each object ID, -1 for unused IDs
+		std::vector<uint32_t> m_freeObjects; //!< Unused object IDs
+		int32_t m_root = -1; //!< Root node, -1 when empty
+		uint32_t m_objectCount = 0; //!< Objects in the tree
+
+		inline bool isLeaf(int32_t node) const { return m_nodes[node].left == -1; } //!< Is a node a leaf
+		int32_t allocateNode(); //!< Take a node from the pool
+		void freeNode(int32_t node); //!< Return a node to the pool
+		void refitAncestors(int32_t node); //!< Recompute the bounds from a node up to the root
+		void collectLeaves(int32_t node, std::vector<uint32_t>& results) const; //!< Add the objects of every leaf below a node
+
+		struct BuildState; //!< Shared state of one build
+		void buildNode(BuildState& state, int32_t node, uint32_t begin, uint32_t end, const AABB& centroidBounds, uint32_t parallelDepth); //!< Build the subtree of items begin to end below a node whose bounds are already set
+	public:
+		void build(const AABB* bounds, uint32_t count, uint32_t threadCount = 0); //!< Replace the tree with one over count objects with IDs 0 to count - 1, threadCount 0 uses every core
+		uint32_t insert(const AABB& bounds); //!< Add an object, returns its ID
+		void remove(uint32_t object); //!< Remove an object
+		void update(uint32_t object, const AABB& bounds); //!< Set the bounds of an object, call refit() once every moving object has been updated
+		void refit(); //!< Recompute every internal node from its children, keeps the tree shape
+		void clear(); //!< Remove every object
+
+		void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const; //!< Add the objects whose bounds touch a frustum
+		void queryAABB(const AABB& box, std::vector<uint32_t>& results) const; //!< Add the objects whose bounds overlap a box
+		void queryRay(const Ray& ray, std::vector<uint32_t>& results) const; //!< Add the objects whose bounds a ray or segment passes through
+		bool raycast(const Ray& ray, uint32_t& object, float& distance) const; //!< Find the object whose bounds a ray or segment enters first
+
+		inline uint32_t getObjectCount() const { return m_objectCount; } //!< Get the number of objects
+		inline const AABB& getBounds(uint32_t object) const { return m_nodes[m_leaves[object]].bounds; } //!< Get the bounds of an object
+		bool validate() const; //!< Check every node encloses its children and links back to its parent
+	};
+}
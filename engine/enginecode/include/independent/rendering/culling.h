@@ -0,0 +1,138 @@
+/** \file culling.h */
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace Engine {
+	/** \struct BoundingVolume
+	*\brief local space bounds of a piece of geometry, unbounded by default so it is never culled
+	\param min vec3 - minimum corner of the axis aligned box
+	\param max vec3 - maximum corner of the axis aligned box
+	\param sphere vec4 - centre (xyz) and radius (w) of the bounding sphere
+	*/
+	struct BoundingVolume {
+		glm::vec3 min = glm::vec3(-std::numeric_limits<float>::infinity()); //!< Box minimum
+		glm::vec3 max = glm::vec3(std::numeric_limits<float>::infinity()); //!< Box maximum
+		glm::vec4 sphere = glm::vec4(0.f, 0.f, 0.f, std::numeric_limits<float>::infinity()); //!< Sphere centre and radius
+
+		inline bool isBounded() const { return std::isfinite(sphere.w); } //!< Do the bounds enclose anything finite
+	};
+
+	/** \struct AABB
+	*\brief axis aligned box, empty by default so growing it by a point gives that point
+	\param min vec3 - minimum corner
+	\param max vec3 - maximum corner
+	*/
+	struct AABB {
+		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max()); //!< Minimum corner
+		glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max()); //!< Maximum corner
+
+		inline void grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); } //!< Grow to contain a point
+		inline void grow(const AABB& box) { min = glm::min(min, box.min); max = glm::max(max, box.max); } //!< Grow to contain a box
+		inline glm::vec3 centre() const { return (min + max) * 0.5f; } //!< Centre of the box
+		inline float surfaceArea() const { glm::vec3 d = glm::max(max - min, glm::vec3(0.f)); return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x); } //!< Surface area, zero when empty
+		inline bool overlaps(const AABB& box) const { return min.x <= box.max.x && max.x >= box.min.x && min.y <= box.max.y && max.y >= box.min.y && min.z <= box.max.z && max.z >= box.min.z; } //!< Do two boxes touch
+		inline bool contains(const AABB& box) const { return min.x <= box.min.x && min.y <= box.min.y && min.z <= box.min.z && max.x >= box.max.x && max.y >= box.max.y && max.z >= box.max.z; } //!< Is a box inside this one
+	};
+
+	/** \struct Ray
+	*\brief ray or, with a finite maxDistance, segment
+	\param origin vec3 - start point
+	\param direction vec3 - normalised direction
+	\param maxDistance float - length of the segment, infinite for a ray
+	*/
+	struct Ray {
+		glm::vec3 origin = glm::vec3(0.f); //!< Start point
+		glm::vec3 direction = glm::vec3(0.f, 0.f, -1.f); //!< Direction
+		float maxDistance = std::numeric_limits<float>::infinity(); //!< Segment length
+	};
+
+	/** \struct Frustum
+	*\brief six normalised planes (xyz normal, w distance) with the inside on the positive side
+	*/
+	struct Frustum {
+		glm::vec4 planes[6]; //!< Left, right, bottom, top, near, far
+	};
+
+	namespace Culling {
+		//! Compute the bounds of a set of positions
+		/*!
+		\param vertices void* - vertex data
+		\param vertexCount uint32_t - number of vertices
+		\param stride uint32_t - bytes between vertices
+		\param offset uint32_t - byte offset of the three float position in each vertex
+		*/
+		BoundingVolume computeBounds(const void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t offset);
+
+		//! Extract the frustum planes of a view projection matrix
+		/*!
+		\param viewProjection mat4 - projection * view
+		*/
+		Frustum extractFrustum(const glm::mat4& viewProjection);
+
+		//! Move a local space bounding sphere into world space
+		/*!
+		\param sphere vec4 - local centre and radius
+		\param model mat4 - model matrix
+		*/
+		glm::vec4 transformSphere(const glm::vec4& sphere, const glm::mat4& model);
+
+		//! Box enclosing a local space box after a model transform
+		/*!
+		\param min vec3 - local minimum corner
+		\param max vec3 - local maximum corner
+		\param model mat4 - model matrix
+		*/
+		AABB transformAABB(const glm::vec3& min, const glm::vec3& max, const glm::mat4& model);
+
+		//! Does a box touch the inside of a frustum, conservative near the corners
+		/*!
+		\param frustum Frustum - frustum planes
+		\param box AABB - box to test
+		\param fullyInside bool& - set when the box is entirely inside
+		*/
+		bool intersects(const Frustum& frustum, const AABB& box, bool& fullyInside);
+
+		//! Distance along a ray to a box
+		/*!
+		\param ray Ray - ray or segment
+		\param inverseDirection vec3 - 1 / ray.direction
+		\param box AABB - box to test
+		\param distance float& - entry distance, zero when the origin is inside
+		\return does the ray hit the box within its length
+		*/
+		bool intersects(const Ray& ray, const glm::vec3& inverseDirection, const AABB& box, float& distance);
+
+		//! Ray from the camera through a point on the screen
+		/*!
+		\param view mat4 - view matrix
+		\param projection mat4 - projection matrix
+		\param screenPosition vec2 - pixel position, origin at the top left
+		\param screenSize vec2 - size of the screen in pixels
+		*/
+		Ray screenRay(const glm::mat4& view, const glm::mat4& projection, const glm::vec2& screenPosition, const glm::vec2& screenSize);
+
+		//! Test spheres against a frustum one at a time
+		/*!
+		\param frustum Frustum - frustum planes
+		\param spheres vec4* - world space centre and radius of each sphere
+		\param count uint32_t - number of spheres
+		\param visible uint8_t* - set to 1 for spheres which intersect the frustum and 0 otherwise
+		\return number of visible spheres
+		*/
+		uint32_t cullSpheresScalar(const Frustum& frustum, const glm::vec4* spheres, uint32_t count, uint8_t* visible);
+
+		//! Test spheres against a frustum four at a time with SSE
+		/*!
+		\param frustum Frustum - frustum planes
+		\param spheres vec4* - world space centre and radius of each sphere
+		\param count uint32_t - number of spheres
+		\param visible uint8_t* - set to 1 for spheres which intersect the frustum and 0 otherwise
+		\return number of visible spheres
+		*/
+		uint32_t cullSpheres(const Frustum& frustum, const glm::vec4* spheres, uint32_t count, uint8_t* visible);
+	}
+}
@@ -0,0 +1,260 @@
+/** \file frameGraph.h */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Engine {
+	/** \enum FrameGraphFormat
+	*\brief storage format of a frame graph texture
+	*/
+	enum class FrameGraphFormat : uint8_t { RGBA8, RGBA16F, Depth24Stencil8 };
+
+	/** \enum FrameGraphAccess
+	*\brief how a pass uses a resource, the graph works out the transitions between them
+	*/
+	enum class FrameGraphAccess : uint8_t {
+		None, //!< Not used yet this frame
+		ColourTarget, //!< Rendered to as a colour attachment
+		DepthTarget, //!< Rendered to as the depth attachment
+		Sampled, //!< Read through a sampler
+		StorageRead, //!< Read as a shader storage buffer or image
+		StorageWrite, //!< Written as a shader storage buffer or image
+		Indirect //!< Read as draw indirect commands
+	};
+
+	namespace FrameGraphBarrier {
+		/** \enum Bits
+		*\brief memory barriers a pass needs before it runs, mapped onto the graphics API by the device
+		*/
+		enum Bits : uint32_t {
+			None = 0, //!< No barrier
+			Storage = 1 << 0, //!< Shader storage writes made visible to shader storage access
+			Command = 1 << 1, //!< Shader storage writes made visible to indirect draws
+			TextureFetch = 1 << 2, //!< Image writes made visible to sampling
+			Framebuffer = 1 << 3 //!< Image writes made visible to rendering
+		};
+	}
+
+	/** \struct FrameGraphTextureDesc
+	*\brief size and format of a frame graph texture, transient textures with equal descriptions can share memory
+	\param width uint32_t - width in pixels
+	\param height uint32_t - height in pixels
+	\param format FrameGraphFormat - storage format
+	*/
+	struct FrameGraphTextureDesc {
+		uint32_t width = 0; //!< Width
+		uint32_t height = 0; //!< Height
+		FrameGraphFormat format = FrameGraphFormat::RGBA8; //!< Format
+
+		inline bool operator==(const FrameGraphTextureDesc& other) const { return width == other.width && height == other.height && format == other.format; } //!< Same size and format
+	};
+
+	/** \struct FrameGraphResource
+	*\brief handle to one version of a resource, each write makes a new version
+	\param index uint32_t - index of the version in the graph
+	*/
+	struct FrameGraphResource {
+		uint32_t index = 0xFFFFFFFF; //!< Version index
+		inline bool isValid() const { return index != 0xFFFFFFFF; } //!< Was the handle made by a graph
+	};
+
+	/** \struct FrameGraphPassTiming
+	*\brief time taken by a pass, in seconds
+	\param name string - pass name
+	\param cpuTime float - time spent recording the pass this frame
+	\param gpuTime float - latest time the GPU took to run the pass, which lags a few frames behind, negative until one is available
+	*/
+	struct FrameGraphPassTiming {
+		std::string name; //!< Pass
+		float cpuTime; //!< CPU time
+		float gpuTime; //!< GPU time
+	};
+
+	/** \struct FrameGraphStats
+	*\brief counters of the last compiled and executed frame
+	\param passes uint32_t - passes declared
+	\param culledPasses uint32_t - passes dropped because nothing used their output
+	\param transientTextures uint32_t - transient textures used by the passes that ran
+	\param physicalTextures uint32_t - textures actually acquired once transients which never overlap share memory
+	\param targetBinds uint32_t - render target changes
+	\param barriers uint32_t - passes which needed a memory barrier
+	\param transitions uint32_t - changes in how a resource is accessed
+	*/
+	struct FrameGraphStats {
+		uint32_t passes = 0; //!< Passes
+		uint32_t culledPasses = 0; //!< Culled passes
+		uint32_t transientTextures = 0; //!< Transient textures
+		uint32_t physicalTextures = 0; //!< Acquired textures
+		uint32_t targetBinds = 0; //!< Render target changes
+		uint32_t barriers = 0; //!< Barriers
+		uint32_t transitions = 0; //!< Access changes
+	};
+
+	/**
+	\class FrameGraphDevice
+	\brief Graphics API side of a frame graph, creates the transient textures and applies targets, barriers and timers
+	*/
+	class FrameGraphDevice {
+	public:
+		virtual ~FrameGraphDevice() {}; //!< Default destructor
+
+		virtual uint32_t acquireTexture(const FrameGraphTextureDesc& desc) = 0; //!< Get a texture for the frame, pooled between frames
+		virtual void releaseTextures() = 0; //!< Return every texture acquired this frame to the pool
+		//! Render to a set of textures, texture 0 is the default framebuffer
+		/*!
+		\param colour const uint32_t* - colour attachments in order
+		\param colourCount uint32_t - number of colour attachments
+		\param depth uint32_t - depth attachment, 0 for none or the default framebuffer
+		\param desc const FrameGraphTextureDesc& - size of the targets
+		*/
+		virtual void bindRenderTargets(const uint32_t* colour, uint32_t colourCount, uint32_t depth, const FrameGraphTextureDesc& desc) = 0;
+		virtual void barrier(uint32_t barriers) = 0; //!< Issue FrameGraphBarrier bits
+		virtual void beginTimer(const std::string& pass) = 0; //!< Start timing a pass on the GPU
+		virtual void endTimer() = 0; //!< Stop timing the current pass
+		virtual float getGPUTime(const std::string& pass) = 0; //!< Latest finished GPU time of a pass in seconds, negative when none is ready
+	};
+
+	class FrameGraph;
+
+	/**
+	\class FrameGraphBuilder
+	\brief Declares the resources a pass reads and writes, handed to the setup function of a pass
+	*/
+	class FrameGraphBuilder {
+	private:
+		FrameGraph& m_graph; //!< Graph being built
+		uint32_t m_pass; //!< Pass being declared
+	public:
+		FrameGraphBuilder(FrameGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {} //!< Constructor
+
+		FrameGraphResource create(const std::string& name, const FrameGraphTextureDesc& desc); //!< Create a transient texture, its contents are undefined until this pass writes it
+		FrameGraphResource read(FrameGraphResource resource, FrameGraphAccess access = FrameGraphAccess::Sampled); //!< Read a resource, returns the same version
+		FrameGraphResource write(FrameGraphResource resource, FrameGraphAccess access = FrameGraphAccess::ColourTarget); //!< Write a resource, keeping its contents, returns the new version
+		void sideEffect(); //!< Never cull the pass even if nothing reads what it writes
+	};
+
+	/**
+	\class FrameGraphPassResources
+	\brief Resolves handles to API objects while a pass executes
+	*/
+	class FrameGraphPassResources {
+	private:
+		const FrameGraph& m_graph; //!< Executing graph
+	public:
+		FrameGraphPassResources(const FrameGraph& graph) : m_graph(graph) {} //!< Constructor
+
+		uint32_t get(FrameGraphResource resource) const; //!< Get the texture or buffer behind a handle
+		const FrameGraphTextureDesc& getDesc(FrameGraphResource resource) const; //!< Get the description of a texture
+	};
+
+	using FrameGraphExecute = std::function<void(const FrameGraphPassResources&)>; //!< Records the work of a pass
+
+	/**
+	\class FrameGraph
+	\brief Passes declared with the resources they read and write, culled, ordered and executed once per frame
+	*
+	* Build the graph each frame with addPass(), then compile() and execute(). Passes whose output reaches no imported
+	* resource and which have no side effects are culled. The rest run in an order which respects every read after
+	* write, write after read and write after write, choosing among ready passes the one rendering to the targets
+	* already bound. Transient textures live from their first to their last use, and transients with the same
+	* description whose lifetimes do not overlap share one texture. Memory barriers are issued only when the access to
+	* a resource after a storage write needs one, and targets are only rebound when they change.
+	*/
+	class FrameGraph {
+		friend class FrameGraphBuilder;
+		friend class FrameGraphPassResources;
+	private:
+		constexpr static int32_t none = -1; //!< No pass, use or texture
+
+		/** \struct Resource
+		*\brief a texture or buffer, shared by all of its versions
+		*/
+		struct Resource {
+			std::string name; //!< Name
+			FrameGraphTextureDesc desc; //!< Texture description, unused for buffers
+			bool imported; //!< Owned outside the graph
+			uint32_t external; //!< API object of an imported resource
+			int32_t firstUse; //!< Position of the first pass to use it in the execution order
+			int32_t lastUse; //!< Position of the last pass to use it
+			int32_t physical; //!< Shared texture of a transient
+			uint32_t object; //!< API object for this frame
+		};
+
+		/** \struct Version
+		*\brief a resource as produced by one write
+		*/
+		struct Version {
+			uint32_t resource; //!< Resource
+			int32_t producer; //!< Pass which wrote it, none for the version made by create or import
+			std::vector<uint32_t> readers; //!< Passes which read it
+		};
+
+		/** \struct Access
+		*\brief a read or write of a pass
+		*/
+		struct Access {
+			uint32_t version; //!< Version read, or written
+			uint32_t previous; //!< Version a write builds on, the same as version for reads
+			FrameGraphAccess access; //!< How it is used
+			bool write; //!< Is it a write
+		};
+
+		/** \struct Pass
+		*\brief a declared pass and what compiling found out about it
+		*/
+		struct Pass {
+			std::string name; //!< Name
+			std::vector<Access> accesses; //!< Reads and writes in declaration order
+			FrameGraphExecute execute; //!< Work
+			bool sideEffect; //!< Keep even when unused
+			bool alive; //!< Survived culling
+			bool bindTargets; //!< Are its targets different from the ones bound before it
+			uint32_t barriers; //!< FrameGraphBarrier bits needed before it
+		};
+
+		std::vector<Resource> m_resources; //!< Resources
+		std::vector<Version> m_versions; //!< Versions
+		std::vector<Pass> m_passes; //!< Passes in declaration order
+		std::vector<uint32_t> m_order; //!< Alive passes in execution order
+		std::vector<FrameGraphTextureDesc> m_physical; //!< Description of each shared transient texture
+		std::vector<FrameGraphPassTiming> m_timings; //!< Timings of the last execute
+		FrameGraphStats m_stats; //!< Counters of the last frame
+		bool m_compiled = false; //!< Has the graph been compiled since the last change
+
+		uint32_t addVersion(uint32_t resource, int32_t producer); //!< Add a version of a resource
+		void cull(); //!< Mark the passes that contribute to an imported resource or have side effects
+		void order(); //!< Topologically sort the alive passes
+		void allocate(); //!< Find lifetimes and share transient textures
+		void transition(); //!< Find barriers and render target changes
+		void getTargets(const Pass& pass, std::vector<uint32_t>& targets) const; //!< Resources a pass renders to
+	public:
+		FrameGraph() = default; //!< Default constructor
+
+		void reset(); //!< Remove every pass and resource, keeping the storage for the next frame
+
+		FrameGraphResource importTexture(const std::string& name, const FrameGraphTextureDesc& desc, uint32_t texture); //!< Use a texture owned elsewhere, 0 is the default framebuffer
+		FrameGraphResource importBuffer(const std::string& name, uint32_t buffer); //!< Use a buffer owned elsewhere
+
+		//! Declare a pass
+		/*!
+		\param name const std::string& - name, used for timings
+		\param setup function - declares the pass's resources and returns the function recording its work
+		\return uint32_t - index of the pass
+		*/
+		uint32_t addPass(const std::string& name, const std::function<FrameGraphExecute(FrameGraphBuilder&)>& setup);
+
+		void compile(); //!< Cull, order, allocate and find transitions
+		void execute(FrameGraphDevice& device); //!< Run the compiled passes, compiling first if needed
+
+		inline const std::vector<uint32_t>& getOrder() const { return m_order; } //!< Get the passes in execution order
+		inline const std::string& getPassName(uint32_t pass) const { return m_passes[pass].name; } //!< Get the name of a pass
+		inline bool isCulled(uint32_t pass) const { return !m_passes[pass].alive; } //!< Was a pass culled
+		inline uint32_t getBarriers(uint32_t pass) const { return m_passes[pass].barriers; } //!< Get the barriers issued before a pass
+		int32_t getPhysicalTexture(FrameGraphResource resource) const; //!< Get the shared texture a transient was given, -1 if it is unused or not transient
+		inline const std::vector<FrameGraphPassTiming>& getTimings() const { return m_timings; } //!< Get the timings of the last execute
+		inline const FrameGraphStats& getStats() const { return m_stats; } //!< Get the counters of the last frame
+	};
+}
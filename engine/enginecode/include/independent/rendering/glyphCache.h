@@ -0,0 +1,109 @@
+/** \file glyphCache.h */
+#pragma once
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <string>
+#include "rendering/textureAtlas.h"
+#include "ft2build.h"
+#include "freetype/freetype.h"
+
+namespace Engine {
+	/** \struct GlyphData
+	*\brief properties for the character glyph
+	\param size vec2 - size of the character
+	\param bearing vec2 - bearing of the character glyph
+	\param advance float - offset value for the character
+	\param texture shared_ptr<SubTexture> - texture for the glyph
+	*/
+	struct GlyphData {
+		glm::vec2 size; //!< Size of the character 
+		glm::vec2 bearing; //!< Bearing of the character
+		float advance; //!< Advance of the character
+		std::shared_ptr<SubTexture> subTexture; //!< Texture for the character
+	};
+
+	/** \struct GlyphCacheStats
+	*\brief counters for the glyph cache
+	\param hits uint64_t - lookups answered from the cache
+	\param misses uint64_t - lookups which had to rasterize the glyph
+	\param evictions uint64_t - glyphs evicted to make space
+	\param repacks uint32_t - times the atlas was repacked
+	*/
+	struct GlyphCacheStats {
+		uint64_t hits = 0; //!< Cache hits
+		uint64_t misses = 0; //!< Cache misses
+		uint64_t evictions = 0; //!< Evicted glyphs
+		uint32_t repacks = 0; //!< Atlas repacks
+	};
+
+	/** \enum GlyphRenderMode
+	*\brief What the glyph cache stores in the atlas
+	*/
+	enum class GlyphRenderMode {
+		Bitmap, //!< FreeType coverage at the display size
+		SDF //!< Signed distance field at a small base size, scaled to any size in the shader
+	};
+
+	/**
+	\class GlyphCache
+	* \brief Rasterizes glyphs with FreeType on first use into a texture atlas, evicting the least recently used glyphs when it is full
+	*
+	* Glyphs used in the current frame are never evicted, and evicted sub textures are kept alive until the next frame
+	* so quads already submitted can still point at them.
+	*/
+	class GlyphCache {
+	private:
+		/** \struct Entry
+		*\brief a cached glyph
+		\param glyph GlyphData - metrics and atlas location
+		\param bitmap vector<unsigned char> - coverage or distance field of the glyph, kept so the atlas can be repacked
+		\param width uint32_t - width of the bitmap
+		\param height uint32_t - height of the bitmap
+		\param lru list<uint32_t>::iterator - position in the LRU list
+		\param lastFrame uint64_t - last frame the glyph was used in
+		*/
+		struct Entry {
+			GlyphData glyph; //!< Glyph
+			std::vector<unsigned char> bitmap; //!< Coverage or distance, one byte per pixel
+			uint32_t width; //!< Bitmap width
+			uint32_t height; //!< Bitmap height
+			std::list<uint32_t>::iterator lru; //!< Position in the LRU list
+			uint64_t lastFrame; //!< Last frame used
+		};
+
+		FT_Face m_font = nullptr; //!< Font glyphs are rasterized from
+		GlyphRenderMode m_mode; //!< Coverage or distance field
+		uint32_t m_spread; //!< Distance in pixels the field reaches outside the glyph
+		float m_metricScale = 1.f; //!< Rasterized size to display size
+		TextureAtlas m_atlas; //!< Single channel atlas holding the glyphs
+		std::unordered_map<uint32_t, Entry> m_entries; //!< Glyphs keyed by codepoint
+		std::list<uint32_t> m_lru; //!< Codepoints, most recently used at the front
+		std::vector<std::shared_ptr<SubTexture>> m_retired; //!< Evicted sub textures, released at the next frame
+		std::function<void()> m_beforeRepack; //!< Called before the atlas contents move
+		std::function<FT_Face()> m_fontLoader; //!< Loads the font on the first miss when no font is set
+		GlyphCacheStats m_stats; //!< Counters
+		uint64_t m_frame = 0; //!< Current frame
+
+		bool place(Entry& entry); //!< Put the glyph bitmap into the atlas
+		bool evictAndRepack(); //!< Evict least recently used glyphs and repack the rest, false when nothing could be evicted
+	public:
+		GlyphCache(glm::ivec2 atlasSize = { 4096, 4096 }, GlyphRenderMode mode = GlyphRenderMode::Bitmap, uint32_t spread = 4); //!< Constructor with the atlas size and what to store in it
+		void setFont(FT_Face font, float metricScale = 1.f); //!< Set the font, dropping every cached glyph, metrics are multiplied by metricScale
+		inline GlyphRenderMode getMode() const { return m_mode; } //!< Get what the cache stores
+		inline void setRepackCallback(const std::function<void()>& callback) { m_beforeRepack = callback; } //!< Set the function called before glyphs move in the atlas
+		inline void setFontLoader(const std::function<FT_Face()>& loader) { m_fontLoader = loader; } //!< Set the function which loads the font on the first miss, so FreeType is only started when needed
+		bool save(const std::string& filepath, uint64_t fontHash, uint32_t pixelSize) const; //!< Bake the metrics and atlas pixels of every cached glyph to a file
+		bool load(const std::string& filepath, uint64_t fontHash, uint32_t pixelSize); //!< Replace the cache with a baked file, false when it is missing or was baked from another font, size or mode
+		const GlyphData* get(uint32_t codepoint); //!< Get a glyph, rasterizing it on a miss, null when it can not be rasterized or placed
+		void nextFrame(); //!< Start a new frame
+		inline uint32_t getGlyphCount() const { return static_cast<uint32_t>(m_entries.size()); } //!< Get the number of cached glyphs
+		inline const GlyphCacheStats& getStats() const { return m_stats; } //!< Get the counters
+		inline std::shared_ptr<OpenGLTexture> getBaseTexture() const { return m_atlas.getBaseTexture(); } //!< Get the atlas texture
+		static uint64_t hashFile(const char* filepath); //!< FNV-1a hash of a file's bytes, zero when it can not be read
+		static uint32_t decodeUTF8(const char*& text, const char* end); //!< Decode one codepoint and advance text, invalid sequences give U+FFFD
+		static void generateSDF(const unsigned char* coverage, uint32_t width, uint32_t height, uint32_t spread, std::vector<unsigned char>& result); //!< Signed distance field of a coverage bitmap, padded by spread on every side, 128 on the edge
+	};
+}
@@ -0,0 +1,102 @@
+/** \file lightClusters.h */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "rendering/culling.h"
+
+namespace Engine {
+	/** \struct Light
+	*\brief point or spot light, laid out to match a std430 { vec4; vec4; vec4; } block
+	\param position vec4 - world position (xyz) and range (w)
+	\param colour vec4 - colour (rgb) and intensity (a)
+	\param direction vec4 - spot direction (xyz) and cosine of the outer cone angle (w), -1 for point lights
+	*/
+	struct Light {
+		glm::vec4 position; //!< Position and range
+		glm::vec4 colour; //!< Colour and intensity
+		glm::vec4 direction; //!< Spot direction and cone cosine
+
+		static Light point(const glm::vec3& position, float range, const glm::vec3& colour, float intensity = 1.f); //!< Make a point light
+		static Light spot(const glm::vec3& position, const glm::vec3& direction, float range, float angle, const glm::vec3& colour, float intensity = 1.f); //!< Make a spot light, angle is the outer half angle in radians
+		glm::vec4 getBoundingSphere() const; //!< World space sphere enclosing everything the light reaches
+	};
+
+	/** \struct LightCluster
+	*\brief range of a cluster's lights in the light index list, laid out to match a std430 uvec2
+	\param offset uint32_t - first entry in the light index list
+	\param count uint32_t - number of lights
+	*/
+	struct LightCluster {
+		uint32_t offset; //!< First index
+		uint32_t count; //!< Number of lights
+	};
+
+	/** \struct ClusterHeader
+	*\brief grid description read by clustered shaders ahead of the clusters, laid out to match a std430 { uvec4; vec4; } block
+	\param grid uvec4 - clusters along x, y and z, light count in w
+	\param depth vec4 - near plane, far plane, slices per unit of log depth, unused
+	*/
+	struct ClusterHeader {
+		glm::uvec4 grid; //!< Grid size and light count
+		glm::vec4 depth; //!< Depth slicing
+	};
+
+	/**
+	\class LightClusters
+	\brief bins lights into a grid of view space clusters, screen tiles in x and y and exponential depth slices in z
+	*
+	* Lights are bounded by spheres and each is tested against the view space boxes of the clusters its sphere projects
+	* onto. Depth slices are split between threads so each thread writes its own clusters, which keeps the light order
+	* within a cluster the same as the submission order.
+	*/
+	class LightClusters {
+	private:
+		/** \struct LightRange
+		*\brief view space sphere of a light and the clusters it may touch
+		*/
+		struct LightRange {
+			glm::vec4 sphere; //!< View space centre and radius
+			uint32_t min[3]; //!< First cluster on each axis
+			uint32_t max[3]; //!< Last cluster on each axis
+			bool visible; //!< Does the sphere touch the frustum at all
+		};
+
+		glm::uvec3 m_grid; //!< Clusters along each axis
+		glm::mat4 m_projection = glm::mat4(0.f); //!< Projection the cluster boxes were built for
+		float m_near = 0.f; //!< Near plane
+		float m_far = 0.f; //!< Far plane
+		float m_sliceScale = 0.f; //!< Depth slices per unit of log depth
+		std::vector<AABB> m_clusterBounds; //!< View space box of every cluster
+		std::vector<LightRange> m_lightRanges; //!< Per light binning input
+		std::vector<std::vector<uint32_t>> m_clusterLights; //!< Lights of every cluster while binning
+		std::vector<LightCluster> m_clusters; //!< Offset and count of every cluster
+		std::vector<uint32_t> m_lightIndices; //!< Lights of every cluster, cluster after cluster
+
+		void buildClusterBounds(const glm::mat4& projection); //!< Rebuild the cluster boxes for a projection
+		uint32_t slice(float depth) const; //!< Depth slice of a view depth
+		void rangeLight(const Light& light, const glm::mat4& view, LightRange& range) const; //!< Find the clusters a light may touch
+		void binSlices(uint32_t firstSlice, uint32_t lastSlice); //!< Bin every light into the clusters of a range of slices
+	public:
+		LightClusters(const glm::uvec3& grid = glm::uvec3(16, 9, 24)); //!< Constructor
+
+		//! Bin lights into clusters
+		/*!
+		\param lights Light* - world space lights
+		\param count uint32_t - number of lights
+		\param view mat4 - view matrix
+		\param projection mat4 - perspective projection matrix
+		\param threadCount uint32_t - threads to bin on, 0 for every core
+		*/
+		void bin(const Light* lights, uint32_t count, const glm::mat4& view, const glm::mat4& projection, uint32_t threadCount = 0);
+
+		inline uint32_t getClusterCount() const { return m_grid.x * m_grid.y * m_grid.z; } //!< Get the number of clusters
+		inline uint32_t getClusterIndex(uint32_t x, uint32_t y, uint32_t z) const { return (z * m_grid.y + y) * m_grid.x + x; } //!< Get the index of a cluster
+		inline const AABB& getClusterBounds(uint32_t cluster) const { return m_clusterBounds[cluster]; } //!< Get the view space box of a cluster
+		inline const std::vector<LightCluster>& getClusters() const { return m_clusters; } //!< Get the offset and count of every cluster
+		inline const std::vector<uint32_t>& getLightIndices() const { return m_lightIndices; } //!< Get the light index list
+		ClusterHeader getHeader(uint32_t lightCount) const; //!< Get the grid description for shaders
+		static bool intersects(const glm::vec4& sphere, const AABB& box); //!< Does a sphere touch a box
+	};
+}
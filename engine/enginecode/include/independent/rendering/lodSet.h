@@ -0,0 +1,88 @@
+/** \file lodSet.h */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "platform/OpenGL/OpenGLVertexArray.h"
+#include "platform/OpenGL/OpenGLGeometryArena.h"
+
+namespace Engine {
+	class Material;
+
+	/** \struct LODLevel
+	*\brief one level of detail, the geometry and optional material drawn while an object covers at least screenSize of the screen
+	\param geometry shared_ptr<OpenGLVertexArray> - geometry, nullptr to draw mesh
+	\param mesh ArenaMesh - arena mesh, when geometry is nullptr
+	\param material shared_ptr<Material> - cheaper material for this level, nullptr keeps the material the set is submitted with
+	\param screenSize float - smallest projected height, as a fraction of the screen height, the level is drawn at
+	*/
+	struct LODLevel {
+		std::shared_ptr<OpenGLVertexArray> geometry; //!< Geometry
+		ArenaMesh mesh; //!< Arena mesh
+		std::shared_ptr<Material> material; //!< Level material
+		float screenSize = 0.f; //!< Smallest screen size
+
+		uint32_t getTriangleCount() const; //!< Triangles drawn by the level
+		const BoundingVolume& getBounds() const; //!< Local bounds of the level's geometry
+	};
+
+	/** \struct LODState
+	*\brief per object selection kept between frames for hysteresis and cross-fading
+	\param level uint32_t - level drawn, the level count when the object is too small to draw, none before the first selection
+	\param previous uint32_t - level fading out
+	\param fade float - cross-fade progress of level, 1 when not fading
+	*/
+	struct LODState {
+		constexpr static uint32_t none = 0xFFFFFFFF; //!< No level selected yet
+		uint32_t level = none; //!< Level drawn
+		uint32_t previous = none; //!< Level fading out
+		float fade = 1.f; //!< Cross-fade progress
+	};
+
+	/**
+	\class LODSet
+	\brief levels of detail of one object, finest first
+	*
+	* A level is kept until the screen size passes the next threshold by the hysteresis fraction, so objects sitting on a
+	* threshold do not switch every frame. With fade frames set, a change draws both levels with complementary dither masks
+	* for that many frames; shaders without u_fade or a_drawId drop the outgoing level instead.
+	*/
+	class LODSet {
+	private:
+		std::vector<LODLevel> m_levels; //!< Levels, finest first
+		float m_hysteresis; //!< Fraction a threshold must be passed by before switching
+		uint32_t m_fadeFrames; //!< Frames to cross-fade over, 0 to switch immediately
+	public:
+		constexpr static uint32_t maxLevels = 8; //!< Most levels in a set, sizes the per level stats
+
+		LODSet(float hysteresis = 0.1f, uint32_t fadeFrames = 0) : m_hysteresis(hysteresis), m_fadeFrames(fadeFrames) {} //!< Constructor
+		void addLevel(const LODLevel& level); //!< Add the next coarser level, its screen size must be below the previous level's
+
+		uint32_t select(float screenSize, uint32_t current) const; //!< Level for a screen size given the current level, the level count when too small to draw
+		void update(float screenSize, LODState& state) const; //!< Select a level and advance the cross-fade, call once per frame per object
+
+		inline uint32_t getLevelCount() const { return static_cast<uint32_t>(m_levels.size()); } //!< Get the number of levels
+		inline const LODLevel& getLevel(uint32_t level) const { return m_levels[level]; } //!< Get a level
+		inline const BoundingVolume& getBounds() const { return m_levels[0].getBounds(); } //!< Bounds used for selection, those of the finest level
+
+		//! Projected height of a world space sphere as a fraction of the screen height
+		/*!
+		\param sphere vec4 - world space centre and radius
+		\param view mat4 - view matrix
+		\param projection mat4 - perspective projection matrix
+		*/
+		static float projectedSize(const glm::vec4& sphere, const glm::mat4& view, const glm::mat4& projection);
+
+		//! Move a LOD bias towards holding a frame time budget, coarser while over it and back towards 0 while under
+		/*!
+		\param bias float - current bias
+		\param frameTime float - time of the last frame in seconds
+		\param budget float - target frame time in seconds
+		\param rate float - bias change per frame at twice the budget
+		\param maxBias float - largest bias returned
+		*/
+		static float adjustBias(float bias, float frameTime, float budget, float rate = 0.05f, float maxBias = 2.f);
+	};
+}
@@ -0,0 +1,99 @@
+/** \file occlusionCuller.h */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "rendering/culling.h"
+
+namespace Engine {
+	/** \struct OcclusionStats
+	*\brief counters for the last frame of an OcclusionCuller
+	\param occluderTriangles uint32_t - occluder triangles rasterized
+	\param tested uint32_t - boxes tested against the depth hierarchy
+	\param occluded uint32_t - boxes found hidden
+	*/
+	struct OcclusionStats {
+		uint32_t occluderTriangles = 0; //!< Triangles rasterized
+		uint32_t tested = 0; //!< Boxes tested
+		uint32_t occluded = 0; //!< Boxes hidden
+	};
+
+	/**
+	\class OcclusionCuller
+	\brief software occlusion culling, occluders are rasterized into a small depth buffer which boxes are tested against
+	*
+	* Occluder triangles are set up and binned into 32x32 pixel tiles, then tiles are rasterized across threads four pixels
+	* at a time with SSE, keeping the nearest depth. A max depth mip chain is built over the result so a box is tested
+	* against at most 4x4 texels: it is hidden when its nearest depth is behind the furthest occluder depth under it.
+	* Triangles crossing the near plane are skipped, which can only make the culler keep more.
+	*/
+	class OcclusionCuller {
+	private:
+		/** \struct Occluder
+		*\brief occluder geometry recorded for the frame, the data must stay alive until rasterize()
+		*/
+		struct Occluder {
+			const unsigned char* vertices; //!< Position of the first vertex
+			uint32_t vertexCount; //!< Number of vertices
+			uint32_t stride; //!< Bytes between vertices
+			const uint32_t* indices; //!< Triangle list indices
+			uint32_t indexCount; //!< Number of indices
+			glm::mat4 model; //!< Model matrix
+		};
+
+		/** \struct Triangle
+		*\brief screen space triangle ready to rasterize
+		*/
+		struct Triangle {
+			float edges[3][3]; //!< A, B, C of each edge function, positive inside
+			float depth[3]; //!< Depth plane, depth = [0] * x + [1] * y + [2]
+			int32_t minX, maxX, minY, maxY; //!< Pixel bounds, inclusive
+		};
+
+		uint32_t m_width; //!< Depth buffer width, a multiple of the tile size
+		uint32_t m_height; //!< Depth buffer height, a multiple of the tile size
+		uint32_t m_tilesX; //!< Tiles across
+		uint32_t m_tilesY; //!< Tiles down
+		glm::mat4 m_viewProjection = glm::mat4(1.f); //!< View projection of the frame
+		std::vector<Occluder> m_occluders; //!< Occluders of the frame
+		std::vector<glm::vec4> m_clip; //!< Clip space positions of the occluder being set up
+		std::vector<Triangle> m_triangles; //!< Set up triangles
+		std::vector<std::vector<uint32_t>> m_tileTriangles; //!< Triangles overlapping each tile
+		std::vector<std::vector<float>> m_levels; //!< Depth buffer followed by its max depth mips
+		OcclusionStats m_stats; //!< Counters
+
+		void setup(const Occluder& occluder); //!< Transform an occluder, clip its triangles against the near plane and bin them into tiles
+		void addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c); //!< Project a triangle in front of the near plane and bin it into tiles
+		void rasterizeTile(uint32_t tile); //!< Rasterize every triangle binned into a tile
+		void buildHierarchy(); //!< Build the max depth mips
+	public:
+		constexpr static uint32_t tileSize = 32; //!< Tile width and height in pixels
+
+		OcclusionCuller(uint32_t width = 256, uint32_t height = 128); //!< Constructor, the size is rounded up to whole tiles
+
+		void begin(const glm::mat4& viewProjection); //!< Start a frame, dropping last frame's occluders
+		//! Add occluder geometry, kept by pointer until rasterize()
+		/*!
+		\param vertices void* - vertex data
+		\param vertexCount uint32_t - number of vertices
+		\param stride uint32_t - bytes between vertices
+		\param offset uint32_t - byte offset of the three float position in each vertex
+		\param indices uint32_t* - triangle list indices
+		\param indexCount uint32_t - number of indices
+		\param model mat4 - model matrix
+		*/
+		void addOccluder(const void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t offset, const uint32_t* indices, uint32_t indexCount, const glm::mat4& model);
+		void rasterize(uint32_t threadCount = 0); //!< Rasterize every occluder and build the depth hierarchy, threadCount 0 uses every core
+
+		bool isVisible(const AABB& box); //!< Is any part of a world space box possibly in front of the occluders
+		uint32_t testVisibility(const AABB* boxes, uint32_t count, uint8_t* visible); //!< Test boxes, setting visible to 1 or 0, returns the number visible
+
+		inline bool hasOccluders() const { return !m_occluders.empty(); } //!< Were any occluders added this frame
+		inline uint32_t getWidth() const { return m_width; } //!< Get the depth buffer width
+		inline uint32_t getHeight() const { return m_height; } //!< Get the depth buffer height
+		inline uint32_t getLevelCount() const { return static_cast<uint32_t>(m_levels.size()); } //!< Get the number of levels, the depth buffer included
+		inline const std::vector<float>& getLevel(uint32_t level) const { return m_levels[level]; } //!< Get a level, row 0 at the bottom of the screen
+		inline const OcclusionStats& getStats() const { return m_stats; } //!< Get the counters for the frame
+	};
+}
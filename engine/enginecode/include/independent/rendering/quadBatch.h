@@ -0,0 +1,82 @@
+/** \file quadBatch.h */
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace Engine {
+	class Renderer2DVertex;
+	class Renderer2DInstance;
+	class SubTexture;
+
+	/** \struct QuadInstance
+	*\brief compact description of one quad for bulk submission
+	\param translate vec2 - centre of the quad
+	\param scale vec2 - full width and height of the quad
+	\param rotation vec2 - precomputed cosine and sine of the rotation angle
+	\param tint vec4 - tint ( Colour / Albedo ) for the quad
+	\param texture SubTexture* - texture for the quad, nullptr for the default white texture
+	*/
+	struct QuadInstance {
+		glm::vec2 translate = glm::vec2(0.f); //!< Centre of the quad
+		glm::vec2 scale = glm::vec2(1.f); //!< Width and height of the quad
+		glm::vec2 rotation = glm::vec2(1.f, 0.f); //!< Cosine and sine of the rotation
+		glm::vec2 padding = glm::vec2(0.f); //!< Keeps the tint on a 16 byte boundary
+		glm::vec4 tint = glm::vec4(1.f); //!< Tint ( Colour / Albedo )
+		const SubTexture* texture = nullptr; //!< Texture, not owned by the instance
+
+		inline void setRotation(float angle) { rotation = { std::cos(angle), std::sin(angle) }; } //!< Precompute the rotation from an angle in radians
+	};
+
+	namespace QuadBatch {
+		//! Expand quads into four Renderer2DVertex each, one quad at a time with 4x4 matrices
+		/*!
+		\param quads QuadInstance* - quads to expand
+		\param texUnits uint32_t* - texture unit of each quad
+		\param uvRects vec4* - UV start (xy) and end (zw) of each quad
+		\param count uint32_t - number of quads
+		\param out Renderer2DVertex* - destination, count * 4 vertices
+		*/
+		void writeVerticesScalar(const QuadInstance* quads, const uint32_t* texUnits, const glm::vec4* uvRects, uint32_t count, Renderer2DVertex* out);
+
+		//! Expand quads into four Renderer2DVertex each, four quads at a time with SSE
+		/*!
+		\param quads QuadInstance* - quads to expand
+		\param texUnits uint32_t* - texture unit of each quad
+		\param uvRects vec4* - UV start (xy) and end (zw) of each quad
+		\param count uint32_t - number of quads
+		\param out Renderer2DVertex* - destination, count * 4 vertices
+		*/
+		void writeVertices(const QuadInstance* quads, const uint32_t* texUnits, const glm::vec4* uvRects, uint32_t count, Renderer2DVertex* out);
+
+		//! Pack quads into one Renderer2DInstance each
+		/*!
+		\param quads QuadInstance* - quads to pack
+		\param texUnits uint32_t* - texture unit of each quad
+		\param uvRects vec4* - UV start (xy) and end (zw) of each quad
+		\param count uint32_t - number of quads
+		\param out Renderer2DInstance* - destination, count instances
+		*/
+		void writeInstances(const QuadInstance* quads, const uint32_t* texUnits, const glm::vec4* uvRects, uint32_t count, Renderer2DInstance* out);
+
+		constexpr uint32_t maxSortSegment = 0xFF; //!< Last strict order segment, later toggles share it
+		constexpr uint32_t maxSortIndex = 0x7FFFFF; //!< Last submission index with its own place in the key
+
+		//! Sort key of a deferred quad, ascending keys are drawn first
+		/*!
+		* From the top: layer (16 bits), segment (8 bits), blend class (1 bit), texture (16 bits), submission index (23 bits).
+		* Every toggle of strict order starts a new segment, so quads never move across the point strict order was turned
+		* on or off. Inside a segment opaque quads draw before translucent ones and each class is grouped by texture, while
+		* strict quads ignore blend class and texture so only their submission index orders them.
+		\param layer int32_t - layer, clamped to 16 bits
+		\param segment uint32_t - strict order segment, clamped to maxSortSegment
+		\param translucent bool - does the quad blend with what is behind it
+		\param strict bool - keep submission order
+		\param texture uint32_t - texture ID, only the low 16 bits are used
+		\param index uint32_t - submission index, clamped to maxSortIndex
+		\return uint64_t - key for radixSort
+		*/
+		uint64_t sortKey(int32_t layer, uint32_t segment, bool translucent, bool strict, uint32_t texture, uint32_t index);
+	}
+}
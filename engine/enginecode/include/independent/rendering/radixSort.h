@@ -0,0 +1,24 @@
+/** \file radixSort.h */
+#pragma once
+
+#include <cstdint>
+
+namespace Engine {
+	/** \struct SortEntry
+	*\brief a 64 bit sort key and the index of the item it belongs to
+	\param key uint64_t - key to sort on, ascending
+	\param index uint32_t - index of the item in its own array
+	*/
+	struct SortEntry {
+		uint64_t key; //!< Sort key
+		uint32_t index; //!< Item index
+	};
+
+	//! Stable LSD radix sort of entries by key, eight bits per pass, passes where every key shares the byte are skipped
+	/*!
+	\param entries SortEntry* - entries to sort, sorted in place
+	\param scratch SortEntry* - scratch space for count entries
+	\param count uint32_t - number of entries
+	*/
+	void radixSort(SortEntry* entries, SortEntry* scratch, uint32_t count);
+}
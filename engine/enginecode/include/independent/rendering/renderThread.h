@@ -0,0 +1,138 @@
+/** \file renderThread.h */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Engine {
+	/**
+	\class FramePacket
+	\brief Everything the game thread recorded for one frame, executed in order on the render thread
+	*
+	* Commands and snapshots live in a linear arena which is rewound, not freed, between frames. Anything a command
+	* reads must either be captured by value, snapshotted into the packet, or be left untouched by the game thread
+	* until the packet has executed.
+	*/
+	class FramePacket {
+	private:
+		/** \struct Command
+		*\brief a recorded callable in the arena
+		\param object void* - the callable
+		\param execute void(*)(void*) - calls it
+		\param destroy void(*)(void*) - runs its destructor
+		*/
+		struct Command {
+			void* object; //!< Callable
+			void (*execute)(void*); //!< Invoke
+			void (*destroy)(void*); //!< Destruct
+		};
+
+		constexpr static size_t blockSize = 64 * 1024; //!< Bytes in each arena block
+
+		std::vector<std::unique_ptr<unsigned char[]>> m_blocks; //!< Arena blocks, kept between frames
+		std::vector<size_t> m_blockSizes; //!< Size of each block, larger than blockSize for oversized allocations
+		size_t m_block = 0; //!< Block being allocated from
+		size_t m_offset = 0; //!< Offset of the next allocation in the block
+		std::vector<Command> m_commands; //!< Commands in recording order
+
+		void* allocate(size_t size, size_t alignment); //!< Allocate from the arena
+	public:
+		FramePacket() = default; //!< Default constructor
+		FramePacket(const FramePacket&) = delete; //!< Packets hold raw arena memory, no copies
+		FramePacket& operator=(const FramePacket&) = delete; //!< Packets hold raw arena memory, no copies
+		~FramePacket(); //!< Destructor, destroys commands which never ran
+
+		//! Record a callable, run with no arguments on the render thread
+		template<typename F>
+		void enqueue(F&& function) {
+			using T = typename std::decay<F>::type;
+			void* memory = allocate(sizeof(T), alignof(T));
+			new (memory) T(std::forward<F>(function));
+			m_commands.push_back({ memory, [](void* object) { (*static_cast<T*>(object))(); }, [](void* object) { static_cast<T*>(object)->~T(); } });
+		}
+
+		//! Copy plain data into the packet, the copy lives until the packet is cleared
+		template<typename T>
+		T* snapshot(const T* data, size_t count = 1) {
+			static_assert(std::is_trivially_copyable<T>::value, "Snapshots are copied bytewise");
+			T* copy = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+			if (count > 0) memcpy(copy, data, sizeof(T) * count);
+			return copy;
+		}
+
+		//! Hand a resource to the render thread, it is released there once the commands before it have run
+		template<typename T>
+		void release(std::shared_ptr<T> resource) {
+			enqueue([resource]() mutable { resource.reset(); });
+		}
+
+		void execute(); //!< Run every command in order then clear the packet
+		void clear(); //!< Destroy every command without running it and rewind the arena
+		inline uint32_t getCommandCount() const { return static_cast<uint32_t>(m_commands.size()); } //!< Get the number of recorded commands
+	};
+
+	/** \struct RenderThreadStats
+	*\brief timings of the render thread, in seconds
+	\param frames uint64_t - packets executed
+	\param lastExecuteTime float - time the render thread spent executing the last packet
+	\param lastWaitTime float - time the game thread waited for the render thread at the last submit
+	*/
+	struct RenderThreadStats {
+		uint64_t frames = 0; //!< Packets executed
+		float lastExecuteTime = 0.f; //!< Last execute time
+		float lastWaitTime = 0.f; //!< Last game thread wait
+	};
+
+	/**
+	\class RenderThread
+	\brief Executes frame packets on a thread which owns the graphics context, one frame behind the game thread
+	*
+	* The game thread records frame N+1 into one packet while the render thread executes frame N from the other.
+	* submitFrame() waits for frame N to finish before handing over N+1, so the render thread is never more than one
+	* frame behind. Before start(), or after stop(), packets execute on the calling thread at submitFrame().
+	*/
+	class RenderThread {
+	private:
+		FramePacket m_packets[2]; //!< Double buffered packets
+		uint32_t m_recording = 0; //!< Index of the packet the game thread records into
+		std::thread m_thread; //!< Render thread
+		std::mutex m_mutex; //!< Guards the hand over
+		std::condition_variable m_condition; //!< Signals a packet handed over or finished
+		bool m_pending = false; //!< Has a packet been handed over which has not finished
+		bool m_stopping = false; //!< Should the thread finish its packet and exit
+		std::atomic<bool> m_running{ false }; //!< Is the render thread running
+		std::thread::id m_renderThreadID; //!< ID of the thread executing packets
+		RenderThreadStats m_stats; //!< Timings, written by the render thread under the mutex
+
+		void loop(const std::function<void()>& onStart, const std::function<void()>& onStop); //!< Body of the render thread
+		void waitIdle(std::unique_lock<std::mutex>& lock); //!< Wait until no packet is pending
+	public:
+		RenderThread() = default; //!< Default constructor
+		~RenderThread(); //!< Destructor, stops the thread
+
+		//! Start the render thread
+		/*!
+		\param onStart function - run first on the render thread, typically makes the graphics context current there
+		\param onStop function - run last on the render thread, typically releases the graphics context
+		*/
+		void start(const std::function<void()>& onStart = nullptr, const std::function<void()>& onStop = nullptr);
+		void stop(); //!< Finish the pending packet and join the thread, later packets execute on the calling thread
+		inline bool isRunning() const { return m_running; } //!< Is the render thread running
+		bool isRenderThread() const; //!< Is the calling thread the one executing packets
+
+		inline FramePacket& getPacket() { return m_packets[m_recording]; } //!< Get the packet being recorded
+		void submitFrame(); //!< Hand the recorded packet to the render thread and start recording the next one
+		void finish(); //!< Wait until every submitted packet has executed
+		RenderThreadStats getStats(); //!< Get the timings
+	};
+}
@@ -14,22 +14,43 @@ namespace Engine {
 	*/
 	struct SimpleRect { int32_t x, y, w, h; };
 
+	/** \struct AtlasPage
+	*\brief one texture of an atlas and its free spaces
+	\param texture shared_ptr<OpenGLTexture> - texture holding the pixels
+	\param spaces vector<SimpleRect> - free spaces in the page
+	\param channels uint32_t - channels of the page, 1 (R8 alpha), 2 (RG8 luminance alpha), 3 or 4
+	*/
+	struct AtlasPage {
+		std::shared_ptr<OpenGLTexture> texture; //!< Page texture
+		std::vector<SimpleRect> spaces; //!< Free spaces
+		uint32_t channels; //!< Channels stored in the page
+	};
+
 	/**
 	\class TextureAtlas
-	* \brief class to store textures to be rendered
+	* \brief class to store textures to be rendered, in one or more pages which each have their own format
 	*/
 	class TextureAtlas {
 	private:
-		std::vector<SimpleRect> m_spaces; //!< Spaces in the texture atlas
-		std::shared_ptr<OpenGLTexture> m_baseTexture; //!< Texture to hold subtexture pixel data
+		std::vector<AtlasPage> m_pages; //!< Pages, the first one is created with the atlas
+		glm::ivec2 m_pageSize; //!< Size of every page
+		uint32_t m_reservedSpaces; //!< Spaces reserved in each new page
+		uint32_t m_maxPages; //!< Pages the atlas may grow to
+
+		void addPage(uint32_t channels); //!< Create an empty page
+		bool add(AtlasPage& page, int32_t width, int32_t height, unsigned char* data, std::shared_ptr<SubTexture>& result); //!< Add subtexture to a page
 	public:
-		TextureAtlas(glm::ivec2 size = { 4096, 4096 }, uint32_t channels = 4, uint32_t reservedSpaces = 32); //!< Constructor with size and channels
-		bool add(const char* filepath, std::shared_ptr<SubTexture>& result); //!< Add subtexture from file
-		bool add(int32_t width, int32_t height, uint32_t channels, unsigned char* data, std::shared_ptr<SubTexture>& result); //!< Add subtexture from data
+		TextureAtlas(glm::ivec2 size = { 4096, 4096 }, uint32_t channels = 4, uint32_t reservedSpaces = 32, uint32_t maxPages = 1); //!< Constructor with page size, channels of the first page and the number of pages it may grow to
+		bool add(const char* filepath, std::shared_ptr<SubTexture>& result); //!< Add subtexture from file, converted to the channels of the first page
+		bool add(int32_t width, int32_t height, uint32_t channels, unsigned char* data, std::shared_ptr<SubTexture>& result); //!< Add subtexture from data to a page with the same channels, adding a page when none has space
+		bool addBlock(int32_t rows, uint32_t channels, unsigned char* data, std::shared_ptr<OpenGLTexture>& texture); //!< Upload full width rows to the top of an empty page in one call, the rows are then used
+		void clear(); //!< Mark every page as free, existing sub textures keep pointing at the old pixels until they are overwritten
 
-		inline uint32_t getChannels() const { return m_baseTexture->getChannels(); } //!< Get channels of the texture
-		inline uint32_t getID() const { return m_baseTexture->getRenderID(); } //!< Get render id
+		inline uint32_t getChannels() const { return m_pages.front().channels; } //!< Get channels of the first page
+		inline uint32_t getID() const { return m_pages.front().texture->getRenderID(); } //!< Get render id of the first page
 
-		inline std::shared_ptr<OpenGLTexture> getBaseTexture() const { return m_baseTexture; } //!< Get base texture
+		inline std::shared_ptr<OpenGLTexture> getBaseTexture() const { return m_pages.front().texture; } //!< Get texture of the first page
+		inline uint32_t getPageCount() const { return static_cast<uint32_t>(m_pages.size()); } //!< Get the number of pages
+		inline const AtlasPage& getPage(uint32_t index) const { return m_pages.at(index); } //!< Get a page
 	};
 }
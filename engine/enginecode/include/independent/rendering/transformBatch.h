@@ -0,0 +1,33 @@
+/** \file transformBatch.h */
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Engine {
+	/** \struct ObjectTransform
+	*\brief per object entry of the transform buffer, laid out to match a std430 { mat4; mat3; } block
+	\param model mat4 - model matrix
+	\param normal vec4[3] - columns of the normal matrix, w is padding
+	*/
+	struct ObjectTransform {
+		glm::mat4 model; //!< Model matrix
+		glm::vec4 normal[3]; //!< Normal matrix columns
+	};
+
+	namespace TransformBatch {
+		//! Fill in the normal matrix of each transform from its model matrix, one object at a time
+		/*!
+		\param transforms ObjectTransform* - transforms with their model matrix set
+		\param count uint32_t - number of transforms
+		*/
+		void writeNormalMatricesScalar(ObjectTransform* transforms, uint32_t count);
+
+		//! Fill in the normal matrix of each transform from its model matrix, four objects at a time with SSE
+		/*!
+		\param transforms ObjectTransform* - transforms with their model matrix set
+		\param count uint32_t - number of transforms
+		*/
+		void writeNormalMatrices(ObjectTransform* transforms, uint32_t count);
+	}
+}
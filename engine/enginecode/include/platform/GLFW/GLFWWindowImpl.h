@@ -20,6 +20,7 @@ namespace Engine {
 		virtual void close() override; //!< Close the window
 
 		virtual void onUpdate(float timestep) override; //!< Updates the logic while window is open
+		virtual void pollEvents() override; //!< Poll events without swapping
 		virtual void onResize(unsigned int width, unsigned int height) override; //!< Callback that fires  while window is being resized
 		virtual void setVSync(bool Vsync) override; //!< Set vSync
 		virtual void setEventCallback(const std::function<void(Event&)>& callback) override; //!< Set event callback
@@ -15,5 +15,7 @@ namespace Engine {
 		GLFW_OpenGL_GC(GLFWwindow* win) : m_window(win) {} //!< Constructor
 		virtual void init() override; //!< Initialize graphics context for given window
 		virtual void swapBuffers() override; //!< Swap the front and back buffer
+		virtual void makeCurrent() override; //!< Make the context current on the calling thread
+		virtual void releaseCurrent() override; //!< Detach the context from the calling thread
 	};
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+/** \file OpenGLFrameGraphDevice.h */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "rendering/frameGraph.h"
+#include "platform/OpenGL/OpenGLFramebuffer.h"
+
+namespace Engine {
+	/**
+	\class OpenGLFrameGraphDevice
+	\brief OpenGL implementation of a frame graph device
+	*
+	* Transient textures are pooled by description and deleted after going unused for a while. Framebuffers are made
+	* once per set of attachments and kept while their textures live. Pass times come from GL_TIME_ELAPSED queries,
+	* a few per pass in flight so reading them never stalls the pipeline.
+	*/
+	class OpenGLFrameGraphDevice : public FrameGraphDevice {
+	private:
+		constexpr static uint32_t queryLatency = 3; //!< Frames a timer query may be in flight
+		constexpr static uint32_t maxIdleFrames = 60; //!< Frames a pooled texture is kept without being used
+
+		/** \struct PooledTexture
+		*\brief a transient texture and whether this frame holds it
+		*/
+		struct PooledTexture {
+			FrameGraphTextureDesc desc; //!< Description
+			uint32_t id; //!< OpenGL ID
+			bool inUse; //!< Acquired this frame
+			uint32_t idleFrames; //!< Frames since it was last acquired
+		};
+
+		/** \struct CachedFramebuffer
+		*\brief framebuffer made for one set of attachments
+		*/
+		struct CachedFramebuffer {
+			std::vector<uint32_t> colour; //!< Colour attachments
+			uint32_t depth; //!< Depth attachment
+			std::shared_ptr<OpenGLFramebuffer> framebuffer; //!< Framebuffer
+		};
+
+		/** \struct PassTimer
+		*\brief ring of timer queries of one pass
+		*/
+		struct PassTimer {
+			uint32_t queries[queryLatency] = {}; //!< Queries
+			bool pending[queryLatency] = {}; //!< Issued and not read back
+			uint32_t next = 0; //!< Query the next frame uses
+			float latest = -1.f; //!< Latest result in seconds
+		};
+
+		std::vector<PooledTexture> m_textures; //!< Texture pool
+		std::vector<CachedFramebuffer> m_framebuffers; //!< Framebuffers
+		std::unordered_map<std::string, PassTimer> m_timers; //!< Timers by pass name
+		bool m_timing = false; //!< Is a query running
+
+		void poll(PassTimer& timer); //!< Read back every finished query of a timer
+		void deleteTexture(uint32_t id); //!< Delete a pooled texture and every framebuffer using it
+	public:
+		OpenGLFrameGraphDevice() = default; //!< Default constructor
+		~OpenGLFrameGraphDevice(); //!< Destructor
+
+		uint32_t acquireTexture(const FrameGraphTextureDesc& desc) override; //!< Get a texture for the frame
+		void releaseTextures() override; //!< Return the frame's textures to the pool
+		void bindRenderTargets(const uint32_t* colour, uint32_t colourCount, uint32_t depth, const FrameGraphTextureDesc& desc) override; //!< Bind a framebuffer for the targets and set the viewport
+		void barrier(uint32_t barriers) override; //!< Issue a memory barrier
+		void beginTimer(const std::string& pass) override; //!< Start a timer query
+		void endTimer() override; //!< End the timer query
+		float getGPUTime(const std::string& pass) override; //!< Latest finished time of a pass
+
+		inline uint32_t getPooledTextureCount() const { return static_cast<uint32_t>(m_textures.size()); } //!< Get the number of textures in the pool
+	};
+}
@@ -0,0 +1,29 @@
+/** \file OpenGLFramebuffer.h */
+#pragma once
+
+#include <cstdint>
+
+namespace Engine {
+	/**
+	\class OpenGLFramebuffer
+	\brief OpenGL implementation of a framebuffer rendering into existing textures
+	*/
+	class OpenGLFramebuffer {
+	private:
+		uint32_t m_OpenGL_ID; //!< OpenGL ID
+	public:
+		//! Constructor
+		/*!
+		\param colour const uint32_t* - textures attached as colour attachments 0 onwards
+		\param colourCount uint32_t - number of colour attachments
+		\param depth uint32_t - depth or depth stencil texture, 0 for none
+		\param stencil bool - is the depth texture a depth stencil format
+		*/
+		OpenGLFramebuffer(const uint32_t* colour, uint32_t colourCount, uint32_t depth, bool stencil);
+		~OpenGLFramebuffer(); //!< Destructor
+
+		void bind(); //!< Bind for drawing and reading
+		bool isComplete() const; //!< Can the framebuffer be rendered to
+		inline uint32_t getRenderID() const { return m_OpenGL_ID; } //!< Get OpenGL ID
+	};
+}
@@ -0,0 +1,91 @@
+/** \file OpenGLGeometryArena.h */
+#pragma once
+
+#include <vector>
+#include <memory>
+#include "OpenGLVertexArray.h"
+
+namespace Engine {
+	/** \struct ArenaMesh
+	*\brief a mesh sub-allocated from an OpenGLGeometryArena
+	\param bucket uint32_t - layout bucket, all meshes in a bucket share one vertex array
+	\param page uint32_t - page within the bucket holding the vertices and indices
+	\param baseVertex int32_t - first vertex of the mesh in the page
+	\param firstIndex uint32_t - first index of the mesh in the page
+	\param indexCount uint32_t - number of indices
+	\param bounds BoundingVolume - local space bounds, unbounded when the layout does not start with a three float position
+	*/
+	struct ArenaMesh {
+		uint32_t bucket = 0; //!< Layout bucket
+		uint32_t page = 0; //!< Page in the bucket
+		int32_t baseVertex = 0; //!< First vertex
+		uint32_t firstIndex = 0; //!< First index
+		uint32_t indexCount = 0; //!< Index count
+		BoundingVolume bounds; //!< Local space bounds
+	};
+
+	/** \struct DrawElementsIndirectCommand
+	*\brief one draw of glMultiDrawElementsIndirect, layout fixed by OpenGL
+	*/
+	struct DrawElementsIndirectCommand {
+		uint32_t count; //!< Index count
+		uint32_t instanceCount; //!< Instance count
+		uint32_t firstIndex; //!< First index
+		int32_t baseVertex; //!< Added to every index
+		uint32_t baseInstance; //!< First instance, selects the draw ID
+	};
+
+	/**
+	\class OpenGLGeometryArena
+	\brief Static geometry packed into large immutable vertex and index pages, one vertex array per vertex layout
+	*
+	* Meshes which share a layout share a vertex array, so drawing them only swaps the page buffers when they live on
+	* different pages. Every bucket vertex array also reads a per instance draw ID, see OpenGLVertexArray::addDrawIDBuffer.
+	*/
+	class OpenGLGeometryArena {
+	private:
+		/** \struct Page
+		*\brief one vertex and index buffer pair
+		*/
+		struct Page {
+			uint32_t vertexBuffer; //!< Vertex buffer ID
+			uint32_t indexBuffer; //!< Index buffer ID
+			uint32_t vertexCapacity; //!< Vertices which fit
+			uint32_t vertexCount = 0; //!< Vertices used
+			uint32_t indexCapacity; //!< Indices which fit
+			uint32_t indexCount = 0; //!< Indices used
+		};
+
+		/** \struct Bucket
+		*\brief pages and vertex array for one layout
+		*/
+		struct Bucket {
+			VertexBufferLayout layout; //!< Vertex layout
+			std::shared_ptr<OpenGLVertexArray> VAO; //!< Vertex array
+			std::vector<Page> pages; //!< Pages
+		};
+
+		std::vector<Bucket> m_buckets; //!< One bucket per layout
+		uint32_t m_pageSize; //!< Bytes of vertex data per page
+		uint32_t m_pageIndices; //!< Indices per page
+		uint32_t m_drawIDBuffer; //!< Buffer holding 0 to maxDraws - 1, grown on demand
+		uint32_t m_drawIDLocation; //!< Attribute location of the draw ID
+		uint32_t m_maxDraws; //!< Entries in the draw ID buffer
+
+		uint32_t findBucket(const VertexBufferLayout& layout); //!< Find or create the bucket for a layout
+		void addPage(Bucket& bucket, uint32_t vertexCount, uint32_t indexCount); //!< Add a page to a bucket, large enough for at least the given counts
+	public:
+		OpenGLGeometryArena(uint32_t pageSize, uint32_t pageIndices, uint32_t maxDraws, uint32_t drawIDLocation); //!< Constructor
+		~OpenGLGeometryArena(); //!< Destructor
+
+		ArenaMesh add(const VertexBufferLayout& layout, const void* vertices, uint32_t size, const uint32_t* indices, uint32_t indexCount); //!< Copy a mesh into the arena
+		void bindPage(const ArenaMesh& mesh); //!< Attach the page buffers of a mesh to its bucket vertex array
+		inline const std::shared_ptr<OpenGLVertexArray>& getVertexArray(uint32_t bucket) const { return m_buckets[bucket].VAO; } //!< Get the vertex array of a bucket
+		inline uint32_t getBucketCount() const { return static_cast<uint32_t>(m_buckets.size()); } //!< Get the number of layouts
+		inline uint32_t getPageCount(uint32_t bucket) const { return static_cast<uint32_t>(m_buckets[bucket].pages.size()); } //!< Get the number of pages in a bucket
+		inline uint32_t getDrawIDBuffer() const { return m_drawIDBuffer; } //!< Get the draw ID buffer, for vertex arrays outside the arena
+		inline uint32_t getDrawIDLocation() const { return m_drawIDLocation; } //!< Get the draw ID attribute location
+		void reserveDraws(uint32_t count); //!< Grow the draw ID buffer to hold at least count IDs, keeping the buffer name vertex arrays are bound to
+		inline uint32_t getMaxDraws() const { return m_maxDraws; } //!< Get the number of draw IDs
+	};
+}
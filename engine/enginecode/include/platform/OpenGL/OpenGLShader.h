@@ -2,24 +2,110 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
 #include <glm/glm.hpp>
+#include "rendering/shaderDataType.h"
 
 namespace Engine {
+	/** \struct UniformHandle
+	*\brief index of a reflected uniform, resolved once by name and typed by the value it uploads
+	\param index int32_t - index into the shader's uniform table, -1 when the uniform is not active
+	*/
+	template<typename T>
+	struct UniformHandle {
+		int32_t index = -1; //!< Index into the uniform table
+		inline bool isValid() const { return index >= 0; } //!< Was the uniform found
+	};
+
+	/** \struct ShaderUniform
+	*\brief one active default block uniform reflected after linking
+	\param name string - name, without any array suffix
+	\param type ShaderDataType - data type, None for types which cannot be uploaded
+	\param location int32_t - uniform location
+	\param arraySize int32_t - number of array elements, 1 for non arrays
+	\param cacheOffset uint32_t - offset of the last uploaded value in the value cache
+	\param cacheSize uint32_t - bytes reserved in the value cache
+	\param cached bool - does the value cache hold a value for this uniform
+	*/
+	struct ShaderUniform {
+		std::string name; //!< Name
+		ShaderDataType type; //!< Data type
+		int32_t location; //!< Location
+		int32_t arraySize; //!< Array elements
+		uint32_t cacheOffset; //!< Offset of the cached value
+		uint32_t cacheSize; //!< Size of the cached value
+		bool cached = false; //!< Has a value been uploaded
+	};
+
+	/** \struct ShaderUniformBlock
+	*\brief one active uniform block reflected after linking
+	\param name string - block name
+	\param index uint32_t - block index
+	\param binding int32_t - binding point at link time
+	\param dataSize int32_t - size of the block in bytes
+	*/
+	struct ShaderUniformBlock {
+		std::string name; //!< Name
+		uint32_t index; //!< Block index
+		int32_t binding; //!< Binding point
+		int32_t dataSize; //!< Size in bytes
+	};
+
+	namespace UniformTypes {
+		template<typename T> constexpr ShaderDataType get(); //!< Shader data type uploaded by a C++ type
+		template<> constexpr ShaderDataType get<int32_t>() { return ShaderDataType::Int; } //!< int
+		template<> constexpr ShaderDataType get<float>() { return ShaderDataType::Float; } //!< float
+		template<> constexpr ShaderDataType get<glm::vec2>() { return ShaderDataType::Float2; } //!< vec2
+		template<> constexpr ShaderDataType get<glm::vec3>() { return ShaderDataType::Float3; } //!< vec3
+		template<> constexpr ShaderDataType get<glm::vec4>() { return ShaderDataType::Float4; } //!< vec4
+		template<> constexpr ShaderDataType get<glm::mat3>() { return ShaderDataType::Mat3; } //!< mat3
+		template<> constexpr ShaderDataType get<glm::mat4>() { return ShaderDataType::Mat4; } //!< mat4
+	}
+
 	/**
 	\class OpenGLShader
 	\brief OpenGL implementation of shader class
+	*
+	* Active uniforms and uniform blocks are reflected into a flat table after linking. Uploads go through
+	* handles into that table and the last uploaded value is cached, so uploading an unchanged value does nothing.
 	*/
 	class OpenGLShader {
 	private:
 		uint32_t m_OpenGL_ID; //!< Render ID
+		std::vector<ShaderUniform> m_uniforms; //!< Reflected default block uniforms
+		std::unordered_map<std::string, int32_t> m_uniformLookup; //!< Uniform name to table index
+		std::vector<ShaderUniformBlock> m_uniformBlocks; //!< Reflected uniform blocks
+		std::vector<unsigned char> m_uniformCache; //!< Last uploaded value of every uniform
+		std::unordered_map<std::string, int32_t> m_inputLocations; //!< Vertex input name to location
 
 		void compileAndLink(const char* vertexShaderSrc, const char* fragmentShaderSrc); //!< Compile and link the shaders
+		void reflect(); //!< Build the uniform, uniform block and vertex input tables
+		int32_t findUniform(const char* name, ShaderDataType type) const; //!< Find a uniform, checking its type in debug builds
+		bool updateCache(int32_t index, const void* data, uint32_t size); //!< Store a value in the cache, returns false when it was already there
 	public:
 		OpenGLShader(const char* vertexFilePath, const char* fragmentFilepath); //!< Constructor which takes vertex and fragment shader path
 		OpenGLShader(const char* filepath); //!< Constructor which takes path to combined shader
 		~OpenGLShader(); //!< Default destructor
 
 		inline uint32_t getRenderID() const { return m_OpenGL_ID; } //!< Get OpenGL ID
+		inline const std::vector<ShaderUniform>& getUniforms() const { return m_uniforms; } //!< Get the reflected uniforms
+		inline const std::vector<ShaderUniformBlock>& getUniformBlocks() const { return m_uniformBlocks; } //!< Get the reflected uniform blocks
+		const ShaderUniformBlock* getUniformBlock(const char* name) const; //!< Get a reflected uniform block, nullptr if it is not active
+		int32_t getInputLocation(const char* name) const; //!< Get the location of an active vertex input, -1 if it is not active
+
+		template<typename T>
+		UniformHandle<T> getUniform(const char* name) const { return { findUniform(name, UniformTypes::get<T>()) }; } //!< Resolve a uniform handle by name
+
+		void upload(UniformHandle<int32_t> handle, int32_t value); //!< Upload integer
+		void upload(UniformHandle<int32_t> handle, const int32_t* values, uint32_t count); //!< Upload integer array
+		void upload(UniformHandle<float> handle, float value); //!< Upload float
+		void upload(UniformHandle<glm::vec2> handle, const glm::vec2& value); //!< Upload vector of 2 floats
+		void upload(UniformHandle<glm::vec3> handle, const glm::vec3& value); //!< Upload vector of 3 floats
+		void upload(UniformHandle<glm::vec4> handle, const glm::vec4& value); //!< Upload vector of 4 floats
+		void upload(UniformHandle<glm::mat3> handle, const glm::mat3& value); //!< Upload 3x3 matrix
+		void upload(UniformHandle<glm::mat4> handle, const glm::mat4& value); //!< Upload 4x4 matrix
 
 		void uploadInt(const char* name, int value); //!< Upload integer
 		void uploadIntArray(const char* name, int32_t* values, uint32_t count); //!< Upload integer array
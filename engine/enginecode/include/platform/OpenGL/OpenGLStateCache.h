@@ -0,0 +1,91 @@
+/** \file OpenGLStateCache.h */
+#pragma once
+
+#include <cstdint>
+
+namespace Engine {
+	/** \struct OpenGLStateStats
+	*\brief counters of state changes requested through the OpenGLStateCache in one frame
+	\param issued uint32_t - changes passed on to the driver
+	\param elided uint32_t - changes dropped because the driver already had the state
+	*/
+	struct OpenGLStateStats {
+		uint32_t issued = 0; //!< Calls made
+		uint32_t elided = 0; //!< Calls skipped
+	};
+
+	/**
+	\class OpenGLStateCache
+	\brief Shadow copy of the bindings and fixed function state of the GL context, only calling GL when a value changes
+	*
+	* Everything that binds a program, vertex array, framebuffer, buffer or texture, or toggles blending, depth or culling, goes
+	* through here. Other GL work uses DSA calls which need no binds. State set outside the cache is not seen, call
+	* invalidate() after any code which touches the context directly. Deleted objects must be reported so a reused
+	* name is not taken as already bound.
+	*/
+	class OpenGLStateCache {
+	private:
+		constexpr static uint32_t unknown = 0xFFFFFFFF; //!< Value of state the cache has not seen set
+		constexpr static uint32_t bufferTargets = 4; //!< Non indexed buffer targets tracked
+		constexpr static uint32_t indexedBindings = 16; //!< Uniform and storage binding points tracked
+		constexpr static uint32_t textureUnits = 32; //!< Texture units tracked
+		constexpr static uint32_t capabilities = 3; //!< Capabilities tracked
+
+		/** \struct IndexedBinding
+		*\brief buffer range bound to a uniform or storage binding point, size 0 for the whole buffer
+		*/
+		struct IndexedBinding {
+			uint32_t buffer; //!< Buffer
+			uint32_t offset; //!< Offset in bytes
+			uint32_t size; //!< Size in bytes
+		};
+
+		/** \struct State
+		*\brief the cached context state
+		*/
+		struct State {
+			uint32_t program; //!< Program in use
+			uint32_t vertexArray; //!< Bound vertex array
+			uint32_t framebuffer; //!< Bound draw and read framebuffer
+			uint32_t buffers[bufferTargets]; //!< Buffer bound to each tracked target
+			IndexedBinding uniformBuffers[indexedBindings]; //!< Uniform buffer binding points
+			IndexedBinding storageBuffers[indexedBindings]; //!< Shader storage binding points
+			uint32_t textures[textureUnits]; //!< Texture bound to each unit
+			uint32_t enabled[capabilities]; //!< Blend, depth test and cull face, 0, 1 or unknown
+			uint32_t blendSource; //!< Source blend factor
+			uint32_t blendDestination; //!< Destination blend factor
+			uint32_t depthMask; //!< Depth writes, 0, 1 or unknown
+		};
+
+		static State s_state; //!< Cached state
+		static OpenGLStateStats s_frameStats; //!< Counters of the frame in progress
+		static OpenGLStateStats s_lastFrameStats; //!< Counters of the last finished frame
+
+		static bool change(uint32_t& cached, uint32_t value); //!< Store a value, returns true and counts an issued call when it differs
+		static int32_t targetIndex(uint32_t target); //!< Slot of a buffer target, -1 when it is not tracked
+		static int32_t capabilityIndex(uint32_t capability); //!< Slot of a capability, -1 when it is not tracked
+		static bool bindIndexed(IndexedBinding& cached, uint32_t buffer, uint32_t offset, uint32_t size); //!< Store an indexed binding, returns true when it differs
+	public:
+		static void invalidate(); //!< Forget all cached state, the next request of each kind always reaches GL
+		static void nextFrame(); //!< Finish the frame's counters and start new ones
+
+		static void useProgram(uint32_t program); //!< Make a program current
+		static void bindVertexArray(uint32_t vertexArray); //!< Bind a vertex array
+		static void bindFramebuffer(uint32_t framebuffer); //!< Bind a framebuffer for drawing and reading, 0 for the default one
+		static void bindBuffer(uint32_t target, uint32_t buffer); //!< Bind a buffer to a non indexed target
+		static void bindBufferBase(uint32_t target, uint32_t index, uint32_t buffer); //!< Bind a whole buffer to a uniform or storage binding point
+		static void bindBufferRange(uint32_t target, uint32_t index, uint32_t buffer, uint32_t offset, uint32_t size); //!< Bind part of a buffer to a uniform or storage binding point
+		static void bindTexture(uint32_t unit, uint32_t texture); //!< Bind a texture to a unit
+		static void setEnabled(uint32_t capability, bool enabled); //!< Enable or disable GL_BLEND, GL_DEPTH_TEST or GL_CULL_FACE
+		static void setBlendFunc(uint32_t source, uint32_t destination); //!< Set the blend factors
+		static void setDepthMask(bool write); //!< Enable or disable depth writes
+
+		static void onProgramDeleted(uint32_t program); //!< Forget a deleted program
+		static void onVertexArrayDeleted(uint32_t vertexArray); //!< Forget a deleted vertex array
+		static void onFramebufferDeleted(uint32_t framebuffer); //!< Forget a deleted framebuffer
+		static void onBufferDeleted(uint32_t buffer); //!< Forget a deleted buffer in every target and binding point
+		static void onTextureDeleted(uint32_t texture); //!< Forget a deleted texture in every unit
+
+		inline static const OpenGLStateStats& getStats() { return s_lastFrameStats; } //!< Get the counters of the last finished frame
+	};
+}
@@ -0,0 +1,25 @@
+/** \file OpenGLStorageBuffer.h */
+#pragma once
+
+#include <cstdint>
+
+namespace Engine {
+	/**
+	\class OpenGLStorageBuffer
+	\brief OpenGL implementation of a shader storage buffer, for data rewritten every frame
+	*/
+	class OpenGLStorageBuffer {
+	private:
+		uint32_t m_OpenGL_ID; //!< OpenGL ID
+		uint32_t m_capacity; //!< Size of the buffer store in bytes
+	public:
+		OpenGLStorageBuffer(uint32_t capacity); //!< Constructor
+		~OpenGLStorageBuffer(); //!< Destructor
+		void allocate(uint32_t size); //!< Orphan the contents, growing the store when needed
+		void edit(const void* data, uint32_t size, uint32_t offset); //!< Write part of the contents
+		void upload(const void* data, uint32_t size); //!< Replace the contents, growing the store when needed
+		void bind(uint32_t binding); //!< Bind to a shader storage binding point
+		inline uint32_t getRenderID() const { return m_OpenGL_ID; } //!< Get OpenGL ID
+		inline uint32_t getCapacity() const { return m_capacity; } //!< Get the capacity in bytes
+	};
+}
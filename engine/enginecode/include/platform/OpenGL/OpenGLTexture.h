@@ -14,15 +14,16 @@ namespace Engine {
 		uint32_t m_OpenGL_ID; //!< OpenGL ID
 		uint32_t m_width; //!< Texture width
 		uint32_t m_height; //!< Texture height
-		uint32_t m_channels; //!< Numbers of channels in texture
+		uint32_t m_channels; //!< Numbers of channels in texture, one is sampled as a white alpha mask and two as luminance and alpha
+		uint32_t m_levels = 1; //!< Mip levels, 1 unless the texture is sampled with mipmaps
 
-		void init(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t slot); //!< Initialize texture
+		void init(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t slot, bool mipmaps); //!< Initialize texture
 	public:
-		OpenGLTexture(const char* filepath, uint32_t slot); //!< Constructor that tike file path and creates texture
-		OpenGLTexture(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t slot); //!< Constructor that takes data and creates texture
+		OpenGLTexture(const char* filepath, uint32_t slot, bool mipmaps = false); //!< Constructor that tike file path and creates texture, with a trilinear filtered mip chain if mipmaps is set
+		OpenGLTexture(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t slot, bool mipmaps = false); //!< Constructor that takes data and creates texture, with a trilinear filtered mip chain if mipmaps is set
 		~OpenGLTexture(); //!< Destructor
 
-		void edit(uint32_t xOffeset, uint32_t yOffset, uint32_t width, uint32_t height, unsigned char* data); //!< Edit the texture
+		void edit(uint32_t xOffeset, uint32_t yOffset, uint32_t width, uint32_t height, unsigned char* data); //!< Edit the texture, regenerating the mip chain if it has one
 		void bindToSlot(uint32_t slot); //!< Bind texture to slot
 
 		inline uint32_t getRenderID() const { return m_OpenGL_ID; } //!< Get OpenGL ID
@@ -15,20 +15,28 @@ namespace Engine {
 	private:
 		uint32_t m_OpenGL_ID; //!< Render ID
 		uint32_t m_attributeIndex = 0;//!< Vertex array atribute index
+		bool m_hasDrawIDs = false; //!< Has a per instance draw ID attribute been added
+		BoundingVolume m_bounds; //!< Local space bounds, taken from the first bounded vertex buffer
 
 		std::vector<std::shared_ptr<OpenGLVertexBuffer>> m_vertexBuffer; //!< Vector of pointers to vertex buffers
 		std::shared_ptr<OpenGLIndexBuffer> m_indexBuffer; //!< Pointer to index buffer
 	public:
 		OpenGLVertexArray(); //!< Constructor
 		~OpenGLVertexArray(); //!< Destructor
-		void addVertexBuffer(const std::shared_ptr<OpenGLVertexBuffer>& vertexBuffer); //!< Add vertex buffer
+		void addVertexBuffer(const std::shared_ptr<OpenGLVertexBuffer>& vertexBuffer, uint32_t divisor = 0); //!< Add vertex buffer, a non zero divisor steps its attributes per instance
 		void setIndexBuffer(const std::shared_ptr<OpenGLIndexBuffer>& indexBuffer); //!< Set index buffer
+		void setVertexFormat(const VertexBufferLayout& layout); //!< Describe the attributes of buffer binding 0 without a buffer, the buffers are then set with setBuffers
+		void setBuffers(uint32_t vertexBufferID, uint32_t stride, uint32_t indexBufferID); //!< Attach buffers to binding 0 and the element array, for arrays set up with setVertexFormat
+		void addDrawIDBuffer(uint32_t bufferID, uint32_t location); //!< Add an unsigned int attribute read once per instance, draws pick their entry with their base instance
+		inline bool hasDrawIDs() const { return m_hasDrawIDs; } //!< Has a draw ID attribute been added
+		inline const BoundingVolume& getBounds() const { return m_bounds; } //!< Get the local space bounds
+		inline void setBounds(const BoundingVolume& bounds) { m_bounds = bounds; } //!< Override the bounds, for vertices which are edited after creation
 
 		inline std::shared_ptr<OpenGLIndexBuffer> getIndexBuffer() { return m_indexBuffer; }; //!< Get index buffer
 		inline std::vector<std::shared_ptr<OpenGLVertexBuffer>> getVertexBuffers() { return m_vertexBuffer; } //!< Get vertex buffers
 		inline uint32_t getRenderID() const { return m_OpenGL_ID; } //!< Get OpenGL ID
 		inline uint32_t getDrawnCount(){ //!< Get draw count
-			if (m_indexBuffer) { m_indexBuffer->getCount(); }
+			if (m_indexBuffer) { return m_indexBuffer->getCount(); }
 			else { return 0; }
 		}
 	};
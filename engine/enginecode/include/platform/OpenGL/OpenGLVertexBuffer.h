@@ -1,7 +1,9 @@
 /** \file OpenGLVertexBuffer.h */
 #pragma once
 
+#include <vector>
 #include "rendering/bufferLayout.h"
+#include "rendering/culling.h"
 
 namespace Engine {
 	/**
@@ -12,11 +14,24 @@ namespace Engine {
 	private:
 		uint32_t m_OpenGL_ID; //!< Render ID
 		VertexBufferLayout m_layout;
+
+		unsigned char* m_mapped = nullptr; //!< Persistently mapped storage, null when the buffer is not streaming
+		uint32_t m_regionSize = 0; //!< Size in bytes of one streaming region
+		uint32_t m_regionIndex = 0; //!< Region currently being written to
+		std::vector<void*> m_fences; //!< Fence guarding each region, null when the GPU is done with it
+		BoundingVolume m_bounds; //!< Bounds of the initial vertices, unbounded when the first element is not a three float position
 	public:
 		OpenGLVertexBuffer(void* vertices, uint32_t size, VertexBufferLayout layout); //!< Constructor
+		OpenGLVertexBuffer(uint32_t regionSize, uint32_t regionCount, VertexBufferLayout layout); //!< Constructor for a persistently mapped buffer split into regionCount streaming regions
 		~OpenGLVertexBuffer(); //! Destructor
 		void edit(void* vertices, uint32_t size, uint32_t offset); //!< Edit vertices with offset
+		void* beginRegion(); //!< Wait until the GPU is done with the current region and get a pointer to write into it
+		void endRegion(); //!< Fence the current region after the draws reading it and move onto the next one
+		inline bool isStreaming() const { return m_mapped != nullptr; } //!< Is the buffer persistently mapped
+		inline uint32_t getRegionIndex() const { return m_regionIndex; } //!< Get the region currently being written to
+		inline uint32_t getRegionSize() const { return m_regionSize; } //!< Get the size in bytes of one region
 		inline uint32_t getRenderID() const { return m_OpenGL_ID; } //!< Get OPen GL ID
 		inline const VertexBufferLayout& getLayout() const { return m_layout; } //!< Get layout
+		inline const BoundingVolume& getBounds() const { return m_bounds; } //!< Get the bounds of the initial vertices
 	};
-}
\ No newline at end of file
+}
@@ -169,6 +169,10 @@ namespace Engine {
 		m_graphicsContext->swapBuffers();
 	}
 
+	void GLFWWindowImpl::pollEvents(){
+		glfwPollEvents();
+	}
+
 	void GLFWWindowImpl::onResize(unsigned int width, unsigned int height){
 	}
 
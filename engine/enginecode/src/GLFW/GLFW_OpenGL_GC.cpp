@@ -48,4 +48,12 @@ namespace Engine {
 	{
 		glfwSwapBuffers(m_window);
 	}
+	void GLFW_OpenGL_GC::makeCurrent()
+	{
+		glfwMakeContextCurrent(m_window);
+	}
+	void GLFW_OpenGL_GC::releaseCurrent()
+	{
+		glfwMakeContextCurrent(nullptr);
+	}
 }
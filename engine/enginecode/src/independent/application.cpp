@@ -16,9 +16,13 @@
 #include "platform/OpenGL/OpenGLShader.h"
 #include "platform/OpenGL/OpenGLTexture.h"
 #include "platform/OpenGL/OpenGLUniformBuffer.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
+#include "platform/OpenGL/OpenGLFrameGraphDevice.h"
 #include "rendering/TextureUnitManager.h"
 #include "rendering/Renderer3D.h"
 #include "rendering/Renderer2D.h"
+#include "rendering/bvh.h"
+#include "rendering/frameGraph.h"
 #include "cameras/FreeEulerController.h"
 #include "cameras/FollowCamera.h"
 
@@ -246,40 +250,11 @@ namespace Engine {
 #pragma endregion
 
 #pragma region GL_BUFFERS
-		std::shared_ptr<OpenGLVertexArray> cubeVAO;
-		std::shared_ptr<OpenGLVertexBuffer> cubeVBO;
-		std::shared_ptr<OpenGLIndexBuffer> cubeIBO;
-
-		cubeVAO.reset(new OpenGLVertexArray);
+		Renderer3D::init();
 
 		VertexBufferLayout cubeBL = { ShaderDataType::Float3, ShaderDataType::Float3, ShaderDataType::Float2 };
-		cubeVBO.reset(new OpenGLVertexBuffer(cubeVertices, sizeof(cubeVertices), cubeBL));
-
-		cubeIBO.reset(new OpenGLIndexBuffer(cubeIndices, 36));
-
-		cubeVAO->addVertexBuffer(cubeVBO);
-		cubeVAO->setIndexBuffer(cubeIBO);
-
-		glBindVertexArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-		std::shared_ptr<OpenGLVertexArray> pyramidVAO;
-		std::shared_ptr<OpenGLVertexBuffer> pyramidVBO;
-		std::shared_ptr<OpenGLIndexBuffer> pyramidIBO;
-
-		pyramidVAO.reset(new OpenGLVertexArray);
-		pyramidVBO.reset(new OpenGLVertexBuffer(pyramidVertices, sizeof(pyramidVertices), cubeBL));
-
-		pyramidIBO.reset(new OpenGLIndexBuffer(pyramidIndices, 18));
-
-		pyramidVAO->addVertexBuffer(pyramidVBO);
-		pyramidVAO->setIndexBuffer(pyramidIBO);
-
-		// Unbind everything so we can't mess is up
-		glBindVertexArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		ArenaMesh cubeMesh = Renderer3D::addGeometry(cubeBL, cubeVertices, sizeof(cubeVertices), cubeIndices, 36);
+		ArenaMesh pyramidMesh = Renderer3D::addGeometry(cubeBL, pyramidVertices, sizeof(pyramidVertices), pyramidIndices, 18);
 #pragma endregion
 
 
@@ -287,6 +262,10 @@ namespace Engine {
 
 		std::shared_ptr<OpenGLShader> TPShader;
 		TPShader.reset(new OpenGLShader("./assets/shaders/texturedPhong.glsl"));
+		std::shared_ptr<OpenGLShader> clusteredShader;
+		clusteredShader.reset(new OpenGLShader("./assets/shaders/texturedPhongClustered.glsl"));
+		std::shared_ptr<OpenGLShader> diffuseShader;
+		diffuseShader.reset(new OpenGLShader("./assets/shaders/texturedDiffuse.glsl"));
 
 #pragma endregion 
 
@@ -309,9 +288,27 @@ namespace Engine {
 		std::shared_ptr<Material> letterCubeMat;
 		std::shared_ptr<Material> numberCubeMat;
 
-		pyramidMat.reset(new Material(TPShader,{ 0.3f, 0.9f, 4.f, 1.f }));
+		pyramidMat.reset(new Material(clusteredShader,{ 0.3f, 0.9f, 4.f, 1.f }));
 		letterCubeMat.reset(new Material(TPShader, letterTexture));
-		numberCubeMat.reset(new Material(TPShader, numberTexture));
+		numberCubeMat.reset(new Material(clusteredShader, numberTexture));
+
+		std::shared_ptr<Material> letterCubeFarMat;
+		std::shared_ptr<Material> numberCubeFarMat;
+
+		letterCubeFarMat.reset(new Material(diffuseShader, letterTexture));
+		numberCubeFarMat.reset(new Material(diffuseShader, numberTexture));
+
+#pragma endregion
+
+#pragma region LODS
+		// Phong close up, diffuse only further away and not drawn below 1% of the screen height
+		LODSet letterCubeLODs(0.1f, 8);
+		letterCubeLODs.addLevel({ nullptr, cubeMesh, nullptr, 0.15f });
+		letterCubeLODs.addLevel({ nullptr, cubeMesh, letterCubeFarMat, 0.01f });
+		LODSet numberCubeLODs(0.1f, 8);
+		numberCubeLODs.addLevel({ nullptr, cubeMesh, nullptr, 0.15f });
+		numberCubeLODs.addLevel({ nullptr, cubeMesh, numberCubeFarMat, 0.01f });
+		LODState cubeLODs[2];
 
 #pragma endregion
 
@@ -324,6 +321,28 @@ namespace Engine {
 		models[3] = glm::translate(glm::mat4(1.0f), positionPlayerCube);
 #pragma endregion
 
+#pragma region LIGHTS
+		// A ring of coloured point lights around the models and two spot lights from above, drawn by the clustered shader
+		std::vector<Light> sceneLights;
+		for (uint32_t i = 0; i < 64; i++) {
+			float angle = 6.2831853f * i / 64.f;
+			glm::vec3 colour = { 0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::cos(angle + 2.094f), 0.5f + 0.5f * std::cos(angle + 4.189f) };
+			sceneLights.push_back(Light::point({ 4.f * std::cos(angle), 0.5f, -6.f + 4.f * std::sin(angle) }, 2.5f, colour, 4.f));
+		}
+		sceneLights.push_back(Light::spot({ -2.f, 4.f, -6.f }, { 0.f, -1.f, 0.f }, 8.f, glm::radians(20.f), { 1.f, 1.f, 1.f }, 20.f));
+		sceneLights.push_back(Light::spot({ 2.f, 4.f, -6.f }, { 0.f, -1.f, 0.f }, 8.f, glm::radians(20.f), { 1.f, 0.8f, 0.6f }, 20.f));
+#pragma endregion
+
+#pragma region PICKING
+		// World space bounds of each model, object i in the BVH is models[i]
+		ArenaMesh modelMeshes[4] = { pyramidMesh, cubeMesh, cubeMesh, cubeMesh };
+		AABB modelBounds[4];
+		for (uint32_t i = 0; i < 4; i++) modelBounds[i] = Culling::transformAABB(modelMeshes[i].bounds.min, modelMeshes[i].bounds.max, models[i]);
+		BVH sceneBVH;
+		sceneBVH.build(modelBounds, 4);
+		bool wasPicking = false;
+#pragma endregion
+
 #pragma region CAMERAS
 		EulerCameraProps camP;
 		std::shared_ptr<FreeEulerControllerEuler> camera3DEuler;
@@ -388,14 +407,29 @@ namespace Engine {
 
 		LoggerSys::info("Application is starting.");
 
-		Renderer3D::init();
 		Renderer3D::attachShader(TPShader);
+		Renderer3D::attachShader(diffuseShader);
+		Renderer3D::attachShader(clusteredShader);
 
 		Renderer2D::init();
 
+		TextRun freeLookLabel("Free look cam");
+		TextRun followLabel("Follow Camera");
+
+		// Overlay quads are recorded on this thread each frame and replayed on the render thread
+		Renderer2DRecorder overlay;
+
 		glm::vec3 forward;
 		glm::vec3 right;
-		float advance;
+
+		// The render thread owns the context from here, resources above were created while this thread held it
+		std::shared_ptr<GraphicsContext> context = m_window->getGraphicsContext();
+		context->releaseCurrent();
+		m_renderThread.start([context]() { context->makeCurrent(); }, [context]() { context->releaseCurrent(); });
+
+		// Rebuilt every frame on the render thread, the device keeps its textures and timers between frames
+		FrameGraph frameGraph;
+		OpenGLFrameGraphDevice frameGraphDevice;
 
 		while (m_running)
 		{
@@ -408,49 +442,37 @@ namespace Engine {
 			models[1] = glm::rotate(models[1], timestep, glm::vec3(0.f, 1.0, 0.f));
 			models[2] = glm::rotate(models[2], timestep, glm::vec3(0.f, 1.0, 0.f));
 
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			
-			
-			glEnable(GL_DEPTH_TEST);
-			
-			Renderer3D::begin(swu3D);
-
-			Renderer3D::submit(pyramidVAO, pyramidMat, models[0]);
-			Renderer3D::submit(cubeVAO, letterCubeMat, models[1]);
-			Renderer3D::submit(cubeVAO, numberCubeMat, models[2]);
-			Renderer3D::submit(cubeVAO, numberCubeMat, models[3]);
-
-			Renderer3D::end();
-			
-			
-			glDisable(GL_DEPTH_TEST);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			for (uint32_t i = 0; i < 4; i++) sceneBVH.update(i, Culling::transformAABB(modelMeshes[i].bounds.min, modelMeshes[i].bounds.max, models[i]));
+			sceneBVH.refit();
 
-			Renderer2D::begin(swu2D);
-
-			Renderer2D::submit(quads[0], {0.f, 1.f, 1.f, 1.f});
-			Renderer2D::submit(quads[1], {0.f, 1.f, 1.f, 1.f}, 45.f, true);
-			Renderer2D::submit(quads[2], moonSubTexture);
-			Renderer2D::submit(quads[3], {1.f, 1.f, 0.f, 1.f}, moonSubTexture);
-
-			uint32_t x = 200.f;
-
-			Renderer2D::flush();
+			TextRun* label = nullptr;
+			glm::vec2 labelPosition;
+			glm::vec4 labelTint;
 
 			if (m_EulerCamera) {
 				if (!m_updatedView) {
-					swu3D["u_view"] = std::pair<ShaderDataType, void*>(ShaderDataType::Mat4, static_cast<void*>(glm::value_ptr(camera3DEuler->getCamera().view)));
 					m_updatedView = true;
 				}
 				else {
 					camera3DEuler->onUpdate(timestep);
-					Renderer2D::submit("Free look cam", { 250.f, 70.f }, { 0.2f, 0.2f, 1.f, 1.f });
+
+					// Pick the model under the cursor on a left click
+					bool picking = InputPoller::isMouseButtonPressed(NG_MOUSE_BUTTON_LEFT);
+					if (picking && !wasPicking) {
+						glm::vec2 screenSize = { static_cast<float>(m_window->getWidth()), static_cast<float>(m_window->getHeight()) };
+						Ray ray = Culling::screenRay(camera3DEuler->getCamera().view, camera3DEuler->getCamera().projection, InputPoller::getMousePosition(), screenSize);
+						uint32_t picked;
+						float distance;
+						if (sceneBVH.raycast(ray, picked, distance)) LoggerSys::info("Picked model {0} at distance {1}", picked, distance);
+					}
+					wasPicking = picking;
+					label = &freeLookLabel;
+					labelPosition = { 250.f, 70.f };
+					labelTint = { 0.2f, 0.2f, 1.f, 1.f };
 				}
 			}
 			else {
 				if (!m_updatedView) {
-					swu3D["u_view"] = std::pair<ShaderDataType, void*>(ShaderDataType::Mat4, static_cast<void*>(glm::value_ptr(followCamera->getCamera().view)));
 					m_updatedView = true;
 				}
 				else {
@@ -477,26 +499,96 @@ namespace Engine {
 					}
 					followCamera->onUpdate(timestep);
 
-					Renderer2D::submit('F', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('o', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('l', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('l', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('o', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('w', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit(' ', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('C', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('a', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('m', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('e', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('r', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
-					Renderer2D::submit('a', { x, 70.f }, advance, { 1.f, 1.f, 0.f, 1.f }); x += advance;
+					label = &followLabel;
+					labelPosition = { 200.f, 70.f };
+					labelTint = { 1.f, 1.f, 0.f, 1.f };
 				}
 			}
 
-			Renderer2D::end();
+			// Record the frame, culling, LOD selection, sorting and light binning happen here and the results are copied into the packet
+			FramePacket& packet = m_renderThread.getPacket();
+			glm::mat4 frameView = m_EulerCamera ? camera3DEuler->getCamera().view : followCamera->getCamera().view;
+			glm::mat4 frameProjection = followCamera->getCamera().projection;
+
+			SceneWideUniforms frameUniforms = swu3D;
+			frameUniforms["u_view"] = std::pair<ShaderDataType, void*>(ShaderDataType::Mat4, static_cast<void*>(glm::value_ptr(frameView)));
+			frameUniforms["u_projection"] = std::pair<ShaderDataType, void*>(ShaderDataType::Mat4, static_cast<void*>(glm::value_ptr(frameProjection)));
+
+			// Drop detail while frames run over 60fps
+			Renderer3D::setLODBias(LODSet::adjustBias(Renderer3D::getLODBias(), timestep, 1.f / 60.f));
+			Renderer3D::begin(frameUniforms);
+
+			for (const Light& light : sceneLights) Renderer3D::submit(light);
+
+			// The two front cubes hide what sits behind them
+			Renderer3D::submitOccluder(cubeVertices, 24, sizeof(float) * 8, 0, cubeIndices, 36, models[1]);
+			Renderer3D::submitOccluder(cubeVertices, 24, sizeof(float) * 8, 0, cubeIndices, 36, models[2]);
+
+			Renderer3D::submit(pyramidMesh, pyramidMat, models[0]);
+			Renderer3D::submit(letterCubeLODs, cubeLODs[0], letterCubeMat, models[1]);
+			Renderer3D::submit(numberCubeLODs, cubeLODs[1], numberCubeMat, models[2]);
+			Renderer3D::submit(cubeMesh, numberCubeMat, models[3]);
+
+			Renderer3D::Scene scene = Renderer3D::end(packet);
+
+			overlay.submit(quads[0], {0.f, 1.f, 1.f, 1.f});
+			overlay.submit(quads[1], {0.f, 1.f, 1.f, 1.f}, 45.f, true);
+			overlay.submit(quads[2], moonSubTexture);
+			overlay.submit(quads[3], {1.f, 1.f, 0.f, 1.f}, moonSubTexture);
+			Renderer2DRecorder::Snapshot overlayQuads = overlay.snapshot(packet);
+
+			FrameGraphTextureDesc backbufferDesc = { m_window->getWidth(), m_window->getHeight(), FrameGraphFormat::RGBA8 };
 
-			m_window->onUpdate(timestep);
+			// Only GL work is left for the render thread
+			packet.enqueue([&, scene, overlayQuads, label, labelPosition, labelTint, backbufferDesc]() {
+				frameGraph.reset();
+				FrameGraphResource backbuffer = frameGraph.importTexture("Backbuffer", backbufferDesc, 0);
+
+				frameGraph.addPass("Scene", [&](FrameGraphBuilder& builder) -> FrameGraphExecute {
+					backbuffer = builder.write(backbuffer);
+					return [&](const FrameGraphPassResources&) {
+						glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+						OpenGLStateCache::setEnabled(GL_DEPTH_TEST, true);
+
+						Renderer3D::draw(scene);
+					};
+				});
+
+				frameGraph.addPass("Overlay", [&](FrameGraphBuilder& builder) -> FrameGraphExecute {
+					backbuffer = builder.write(backbuffer);
+					return [&](const FrameGraphPassResources&) {
+						OpenGLStateCache::setEnabled(GL_DEPTH_TEST, false);
+						OpenGLStateCache::setEnabled(GL_BLEND, true);
+						OpenGLStateCache::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+						Renderer2D::begin(swu2D);
+
+						Renderer2D::submit(overlayQuads);
+
+						Renderer2D::flush();
+
+						// Text runs lay out against the glyph atlas, which lives with the context
+						if (label) Renderer2D::submit(*label, labelPosition, labelTint);
+
+						Renderer2D::end();
+					};
+				});
+
+				frameGraph.execute(frameGraphDevice);
+				OpenGLStateCache::nextFrame();
+
+				context->swapBuffers();
+			});
+
+			// Frame N runs on the render thread while this thread simulates frame N + 1
+			m_renderThread.submitFrame();
+			m_window->pollEvents();
 		};
+
+		// Give the context back to this thread so the resources above are destroyed with it current
+		m_renderThread.stop();
+		context->makeCurrent();
 	}
 
 }
@@ -4,14 +4,29 @@
 
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
-#include <numeric>
 
 namespace Engine {
 	std::shared_ptr<Renderer2D::InternalData> Renderer2D::s_data = nullptr;
 	VertexBufferLayout Renderer2DVertex::layout = VertexBufferLayout({ ShaderDataType::Float4, ShaderDataType::Float2, ShaderDataType::FlatInt, {ShaderDataType::Byte4, true} });
+	VertexBufferLayout Renderer2DInstance::layout = VertexBufferLayout({ ShaderDataType::Float2, ShaderDataType::Float2, {ShaderDataType::Short4, true}, ShaderDataType::Float2, ShaderDataType::FlatInt, {ShaderDataType::Byte4, true} });
 
-	void Renderer2D::init() {
+	static uint32_t nextFontGeneration() {
+		static uint32_t generation = 0;
+		return ++generation;
+	}
+
+	void Renderer2D::init(const Renderer2DProps& props) {
 		s_data.reset(new InternalData);
+		s_data->mode = props.mode;
+		s_data->sdfText = props.sdfText;
+		s_data->deferred = props.deferred;
+		s_data->layer = 0;
+		s_data->strictOrder = false;
+		s_data->sortSegment = 0;
+		s_data->drawCalls = 0;
+
+		// Every init loads the glyphs again, so runs laid out before it are stale
+		s_data->fontGeneration = nextFontGeneration();
 
 		unsigned char whitePx[4] = { 255, 255, 255, 255 };
 		s_data->defaultTexture.reset(new OpenGLTexture(1, 1, 4, whitePx, 0));
@@ -22,89 +37,105 @@ namespace Engine {
 
 		s_data->textureUnits = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32 };
 
-		s_data->shader.reset(new OpenGLShader("./assets/shaders/quad2.glsl"));
+		if (s_data->mode == Renderer2DMode::Instanced) s_data->shader.reset(new OpenGLShader("./assets/shaders/quadInstanced.glsl"));
+		else s_data->shader.reset(new OpenGLShader("./assets/shaders/quad2.glsl"));
+		s_data->texDataUniform = s_data->shader->getUniform<int32_t>("u_texData");
 
 		s_data->quad[0] = { -0.5f, -0.5f, 1.f, 1.f };
 		s_data->quad[1] = { -0.5f,  0.5f, 1.f, 1.f };
 		s_data->quad[2] = { 0.5f,  0.5f, 1.f, 1.f };
 		s_data->quad[3] = { 0.5f, -0.5f, 1.f, 1.f };
 
-		s_data->vertices.resize(s_data->batchSize);
-		s_data->vertices[0] = Renderer2DVertex(s_data->quad[0], { 0.f, 0.f }, 0, glm::vec4(1.f));
-		s_data->vertices[1] = Renderer2DVertex(s_data->quad[1], { 0.f, 1.f }, 0, glm::vec4(1.f));
-		s_data->vertices[2] = Renderer2DVertex(s_data->quad[2], { 1.f, 1.f }, 0, glm::vec4(1.f));
-		s_data->vertices[3] = Renderer2DVertex(s_data->quad[3], { 1.f, 0.f }, 0, glm::vec4(1.f));
-
-		std::vector<uint32_t> indices(s_data->batchSize);
-		std::iota(indices.begin(), indices.end(), 0);
-
 		UniformBufferLayout quadLayout = { { "u_projection", ShaderDataType::Mat4}, {"u_view", ShaderDataType::Mat4} };
 		s_data->quadUBO.reset(new OpenGLUniformBuffer(quadLayout));
 
-		std::shared_ptr<OpenGLVertexBuffer> VBO;
-		std::shared_ptr<OpenGLIndexBuffer> IBO;
-
 		s_data->VAO.reset(new OpenGLVertexArray());
-		VBO.reset(new OpenGLVertexBuffer(s_data->vertices.data(), sizeof(Renderer2DVertex) * s_data->vertices.size(), Renderer2DVertex::layout));
-		IBO.reset(new OpenGLIndexBuffer(indices.data(), indices.size()));
+		if (s_data->mode == Renderer2DMode::Instanced) {
+			// One record per quad, the corners come from gl_VertexID so only the first quad of the shared index buffer is used
+			s_data->VBO.reset(new OpenGLVertexBuffer(sizeof(Renderer2DInstance) * s_data->regionCapacity, s_data->regionCount, Renderer2DInstance::layout));
+			s_data->VAO->addVertexBuffer(s_data->VBO, 1);
+			s_data->VAO->setIndexBuffer(RendererCommon::getQuadIndexBuffer(1));
+		}
+		else {
+			s_data->VBO.reset(new OpenGLVertexBuffer(sizeof(Renderer2DVertex) * 4 * s_data->regionCapacity, s_data->regionCount, Renderer2DVertex::layout));
+			s_data->VAO->addVertexBuffer(s_data->VBO);
+			s_data->VAO->setIndexBuffer(RendererCommon::getQuadIndexBuffer(s_data->batchSize / 4));
+		}
+
+		// The region is mapped by begin(), nothing can be written until then
+		s_data->region = nullptr;
+		s_data->regionUsed = 0;
+		s_data->batchCapacity = 0;
+		s_data->vertices = nullptr;
+		s_data->instances = nullptr;
 
-		s_data->VAO->addVertexBuffer(VBO);
-		s_data->VAO->setIndexBuffer(IBO);
+		s_data->batchTexUnits.resize(s_data->batchSize / 4);
+		s_data->batchUVRects.resize(s_data->batchSize / 4);
 
 		s_data->quadUBO->attachShaderBlock(s_data->shader, "b_cameraQuad");
 
 		// Path to font file
 		const char* filePath = "./assets/fonts/arial.ttf";
 
-		// Init freetype
-		if (FT_Init_FreeType(&s_data->ft)) LoggerSys::error("Error: Freetype could not initialise.");
-
-		// Load font
-		if (FT_New_Face(s_data->ft, filePath, 0, &s_data->font)) LoggerSys::error("Error: Freetype could not load font: {0}", filePath);
-
-		// Set the char size
+		// Set the char size, distance fields are rasterized small and scaled up to the same layout size
 		int32_t charSize = 86;
-		if (FT_Set_Pixel_Sizes(s_data->font, 0, charSize)) LoggerSys::error("Error: freetype cannot set font size: {0}", charSize);
-
-		//Fill the texture atlas
-		s_data->glyphData.resize(s_data->lastGlyph - s_data->firstGlyph + 1);
-
-		for (unsigned ch = s_data->firstGlyph; ch <= s_data->lastGlyph; ch++) {
-			if (FT_Load_Char(s_data->font, ch, FT_LOAD_RENDER)) LoggerSys::error("Could not load glyph for char {0}", ch);
-			else {
-				GlyphData& gd = s_data->glyphData.at(ch - s_data->firstGlyph);
-				// Get glyph data
-				gd.size = glm::vec2(s_data->font->glyph->bitmap.width, s_data->font->glyph->bitmap.rows);
-				gd.bearing = glm::vec2(s_data->font->glyph->bitmap_left, -s_data->font->glyph->bitmap_top);
-
-				// Calculate the advance
-				gd.advance = static_cast<float>(s_data->font->glyph->advance.x >> 6);
-
-				//Set the dim of the glyph buffer
-				glm::vec2 glyphBufferDims = gd.size;
-				uint32_t glyphBufferSize = glyphBufferDims.x * glyphBufferDims.y * 4 * sizeof(unsigned char);
-
-				unsigned char* glyphBuffer = static_cast<unsigned char*>(malloc(glyphBufferSize));
-
-				RtoRGBA(glyphBuffer, s_data->font->glyph->bitmap.buffer, gd.size.x, gd.size.y);
-				s_data->glyphAtlas.add(gd.size.x, gd.size.y, 4, glyphBuffer, gd.subTexture);
-
-				free(glyphBuffer);
-			}
+		int32_t rasterSize = s_data->sdfText ? s_data->sdfBaseSize : charSize;
+
+		if (s_data->sdfText) s_data->glyphCache.reset(new GlyphCache({ 1024, 1024 }, GlyphRenderMode::SDF, s_data->sdfSpread));
+		else s_data->glyphCache.reset(new GlyphCache({ 4096, 4096 }, GlyphRenderMode::Bitmap));
+		s_data->sdfTextureID = s_data->sdfText ? s_data->glyphCache->getBaseTexture()->getRenderID() : 0;
+
+		// FreeType is only started when a glyph is missing from the cache
+		s_data->ft = nullptr;
+		s_data->font = nullptr;
+		s_data->glyphCache->setFont(nullptr, static_cast<float>(charSize) / static_cast<float>(rasterSize));
+		s_data->glyphCache->setFontLoader([filePath, rasterSize]() -> FT_Face {
+			// Init freetype
+			if (FT_Init_FreeType(&s_data->ft)) { LoggerSys::error("Error: Freetype could not initialise."); return nullptr; }
+
+			// Load font
+			if (FT_New_Face(s_data->ft, filePath, 0, &s_data->font)) { LoggerSys::error("Error: Freetype could not load font: {0}", filePath); return nullptr; }
+
+			if (FT_Set_Pixel_Sizes(s_data->font, 0, rasterSize)) LoggerSys::error("Error: freetype cannot set font size: {0}", rasterSize);
+			return s_data->font;
+		});
+		s_data->glyphCache->setRepackCallback([]() {
+			// Quads already in the batch point at the old glyph locations
+			flush();
+			s_data->fontGeneration = nextFontGeneration();
+		});
+
+		// Glyphs baked by an earlier run go up in one upload, otherwise ASCII is rasterized now as nearly all text needs it and baked for next time
+		uint64_t fontHash = GlyphCache::hashFile(filePath);
+		std::string bakePath = std::string(filePath) + "." + std::to_string(rasterSize) + (s_data->sdfText ? "sdf" : "") + ".glyphs";
+		if (!s_data->glyphCache->load(bakePath, fontHash, rasterSize)) {
+			for (unsigned ch = s_data->firstGlyph; ch <= s_data->lastGlyph; ch++) s_data->glyphCache->get(ch);
+			if (!s_data->glyphCache->save(bakePath, fontHash, rasterSize)) LoggerSys::warn("Could not bake glyphs to {0}", bakePath);
 		}
 	}
 
 	void Renderer2D::begin(const SceneWideUniforms& sceneWideUniforms){
 		// Reset drawcount
 		s_data->drawCount = 0;
+		s_data->drawCalls = 0;
+		s_data->layer = 0;
+		s_data->strictOrder = false;
+		s_data->sortSegment = 0;
+		s_data->glyphCache->nextFrame();
+		RendererCommon::s_textureUnitManager.nextBatch();
+
+		// Every batch this frame goes into one region, only waiting when the GPU is still reading it from regionCount frames ago
+		s_data->region = s_data->VBO->beginRegion();
+		s_data->regionUsed = 0;
+		startBatch();
 
 		// Bind the geometry
-		glBindVertexArray(s_data->VAO->getRenderID());
+		OpenGLStateCache::bindVertexArray(s_data->VAO->getRenderID());
 
 		// Bind the shader
-		glUseProgram(s_data->shader->getRenderID());
+		OpenGLStateCache::useProgram(s_data->shader->getRenderID());
 		
-		s_data->shader->uploadIntArray("u_texData", s_data->textureUnits.data(), 32);
+		s_data->shader->upload(s_data->texDataUniform, s_data->textureUnits.data(), 32);
 		
 		s_data->quadUBO->uploadData("u_view", sceneWideUniforms.at("u_view").second);
 		s_data->quadUBO->uploadData("u_projection", sceneWideUniforms.at("u_projection").second);
@@ -119,23 +150,34 @@ namespace Engine {
 	}
 
 	void Renderer2D::submit(const Quad& quad, const glm::vec4& tint, const std::shared_ptr<SubTexture>& texture){
-		if (s_data->drawCount + 4 > s_data->batchSize) flush();
-		if (RendererCommon::s_textureUnitManager.full()) flush();
+		if (s_data->deferred) {
+			Renderer2D::submit(quad, tint, texture, 0.f);
+			return;
+		}
+
+		if (s_data->drawCount + 4 > s_data->batchCapacity) flush();
 		uint32_t textSlot;
 		const uint32_t& textureID = texture->getBaseTexture()->getRenderID();
 		bool needsBinding = RendererCommon::s_textureUnitManager.getUnit(textureID, textSlot);
 		if (needsBinding) {
 			if (textSlot == -1) {
-				RendererCommon::s_textureUnitManager.clear();
+				// Every unit is read by the pending batch, draw it to free them
+				flush();
 				RendererCommon::s_textureUnitManager.getUnit(textureID, textSlot);
 			}
 			texture->getBaseTexture()->bindToSlot(textSlot);
 		}
-
-		s_data->model = glm::scale(glm::translate(glm::mat4(1.f), quad.m_translate), quad.m_scale);
+		textSlot |= unitFlags(textureID);
 
 		uint32_t packedTint = Renderer2DVertex::pack(tint);
 
+		if (s_data->mode == Renderer2DMode::Instanced) {
+			writeInstance(quad, 0.f, packedTint, textSlot, texture);
+			return;
+		}
+
+		s_data->model = glm::scale(glm::translate(glm::mat4(1.f), quad.m_translate), quad.m_scale);
+
 		uint32_t startIdx = s_data->drawCount;
 		for (int i = 0; i < 4; i++) {
 			s_data->vertices[i + startIdx].position = s_data->model * s_data->quad[i];
@@ -161,26 +203,43 @@ namespace Engine {
 
 	void Renderer2D::submit(const Quad& quad, const glm::vec4& tint, const std::shared_ptr<SubTexture>& texture, float angle, bool degrees)
 	{
-		if (s_data->drawCount + 4 > s_data->batchSize) flush();
-		if (RendererCommon::s_textureUnitManager.full()) flush();
-
 		if (degrees) angle = glm::radians(angle);
 
+		if (s_data->deferred) {
+			// The texture must outlive end(), the quad only keeps a plain pointer
+			QuadInstance instance;
+			instance.translate = { quad.m_translate.x, quad.m_translate.y };
+			instance.scale = { quad.m_scale.x, quad.m_scale.y };
+			instance.setRotation(angle);
+			instance.tint = tint;
+			instance.texture = texture.get();
+			defer(instance, s_data->layer);
+			return;
+		}
+
+		if (s_data->drawCount + 4 > s_data->batchCapacity) flush();
+
 		uint32_t textSlot;
 		const uint32_t& textureID = texture->getBaseTexture()->getRenderID();
 		bool needsBinding = RendererCommon::s_textureUnitManager.getUnit(textureID, textSlot);
 		if (needsBinding) {
 			if (textSlot == -1) {
-				RendererCommon::s_textureUnitManager.clear();
+				flush();
 				RendererCommon::s_textureUnitManager.getUnit(textureID, textSlot);
 			}
 			texture->getBaseTexture()->bindToSlot(textSlot);
 		}
-
-		s_data->model = glm::scale(glm::rotate(glm::translate(glm::mat4(1.f), quad.m_translate), angle, {0.f, 0.f, 1.f }), quad.m_scale);
+		textSlot |= unitFlags(textureID);
 
 		uint32_t packedTint = Renderer2DVertex::pack(tint);
 
+		if (s_data->mode == Renderer2DMode::Instanced) {
+			writeInstance(quad, angle, packedTint, textSlot, texture);
+			return;
+		}
+
+		s_data->model = glm::scale(glm::rotate(glm::translate(glm::mat4(1.f), quad.m_translate), angle, {0.f, 0.f, 1.f }), quad.m_scale);
+
 		uint32_t startIdx = s_data->drawCount;
 		for (int i = 0; i < 4; i++) {
 			s_data->vertices[i + startIdx].position = s_data->model * s_data->quad[i];
@@ -196,15 +255,221 @@ namespace Engine {
 		s_data->drawCount += 4;
 	}
 
+	void Renderer2D::startBatch(){
+		uint32_t remaining = (s_data->regionCapacity - s_data->regionUsed) * 4;
+		s_data->batchCapacity = remaining < s_data->batchSize ? remaining : s_data->batchSize;
+		if (s_data->mode == Renderer2DMode::Instanced) s_data->instances = static_cast<Renderer2DInstance*>(s_data->region) + s_data->regionUsed;
+		else s_data->vertices = static_cast<Renderer2DVertex*>(s_data->region) + s_data->regionUsed * 4;
+	}
+
+	void Renderer2D::writeInstance(const Quad& quad, float angle, uint32_t packedTint, uint32_t textSlot, const std::shared_ptr<SubTexture>& texture)
+	{
+		Renderer2DInstance& instance = s_data->instances[s_data->drawCount / 4];
+
+		instance.translate = { quad.m_translate.x, quad.m_translate.y };
+		instance.scale = { quad.m_scale.x, quad.m_scale.y };
+		Renderer2DInstance::packUVs(texture->getUVStart(), texture->getUVEnd(), instance.uvRect);
+		instance.rotation = { std::cos(angle), std::sin(angle) };
+		instance.texUnit = textSlot;
+		instance.tint = packedTint;
+
+		s_data->drawCount += 4;
+	}
+
+	void Renderer2D::submitBatch(const QuadInstance* quads, uint32_t count){
+		if (s_data->deferred) {
+			for (uint32_t i = 0; i < count; i++) defer(quads[i], s_data->layer);
+			return;
+		}
+
+		writeBatch(quads, count);
+	}
+
+	void Renderer2D::writeBatch(const QuadInstance* quads, uint32_t count){
+		uint32_t submitted = 0;
+
+		while (submitted < count) {
+			if (s_data->drawCount + 4 > s_data->batchCapacity) flush();
+
+			// Resolve texture units up front for as many quads as fit in this batch
+			uint32_t room = std::min((s_data->batchCapacity - s_data->drawCount) / 4, count - submitted);
+			uint32_t resolved = 0;
+			bool unitsExhausted = false;
+			const SubTexture* lastTexture = nullptr;
+			uint32_t textSlot = 0;
+			glm::vec4 uvRect;
+
+			for (; resolved < room; resolved++) {
+				const SubTexture* texture = quads[submitted + resolved].texture;
+				if (!texture) texture = s_data->defaultSubTexture.get();
+
+				if (texture != lastTexture) {
+					const uint32_t& textureID = texture->getBaseTexture()->getRenderID();
+					bool needsBinding = RendererCommon::s_textureUnitManager.getUnit(textureID, textSlot);
+					if (needsBinding) {
+						if (textSlot == -1) {
+							unitsExhausted = true;
+							break;
+						}
+						texture->getBaseTexture()->bindToSlot(textSlot);
+					}
+					textSlot |= unitFlags(textureID);
+					lastTexture = texture;
+					uvRect = glm::vec4(texture->getUVStart(), texture->getUVEnd());
+				}
+
+				s_data->batchTexUnits[resolved] = textSlot;
+				s_data->batchUVRects[resolved] = uvRect;
+			}
+
+			if (s_data->mode == Renderer2DMode::Instanced)
+				QuadBatch::writeInstances(quads + submitted, s_data->batchTexUnits.data(), s_data->batchUVRects.data(), resolved, s_data->instances + s_data->drawCount / 4);
+			else
+				QuadBatch::writeVertices(quads + submitted, s_data->batchTexUnits.data(), s_data->batchUVRects.data(), resolved, s_data->vertices + s_data->drawCount);
+			s_data->drawCount += resolved * 4;
+			submitted += resolved;
+
+			// Every unit is taken by a texture this batch uses, draw it so its units can be evicted
+			if (unitsExhausted) flush();
+		}
+	}
+
+	void Renderer2D::setLayer(int32_t layer){
+		s_data->layer = layer;
+	}
+
+	void Renderer2D::setStrictOrder(bool strict){
+		// A new segment, so nothing is sorted across the point the order changed
+		if (strict != s_data->strictOrder) s_data->sortSegment++;
+		s_data->strictOrder = strict;
+	}
+
+	uint32_t Renderer2D::getDrawCalls(){
+		return s_data->drawCalls;
+	}
+
+	uint32_t Renderer2D::unitFlags(uint32_t textureID){
+		return (textureID == s_data->sdfTextureID) ? sdfUnitFlag : 0;
+	}
+
+	const GlyphCacheStats& Renderer2D::getGlyphCacheStats(){
+		return s_data->glyphCache->getStats();
+	}
+
+	void Renderer2D::defer(const QuadInstance& quad, int32_t layer){
+		const SubTexture* texture = quad.texture ? quad.texture : s_data->defaultSubTexture.get();
+		const std::shared_ptr<OpenGLTexture>& baseTexture = texture->getBaseTexture();
+		uint32_t index = static_cast<uint32_t>(s_data->deferredQuads.size());
+
+		// Alpha masks, luminance alpha and RGBA textures may blend, only RGB and the default white texture are known to be opaque
+		bool translucent = quad.tint.a < 1.f || (baseTexture != s_data->defaultTexture && baseTexture->getChannels() != 3);
+		uint64_t key = QuadBatch::sortKey(layer, s_data->sortSegment, translucent, s_data->strictOrder, baseTexture->getRenderID(), index);
+
+		s_data->deferredQuads.push_back(quad);
+		s_data->sortEntries.push_back({ key, index });
+	}
+
+	void Renderer2D::submitDeferred(){
+		uint32_t count = static_cast<uint32_t>(s_data->deferredQuads.size());
+		if (count == 0) return;
+
+		s_data->sortScratch.resize(count);
+		radixSort(s_data->sortEntries.data(), s_data->sortScratch.data(), count);
+
+		s_data->mergedQuads.clear();
+		for (const SortEntry& entry : s_data->sortEntries) s_data->mergedQuads.push_back(s_data->deferredQuads[entry.index]);
+
+		// Sorted by texture, so each run of up to 32 textures fills the units once and is drawn once
+		writeBatch(s_data->mergedQuads.data(), count);
+
+		s_data->deferredQuads.clear();
+		s_data->sortEntries.clear();
+	}
+
+	std::shared_ptr<Renderer2DRecorder> Renderer2D::createRecorder(){
+		std::shared_ptr<Renderer2DRecorder> recorder = std::make_shared<Renderer2DRecorder>();
+
+		std::lock_guard<std::mutex> lock(s_data->recorderMutex);
+		s_data->recorders.push_back(recorder);
+
+		return recorder;
+	}
+
+	void Renderer2D::mergeRecorders(){
+		std::lock_guard<std::mutex> lock(s_data->recorderMutex);
+
+		// Hold every live recorder until the merge is done, dropping the ones which no longer exist
+		std::vector<std::shared_ptr<Renderer2DRecorder>> live;
+		for (auto it = s_data->recorders.begin(); it != s_data->recorders.end();) {
+			std::shared_ptr<Renderer2DRecorder> recorder = it->lock();
+			if (recorder) { live.push_back(recorder); ++it; }
+			else it = s_data->recorders.erase(it);
+		}
+
+		Renderer2DRecorder::merge(live, s_data->mergeCommands);
+		submitRecorded();
+
+		for (const auto& recorder : live) recorder->clear();
+	}
+	void Renderer2D::submit(const Renderer2DRecorder::Snapshot& snapshot){
+		s_data->mergeCommands.clear();
+		for (uint32_t i = 0; i < snapshot.count; i++) s_data->mergeCommands.push_back({ &snapshot.commands[i], snapshot.text });
+		submitRecorded();
+	}
+	void Renderer2D::submitRecorded(){
+		if (s_data->mergeCommands.empty()) return;
+
+		s_data->mergedQuads.clear();
+		for (const Renderer2DRecorder::MergedCommand& merge : s_data->mergeCommands) {
+			const Renderer2DRecorder::Command& command = *merge.command;
+			size_t first = s_data->mergedQuads.size();
+			if (command.textLength == 0) s_data->mergedQuads.push_back(command.quad);
+			else layoutText(merge.text + command.textOffset, command.textLength, command.quad.translate, command.quad.tint, s_data->mergedQuads);
+
+			// Deferred quads keep the layer they were recorded on
+			if (s_data->deferred) {
+				for (size_t i = first; i < s_data->mergedQuads.size(); i++) defer(s_data->mergedQuads[i], command.layer);
+			}
+		}
+		if (s_data->deferred) return;
+
+		// Texture units are resolved here on the render thread
+		writeBatch(s_data->mergedQuads.data(), static_cast<uint32_t>(s_data->mergedQuads.size()));
+	}
+
+	void Renderer2D::layoutText(const char* text, uint32_t length, const glm::vec2& position, const glm::vec4& tint, std::vector<QuadInstance>& out){
+		float x = position.x;
+		const char* end = text + length;
+
+		while (text < end) {
+			const GlyphData* glyphData = s_data->glyphCache->get(GlyphCache::decodeUTF8(text, end));
+			if (!glyphData) continue;
+			const GlyphData& gd = *glyphData;
+
+			QuadInstance glyph;
+			glyph.translate = glm::vec2(x, position.y) + gd.bearing + gd.size * 0.5f;
+			glyph.scale = gd.size;
+			glyph.tint = tint;
+			glyph.texture = gd.subTexture.get();
+			out.push_back(glyph);
+
+			x += gd.advance;
+		}
+	}
+
 	void Renderer2D::submit(char ch, const glm::vec2& position, float& advance, const glm::vec4& tint){
+		submitGlyph(static_cast<unsigned char>(ch), position, advance, tint, 1.f);
+	}
 
-		if (ch >= s_data->firstGlyph && ch <= s_data->lastGlyph) {
-			GlyphData& gd = s_data->glyphData.at(ch - s_data->firstGlyph);
+	void Renderer2D::submitGlyph(uint32_t codepoint, const glm::vec2& position, float& advance, const glm::vec4& tint, float scale){
+		const GlyphData* glyphData = s_data->glyphCache->get(codepoint);
+		if (glyphData) {
+			const GlyphData& gd = *glyphData;
 
-			advance = gd.advance;
+			advance = gd.advance * scale;
 			// Calculate the quad for the glyph
-			glm::vec2 glyphHalfExtents(gd.size * 0.5f);
-			glm::vec2 glyphCentre = (position + gd.bearing) + glyphHalfExtents;
+			glm::vec2 glyphHalfExtents(gd.size * 0.5f * scale);
+			glm::vec2 glyphCentre = (position + gd.bearing * scale) + glyphHalfExtents;
 			Quad quad = Quad::createCentralHalfExtents(glyphCentre, glyphHalfExtents);
 
 			submit(quad, tint, gd.subTexture);
@@ -212,39 +477,180 @@ namespace Engine {
 	}
 
 	void Renderer2D::submit(const char* text, const glm::vec2& position, const glm::vec4& tint){
-		uint32_t len = strlen(text);
+		submit(text, position, tint, 1.f);
+	}
+
+	void Renderer2D::submit(const char* text, const glm::vec2& position, const glm::vec4& tint, float scale){
+		const char* end = text + strlen(text);
 		float advance = 0.f, x = position.x;
 
-		for (int32_t i = 0; i < len; i++) {
-			submit(text[i],{x, position.y}, advance, tint);
+		while (text < end) {
+			advance = 0.f;
+			submitGlyph(GlyphCache::decodeUTF8(text, end), {x, position.y}, advance, tint, scale);
 			x += advance;
 		}
 	}
 
+	void Renderer2D::layoutRun(TextRun& run){
+		// A glyph miss can repack the atlas, which moves the glyphs already laid out, so lay out again until nothing moved
+		uint32_t generation;
+		do {
+			generation = s_data->fontGeneration;
+			layoutRunGlyphs(run);
+		} while (generation != s_data->fontGeneration);
+
+		run.m_fontGeneration = s_data->fontGeneration;
+	}
+
+	void Renderer2D::layoutRunGlyphs(TextRun& run){
+		run.m_glyphs.clear();
+		run.m_texture.reset();
+		run.m_bounds = glm::vec4(0.f);
+
+		float x = 0.f;
+		bool first = true;
+		const char* text = run.m_text.data();
+		const char* end = text + run.m_text.size();
+		while (text < end) {
+			const GlyphData* glyphData = s_data->glyphCache->get(GlyphCache::decodeUTF8(text, end));
+			if (!glyphData) continue;
+			const GlyphData& gd = *glyphData;
+			glm::vec2 min = glm::vec2(x, 0.f) + gd.bearing;
+			glm::vec2 max = min + gd.size;
+			x += gd.advance;
+
+			// Nothing to draw for blank glyphs such as space, only the advance matters
+			if (gd.size.x == 0.f || gd.size.y == 0.f) continue;
+
+			TextRun::Glyph glyph;
+			glyph.rect = glm::vec4(min, max);
+			glyph.uvRect = glm::vec4(gd.subTexture->getUVStart(), gd.subTexture->getUVEnd());
+			Renderer2DInstance::packUVs(gd.subTexture->getUVStart(), gd.subTexture->getUVEnd(), glyph.packedUVs);
+			glyph.subTexture = gd.subTexture.get();
+			run.m_glyphs.push_back(glyph);
+
+			if (!run.m_texture) run.m_texture = gd.subTexture->getBaseTexture();
+
+			if (first) run.m_bounds = glyph.rect;
+			run.m_bounds = glm::vec4(glm::min(glm::vec2(run.m_bounds.x, run.m_bounds.y), min), glm::max(glm::vec2(run.m_bounds.z, run.m_bounds.w), max));
+			first = false;
+		}
+	}
+
+	void Renderer2D::submit(TextRun& run, const glm::vec2& offset, const glm::vec4& tint, float scale){
+		if (run.m_fontGeneration != s_data->fontGeneration) layoutRun(run);
+		if (run.m_glyphs.empty()) return;
+
+		if (s_data->deferred) {
+			// Deferred quads still go through the sort, the layout is reused for their positions
+			for (const TextRun::Glyph& glyph : run.m_glyphs) {
+				QuadInstance instance;
+				instance.translate = offset + (glm::vec2(glyph.rect.x, glyph.rect.y) + glm::vec2(glyph.rect.z, glyph.rect.w)) * 0.5f * scale;
+				instance.scale = (glm::vec2(glyph.rect.z, glyph.rect.w) - glm::vec2(glyph.rect.x, glyph.rect.y)) * scale;
+				instance.tint = tint;
+				instance.texture = glyph.subTexture;
+				defer(instance, s_data->layer);
+			}
+			return;
+		}
+
+		// One texture for the whole run, so one unit lookup
+		uint32_t textSlot;
+		bool needsBinding = RendererCommon::s_textureUnitManager.getUnit(run.m_texture->getRenderID(), textSlot);
+		if (needsBinding) {
+			if (textSlot == -1) {
+				flush();
+				RendererCommon::s_textureUnitManager.getUnit(run.m_texture->getRenderID(), textSlot);
+			}
+			run.m_texture->bindToSlot(textSlot);
+		}
+		textSlot |= unitFlags(run.m_texture->getRenderID());
+
+		uint32_t packedTint = Renderer2DVertex::pack(tint);
+		uint32_t count = static_cast<uint32_t>(run.m_glyphs.size());
+		uint32_t written = 0;
+
+		while (written < count) {
+			if (s_data->drawCount + 4 > s_data->batchCapacity) flush();
+			uint32_t room = std::min((s_data->batchCapacity - s_data->drawCount) / 4, count - written);
+
+			if (s_data->mode == Renderer2DMode::Instanced) {
+				Renderer2DInstance* out = s_data->instances + s_data->drawCount / 4;
+				for (uint32_t i = 0; i < room; i++) {
+					const TextRun::Glyph& glyph = run.m_glyphs[written + i];
+					out[i].translate = offset + (glm::vec2(glyph.rect.x, glyph.rect.y) + glm::vec2(glyph.rect.z, glyph.rect.w)) * 0.5f * scale;
+					out[i].scale = (glm::vec2(glyph.rect.z, glyph.rect.w) - glm::vec2(glyph.rect.x, glyph.rect.y)) * scale;
+					memcpy(out[i].uvRect, glyph.packedUVs, sizeof(glyph.packedUVs));
+					out[i].rotation = { 1.f, 0.f };
+					out[i].texUnit = textSlot;
+					out[i].tint = packedTint;
+				}
+			}
+			else {
+				Renderer2DVertex* out = s_data->vertices + s_data->drawCount;
+				for (uint32_t i = 0; i < room; i++, out += 4) {
+					const TextRun::Glyph& glyph = run.m_glyphs[written + i];
+					glm::vec4 rect = glyph.rect * scale + glm::vec4(offset, offset);
+					const glm::vec4& uv = glyph.uvRect;
+
+					// Same corner order as the quad submissions: (-,-), (-,+), (+,+), (+,-)
+					out[0].position = { rect.x, rect.y, 1.f, 1.f }; out[0].uvCoords = { uv.x, uv.y };
+					out[1].position = { rect.x, rect.w, 1.f, 1.f }; out[1].uvCoords = { uv.x, uv.w };
+					out[2].position = { rect.z, rect.w, 1.f, 1.f }; out[2].uvCoords = { uv.z, uv.w };
+					out[3].position = { rect.z, rect.y, 1.f, 1.f }; out[3].uvCoords = { uv.z, uv.y };
+					for (int j = 0; j < 4; j++) {
+						out[j].texUnit = textSlot;
+						out[j].tint = packedTint;
+					}
+				}
+			}
+
+			s_data->drawCount += room * 4;
+			written += room;
+		}
+	}
+
 	void Renderer2D::end(){
+		mergeRecorders();
+		if (s_data->deferred) submitDeferred();
 		if (s_data->drawCount > 0) flush();
+
+		// One fence for the whole frame
+		s_data->VBO->endRegion();
+		s_data->region = nullptr;
+		s_data->vertices = nullptr;
+		s_data->instances = nullptr;
+		s_data->batchCapacity = 0;
 	}
 
 	void Renderer2D::flush() {
-		s_data->VAO->getVertexBuffers().at(0)->edit(s_data->vertices.data(), sizeof(Renderer2DVertex) * s_data->drawCount, 0);
-		glDrawElements(GL_QUADS, s_data->VAO->getDrawnCount(), GL_UNSIGNED_INT, nullptr);
+		if (s_data->drawCount == 0) return;
+		s_data->drawCalls++;
 
-		s_data->drawCount = 0;
-	}
+		// The batch starts after the earlier batches of this frame in the frame's region
+		uint32_t quads = s_data->drawCount / 4;
+		uint32_t firstQuad = s_data->VBO->getRegionIndex() * s_data->regionCapacity + s_data->regionUsed;
 
-	void Renderer2D::RtoRGBA(unsigned char *DSTbuffer, unsigned char* SRCBuffer, uint32_t width, uint32_t height){
-		unsigned char* pWalker = DSTbuffer;
+		if (s_data->mode == Renderer2DMode::Instanced) {
+			// One quad's worth of indices per instance, base instance points the attributes at the start of the batch
+			glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, quads, firstQuad);
+		}
+		else {
+			// Vertices are already in the mapped region, offset the indices to the start of the batch
+			glDrawElementsBaseVertex(GL_TRIANGLES, quads * 6, GL_UNSIGNED_INT, nullptr, firstQuad * 4);
+		}
 
-		for (int32_t i = 0; i < height; i++) {
-			for (int32_t j = 0; j < width; j++) {
-				*pWalker = 255; pWalker++; // Go to A
-				*pWalker = 255; pWalker++;// Go to A
-				*pWalker = 255; pWalker++;// Go to A
-				*pWalker = *SRCBuffer; // Set alpha channel
-				pWalker++; // Go toR next pixel
-				SRCBuffer++; // Go next monochrome pixel
-			}
+		s_data->regionUsed += quads;
+		s_data->drawCount = 0;
+
+		// Only a frame which fills its whole region fences it early and moves onto the next one
+		if (s_data->regionUsed == s_data->regionCapacity) {
+			s_data->VBO->endRegion();
+			s_data->region = s_data->VBO->beginRegion();
+			s_data->regionUsed = 0;
 		}
+		startBatch();
+		RendererCommon::s_textureUnitManager.nextBatch();
 	}
 
 	Quad Quad::createCentralHalfExtents(const glm::vec2& centre, const glm::vec2& halfExtents) {
@@ -267,4 +673,11 @@ namespace Engine {
 		result = (r | g | b | a);
 		return result;
 	}
+
+	void Renderer2DInstance::packUVs(const glm::vec2& UVStart, const glm::vec2& UVEnd, uint16_t* uvRect){
+		uvRect[0] = static_cast<uint16_t>(glm::clamp(UVStart.x, 0.f, 1.f) * 65535.f + 0.5f);
+		uvRect[1] = static_cast<uint16_t>(glm::clamp(UVStart.y, 0.f, 1.f) * 65535.f + 0.5f);
+		uvRect[2] = static_cast<uint16_t>(glm::clamp(UVEnd.x, 0.f, 1.f) * 65535.f + 0.5f);
+		uvRect[3] = static_cast<uint16_t>(glm::clamp(UVEnd.y, 0.f, 1.f) * 65535.f + 0.5f);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+/** \file Renderer2DRecorder.cpp */
+#include "engine_pch.h"
+#include "rendering/Renderer2D.h"
+
+#include <algorithm>
+
+namespace Engine {
+	void Renderer2DRecorder::submit(const Quad& quad, const glm::vec4& tint){
+		submit(quad, tint, 0.f);
+	}
+
+	void Renderer2DRecorder::submit(const Quad& quad, const std::shared_ptr<SubTexture>& texture){
+		submit(quad, glm::vec4(1.f), texture, 0.f);
+	}
+
+	void Renderer2DRecorder::submit(const Quad& quad, const glm::vec4& tint, const std::shared_ptr<SubTexture>& texture){
+		submit(quad, tint, texture, 0.f);
+	}
+
+	void Renderer2DRecorder::submit(const Quad& quad, const glm::vec4& tint, float angle, bool degrees){
+		submit(quad, tint, nullptr, angle, degrees);
+	}
+
+	void Renderer2DRecorder::submit(const Quad& quad, const std::shared_ptr<SubTexture>& texture, float angle, bool degrees){
+		submit(quad, glm::vec4(1.f), texture, angle, degrees);
+	}
+
+	void Renderer2DRecorder::submit(const Quad& quad, const glm::vec4& tint, const std::shared_ptr<SubTexture>& texture, float angle, bool degrees){
+		if (degrees) angle = glm::radians(angle);
+
+		QuadInstance instance;
+		instance.translate = { quad.m_translate.x, quad.m_translate.y };
+		instance.scale = { quad.m_scale.x, quad.m_scale.y };
+		instance.setRotation(angle);
+		instance.tint = tint;
+		instance.texture = texture.get(); // Null picks the default white texture when merged
+
+		submit(instance);
+	}
+
+	void Renderer2DRecorder::submit(const QuadInstance& quad){
+		m_commands.push_back({ quad, m_layer, 0, 0 });
+	}
+
+	void Renderer2DRecorder::submit(const char* text, const glm::vec2& position, const glm::vec4& tint){
+		uint32_t length = static_cast<uint32_t>(strlen(text));
+		if (length == 0) return;
+
+		QuadInstance instance;
+		instance.translate = position;
+		instance.tint = tint;
+
+		m_commands.push_back({ instance, m_layer, static_cast<uint32_t>(m_text.size()), length });
+		m_text.append(text, length);
+	}
+
+	void Renderer2DRecorder::merge(const std::vector<std::shared_ptr<Renderer2DRecorder>>& recorders, std::vector<MergedCommand>& merged){
+		// Gather in recorder creation order then submission order
+		merged.clear();
+		for (const auto& recorder : recorders)
+			for (const Command& command : recorder->m_commands) merged.push_back({ &command, recorder->m_text.data() });
+
+		// Stable so equal layers keep the gathered order, which makes the result independent of thread timing
+		std::stable_sort(merged.begin(), merged.end(), [](const MergedCommand& a, const MergedCommand& b) { return a.command->layer < b.command->layer; });
+	}
+
+	void Renderer2DRecorder::clear(){
+		m_commands.clear();
+		m_text.clear();
+	}
+
+	Renderer2DRecorder::Snapshot Renderer2DRecorder::snapshot(FramePacket& packet){
+		Snapshot snapshot;
+		snapshot.commands = packet.snapshot(m_commands.data(), m_commands.size());
+		snapshot.count = static_cast<uint32_t>(m_commands.size());
+		snapshot.text = packet.snapshot(m_text.data(), m_text.size());
+
+		clear();
+		return snapshot;
+	}
+}
@@ -9,7 +9,7 @@
 namespace Engine{
 
 	std::shared_ptr<Renderer3D::InternalData> Renderer3D::s_data = nullptr;
-	TextureUnitManager RendererCommon::s_textureUnitManager = TextureUnitManager(32);
+	uint32_t Material::s_nextID = 0;
 
 	void Renderer3D::init(){
 		s_data.reset(new InternalData);
@@ -27,51 +27,410 @@ namespace Engine{
 		s_data->lightUBO->uploadData("u_lightPos", glm::value_ptr(s_data->lightPos));
 		s_data->lightUBO->uploadData("u_viewPos", glm::value_ptr(s_data->viewPos));
 		s_data->lightUBO->uploadData("u_lightColour", glm::value_ptr(s_data->lightColour));
+
+		s_data->transformSSBO.reset(new OpenGLStorageBuffer(1024 * sizeof(ObjectTransform)));
+		s_data->materialSSBO.reset(new OpenGLStorageBuffer(1024 * sizeof(DrawMaterial)));
+		s_data->indirectBuffer.reset(new OpenGLStorageBuffer(1024 * sizeof(DrawElementsIndirectCommand)));
+		s_data->lightSSBO.reset(new OpenGLStorageBuffer(256 * sizeof(Light)));
+		s_data->clusterSSBO.reset(new OpenGLStorageBuffer(sizeof(ClusterHeader) + s_data->lightClusters.getClusterCount() * sizeof(LightCluster)));
+		s_data->lightIndexSSBO.reset(new OpenGLStorageBuffer(16384 * sizeof(uint32_t)));
+
+		// 8MB of vertices and 1M indices per page, 64K draws per scene
+		s_data->geometryArena.reset(new OpenGLGeometryArena(8 * 1024 * 1024, 1024 * 1024, 65536, s_data->drawIDLocation));
 	}
 	void Renderer3D::begin(const SceneWideUniforms& sceneWideUniforms){
+		s_data->stats = Renderer3DStats();
 		s_data->sceneWideUniforms = sceneWideUniforms;
-		s_data->cameraUBO->uploadData("u_projection", sceneWideUniforms.at("u_projection").second);
-		s_data->cameraUBO->uploadData("u_view", sceneWideUniforms.at("u_view").second);
 
-		s_data->lightUBO->uploadData("u_viewPos", glm::value_ptr(s_data->viewPos));
+		// Uploaded by draw(), which may run on another thread
+		s_data->view = *static_cast<glm::mat4*>(sceneWideUniforms.at("u_view").second);
+		s_data->projection = *static_cast<glm::mat4*>(sceneWideUniforms.at("u_projection").second);
+		s_data->frustum = Culling::extractFrustum(s_data->projection * s_data->view);
+		s_data->occlusionCuller.begin(s_data->projection * s_data->view);
+		// Kept from the last scene until here, the scene end() returns points into them
+		s_data->packets.clear();
+		s_data->sortEntries.clear();
+		s_data->lights.clear();
+	}
+	ArenaMesh Renderer3D::addGeometry(const VertexBufferLayout& layout, const void* vertices, uint32_t size, const uint32_t* indices, uint32_t indexCount){
+		return s_data->geometryArena->add(layout, vertices, size, indices, indexCount);
 	}
 	void Renderer3D::submit(const std::shared_ptr<OpenGLVertexArray> geometry, const std::shared_ptr<Material>& material, const glm::mat4& model){
-		//Bind shader
-		glUseProgram(material->getShader()->getRenderID());
-		glBindVertexArray(geometry->getRenderID());
+		record({ geometry.get(), ArenaMesh(), material.get(), model });
+	}
+	void Renderer3D::submit(const ArenaMesh& mesh, const std::shared_ptr<Material>& material, const glm::mat4& model){
+		record({ nullptr, mesh, material.get(), model });
+	}
+	void Renderer3D::submit(const LODSet& lods, LODState& state, const std::shared_ptr<Material>& material, const glm::mat4& model){
+		uint32_t levelCount = lods.getLevelCount();
+		if (levelCount == 0) return;
+
+		// Unbounded geometry always covers the screen
+		float screenSize = std::numeric_limits<float>::max();
+		if (lods.getBounds().isBounded()) {
+			glm::vec4 sphere = Culling::transformSphere(lods.getBounds().sphere, model);
+			screenSize = LODSet::projectedSize(sphere, s_data->view, s_data->projection) * s_data->lodScale;
+		}
+		lods.update(screenSize, state);
+
+		auto recordLevel = [&](uint32_t index, bool fadeOut) {
+			const LODLevel& level = lods.getLevel(index);
+			Material* levelMaterial = level.material ? level.material.get() : material.get();
+			record({ level.geometry.get(), level.mesh, levelMaterial, model, state.fade, fadeOut });
+
+			s_data->stats.lodObjects[index]++;
+			s_data->stats.lodTriangles[index] += level.getTriangleCount();
+		};
+
+		if (state.fade < 1.f && state.previous < levelCount) recordLevel(state.previous, true);
+		if (state.level < levelCount) recordLevel(state.level, false);
+	}
+	void Renderer3D::submit(const Light& light){
+		s_data->lights.push_back(light);
+	}
+	void Renderer3D::submitOccluder(const void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t offset, const uint32_t* indices, uint32_t indexCount, const glm::mat4& model){
+		s_data->occlusionCuller.addOccluder(vertices, vertexCount, stride, offset, indices, indexCount, model);
+	}
+	void Renderer3D::setLODBias(float bias){
+		s_data->lodBias = bias;
+		s_data->lodScale = std::exp2(-bias);
+	}
+	void Renderer3D::record(const DrawPacket& packet){
+		uint32_t index = static_cast<uint32_t>(s_data->packets.size());
+		s_data->packets.push_back(packet);
+		s_data->sortEntries.push_back({ sortKey(vertexSource(packet), *packet.material, packet.model), index });
+	}
+	uint32_t Renderer3D::vertexSource(const DrawPacket& packet){
+		if (packet.geometry) return packet.geometry->getRenderID() & 0xFFF;
+		return (s_data->geometryArena->getVertexArray(packet.mesh.bucket)->getRenderID() & 0xFF) | ((packet.mesh.page & 0xF) << 8);
+	}
+	uint64_t Renderer3D::sortKey(uint32_t vertexSource, const Material& material, const glm::mat4& model){
+		// Distance in front of the camera, quantised to 24 bits
+		float depth = -(s_data->view * model[3]).z;
+		uint64_t depthBits = static_cast<uint64_t>(glm::clamp(depth / s_data->depthRange, 0.f, 1.f) * 16777215.f);
+
+		uint64_t shaderBits = material.getShader()->getRenderID() & 0x3FF;
+		uint64_t sourceBits = vertexSource & 0xFFF;
+		uint64_t materialBits = material.getID() & 0xFFFF;
+
+		bool transparent = material.isFlagSet(Material::flag_tint) && material.getTint().a < 1.f;
+		if (transparent) {
+			// Transparent after opaque, back to front, then state
+			return (1ull << 63) | ((16777215ull - depthBits) << 39) | (shaderBits << 29) | (sourceBits << 17) | (materialBits << 1);
+		}
+		// Opaque by shader, vertex source and material, front to back within the same state
+		return (shaderBits << 53) | (sourceBits << 41) | (materialBits << 25) | (depthBits << 1);
+	}
+	void Renderer3D::end(){
+		draw(prepare());
+		s_data->sceneWideUniforms.clear();
+	}
+	Renderer3D::Scene Renderer3D::end(FramePacket& packet){
+		Scene scene = prepare();
+		s_data->sceneWideUniforms.clear();
+
+		// The next scene is recorded into the internal copies while the packet waits to be drawn
+		scene.packets = packet.snapshot(s_data->packets.data(), s_data->packets.size());
+		scene.entries = packet.snapshot(s_data->sortEntries.data(), scene.count);
+		scene.transforms = packet.snapshot(s_data->transforms.data(), scene.count);
+		scene.lights = packet.snapshot(s_data->lights.data(), scene.lightCount);
+		scene.clusters = packet.snapshot(scene.clusters, scene.clusterCount);
+		scene.lightIndices = packet.snapshot(scene.lightIndices, scene.lightIndexCount);
+		return scene;
+	}
+	void Renderer3D::draw(const Scene& scene){
+		s_data->drawStats = scene.stats;
+
+		s_data->cameraUBO->uploadData("u_projection", const_cast<float*>(glm::value_ptr(scene.projection)));
+		s_data->cameraUBO->uploadData("u_view", const_cast<float*>(glm::value_ptr(scene.view)));
+		s_data->lightUBO->uploadData("u_viewPos", glm::value_ptr(s_data->viewPos));
+
+		uploadLights(scene);
+		execute(scene);
+	}
+	Renderer3D::Scene Renderer3D::prepare(){
+		cull();
+
+		const std::vector<SortEntry>& entries = s_data->sortEntries;
+		uint32_t count = static_cast<uint32_t>(entries.size());
+		s_data->sortScratch.resize(count);
+		radixSort(s_data->sortEntries.data(), s_data->sortScratch.data(), count);
+
+		// Per draw data in draw order, indexed by the draw ID
+		s_data->transforms.resize(count);
+		for (uint32_t i = 0; i < count; i++) s_data->transforms[i].model = s_data->packets[entries[i].index].model;
+		TransformBatch::writeNormalMatrices(s_data->transforms.data(), count);
 
-		//Apply material uniforms ( Per draw uniforms )
-		material->getShader()->uploadMat4("u_model", model);
+		binLights();
 
-		std::shared_ptr<OpenGLTexture> texture;
-		if (material->isFlagSet(Material::flag_texture)) {
-			texture = material->getTexture();
+		const LightClusters& clusters = s_data->lightClusters;
+		Scene scene;
+		scene.view = s_data->view;
+		scene.projection = s_data->projection;
+		scene.packets = s_data->packets.data();
+		scene.entries = entries.data();
+		scene.count = count;
+		scene.transforms = s_data->transforms.data();
+		scene.lights = s_data->lights.data();
+		scene.lightCount = static_cast<uint32_t>(s_data->lights.size());
+		scene.clusterHeader = clusters.getHeader(scene.lightCount);
+		scene.clusters = clusters.getClusters().data();
+		scene.clusterCount = clusters.getClusterCount();
+		scene.lightIndices = clusters.getLightIndices().data();
+		scene.lightIndexCount = static_cast<uint32_t>(clusters.getLightIndices().size());
+		scene.stats = s_data->stats;
+		return scene;
+	}
+	void Renderer3D::cull(){
+		const std::vector<DrawPacket>& packets = s_data->packets;
+		uint32_t count = static_cast<uint32_t>(packets.size());
+
+		s_data->spheres.resize(count);
+		s_data->visibility.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			const DrawPacket& packet = packets[i];
+			const BoundingVolume& bounds = packet.geometry ? packet.geometry->getBounds() : packet.mesh.bounds;
+			s_data->spheres[i] = Culling::transformSphere(bounds.sphere, packet.model);
 		}
-		else {
-			texture = s_data->defaultTexture;
+
+		uint32_t visibleCount = Culling::cullSpheres(s_data->frustum, s_data->spheres.data(), count, s_data->visibility.data());
+
+		// Packets which survive the frustum are tested against the occluder depth hierarchy by their world box
+		OcclusionCuller& occlusion = s_data->occlusionCuller;
+		uint32_t occluded = 0;
+		if (occlusion.hasOccluders()) {
+			occlusion.rasterize();
+			for (uint32_t i = 0; i < count; i++) {
+				if (!s_data->visibility[i]) continue;
+				const DrawPacket& packet = packets[i];
+				const BoundingVolume& bounds = packet.geometry ? packet.geometry->getBounds() : packet.mesh.bounds;
+				if (!bounds.isBounded()) continue;
+
+				if (!occlusion.isVisible(Culling::transformAABB(bounds.min, bounds.max, packet.model))) {
+					s_data->visibility[i] = 0;
+					occluded++;
+				}
+			}
+			s_data->stats.occluderTriangles = occlusion.getStats().occluderTriangles;
 		}
 
-		uint32_t textSlot;
+		// Compact the unsorted entries, culled packets never reach the sort or GL
+		std::vector<SortEntry>& entries = s_data->sortEntries;
+		uint32_t kept = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			if (s_data->visibility[entries[i].index]) entries[kept++] = entries[i];
+		}
+		entries.resize(kept);
+
+		s_data->stats.visible = visibleCount - occluded;
+		s_data->stats.culled = count - visibleCount;
+		s_data->stats.occluded = occluded;
+	}
+	void Renderer3D::binLights(){
+		LightClusters& clusters = s_data->lightClusters;
+		uint32_t lightCount = static_cast<uint32_t>(s_data->lights.size());
+
+		// Binned every scene, even without lights, so no cluster keeps last scene's lights
+		clusters.bin(s_data->lights.data(), lightCount, s_data->view, s_data->projection);
+
+		s_data->stats.lights = lightCount;
+		s_data->stats.lightAssignments = static_cast<uint32_t>(clusters.getLightIndices().size());
+	}
+	void Renderer3D::uploadLights(const Scene& scene){
+		uint32_t clusterSize = scene.clusterCount * sizeof(LightCluster);
+		s_data->clusterSSBO->allocate(sizeof(ClusterHeader) + clusterSize);
+		s_data->clusterSSBO->edit(&scene.clusterHeader, sizeof(ClusterHeader), 0);
+		s_data->clusterSSBO->edit(scene.clusters, clusterSize, sizeof(ClusterHeader));
+
+		s_data->lightSSBO->upload(scene.lights, scene.lightCount * sizeof(Light));
+		s_data->lightIndexSSBO->upload(scene.lightIndices, scene.lightIndexCount * sizeof(uint32_t));
+
+		s_data->lightSSBO->bind(s_data->lightBinding);
+		s_data->clusterSSBO->bind(s_data->clusterBinding);
+		s_data->lightIndexSSBO->bind(s_data->lightIndexBinding);
+	}
+	bool Renderer3D::resolveUnit(const Material& material, uint32_t& unit){
+		const std::shared_ptr<OpenGLTexture>& texture = material.isFlagSet(Material::flag_texture) ? material.getTexture() : s_data->defaultTexture;
+
 		const uint32_t& textureID = texture->getRenderID();
-		bool needsBinding = RendererCommon::s_textureUnitManager.getUnit(textureID, textSlot);
+		bool needsBinding = RendererCommon::s_textureUnitManager.getUnit(textureID, unit);
 
 		if (needsBinding) {
-			if (textSlot == -1) {
-				RendererCommon::s_textureUnitManager.clear();
-				RendererCommon::s_textureUnitManager.getUnit(textureID, textSlot);
+			if (unit == -1) return false; // Every unit is read by the draw being built
+			texture->bindToSlot(unit);
+			s_data->drawStats.textureBinds++;
+		}
+		return true;
+	}
+	void Renderer3D::execute(const Scene& scene){
+		Renderer3DStats& stats = s_data->drawStats;
+
+		const SortEntry* entries = scene.entries;
+		const DrawPacket* packets = scene.packets;
+		uint32_t count = scene.count;
+		if (count == 0) return;
+
+		// Only the packets which survived culling need a draw ID
+		s_data->geometryArena->reserveDraws(count);
+
+		s_data->transformSSBO->upload(scene.transforms, count * sizeof(ObjectTransform));
+		s_data->transformSSBO->bind(s_data->transformBinding);
+
+		// Materials and commands are written per bucket, once their texture units are known
+		s_data->drawMaterials.resize(count);
+		s_data->materialSSBO->allocate(count * sizeof(DrawMaterial));
+		s_data->materialSSBO->bind(s_data->materialBinding);
+		s_data->commands.resize(count);
+		s_data->indirectBuffer->allocate(count * sizeof(DrawElementsIndirectCommand));
+		OpenGLStateCache::bindBuffer(GL_DRAW_INDIRECT_BUFFER, s_data->indirectBuffer->getRenderID());
+
+		uint32_t currentProgram = 0;
+		uint32_t currentVAO = 0;
+		const ArenaMesh* currentPage = nullptr;
+		bool fetchesPerDraw = false;
+		DrawUniforms uniforms;
+		uint32_t commandCount = 0;
+
+		uint32_t i = 0;
+		while (i < count) {
+			const DrawPacket& packet = packets[entries[i].index];
+			OpenGLShader& shader = *packet.material->getShader();
+
+			//Bind shader
+			bool programChanged = shader.getRenderID() != currentProgram;
+			if (programChanged) {
+				OpenGLStateCache::useProgram(shader.getRenderID());
+				currentProgram = shader.getRenderID();
+				fetchesPerDraw = shader.getInputLocation("a_drawId") == static_cast<int32_t>(s_data->drawIDLocation);
+				uniforms = { shader.getUniform<int32_t>("u_texData"), shader.getUniform<glm::vec4>("u_tint"), shader.getUniform<glm::mat4>("u_model"), shader.getUniform<float>("u_fade"), shader.getUniform<int32_t>("u_fadeOut") };
+				stats.shaderChanges++;
+			}
+
+			//Bind geometry
+			OpenGLVertexArray* VAO = packet.geometry ? packet.geometry : s_data->geometryArena->getVertexArray(packet.mesh.bucket).get();
+			if (VAO->getRenderID() != currentVAO) {
+				OpenGLStateCache::bindVertexArray(VAO->getRenderID());
+				currentVAO = VAO->getRenderID();
+				currentPage = nullptr;
+				stats.vaoChanges++;
+			}
+			if (!packet.geometry && (!currentPage || currentPage->page != packet.mesh.page)) {
+				s_data->geometryArena->bindPage(packet.mesh);
+				currentPage = &packet.mesh;
+				stats.pageChanges++;
+			}
+
+			if (fetchesPerDraw) {
+				if (!VAO->hasDrawIDs()) VAO->addDrawIDBuffer(s_data->geometryArena->getDrawIDBuffer(), s_data->drawIDLocation);
+				i += drawIndirect(scene, i, shader, uniforms.texData, commandCount);
+			}
+			else {
+				drawUniforms(packet, shader, uniforms, programChanged || packets[entries[i - 1].index].material != packet.material);
+				i++;
 			}
-			texture->bindToSlot(textSlot);
 		}
+	}
+	void Renderer3D::drawUniforms(const DrawPacket& packet, OpenGLShader& shader, const DrawUniforms& uniforms, bool applyMaterial){
+		//Apply material uniforms, only when the material differs from the last draw
+		if (applyMaterial) {
+			// Each draw is issued straight away, so no unit is held by an earlier one
+			uint32_t textSlot;
+			RendererCommon::s_textureUnitManager.nextBatch();
+			resolveUnit(*packet.material, textSlot);
 
-		material->getShader()->uploadInt("u_texData", textSlot);
+			shader.upload(uniforms.texData, static_cast<int32_t>(textSlot));
 
-		if (material->isFlagSet(Material::flag_tint)) material->getShader()->uploadFloat4("u_tint", material->getTint());
-		else material->getShader()->uploadFloat4("u_tint", s_data->defaultTint);
+			if (packet.material->isFlagSet(Material::flag_tint)) shader.upload(uniforms.tint, packet.material->getTint());
+			else shader.upload(uniforms.tint, s_data->defaultTint);
 
-		glDrawElements(GL_TRIANGLES, geometry->getDrawnCount(), GL_UNSIGNED_INT, nullptr);
+			s_data->drawStats.materialChanges++;
+		}
+
+		// Shaders which cannot dither drop the outgoing LOD level rather than draw both
+		if (uniforms.fade.isValid()) {
+			shader.upload(uniforms.fade, packet.fade);
+			shader.upload(uniforms.fadeOut, packet.fadeOut ? 1 : 0);
+		}
+		else if (packet.fadeOut) return;
+
+		// Per draw uniforms
+		shader.upload(uniforms.model, packet.model);
+
+		uint32_t indexCount = packet.geometry ? packet.geometry->getDrawnCount() : packet.mesh.indexCount;
+		uint32_t firstIndex = packet.geometry ? 0 : packet.mesh.firstIndex;
+		int32_t baseVertex = packet.geometry ? 0 : packet.mesh.baseVertex;
+		glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(uint32_t)), baseVertex);
+		s_data->drawStats.draws++;
 	}
-	void Renderer3D::end(){
-		s_data->sceneWideUniforms.clear();
+	uint32_t Renderer3D::drawIndirect(const Scene& scene, uint32_t first, OpenGLShader& shader, UniformHandle<int32_t> texData, uint32_t& commandCount){
+		Renderer3DStats& stats = s_data->drawStats;
+		const SortEntry* entries = scene.entries;
+		const DrawPacket* packets = scene.packets;
+		uint32_t count = scene.count;
+
+		const DrawPacket& head = packets[entries[first].index];
+		uint32_t firstCommand = commandCount;
+
+		// Units read by earlier buckets may be evicted, the bucket's own are held until it is drawn
+		RendererCommon::s_textureUnitManager.nextBatch();
+
+		// One sampler is read by the whole multi draw, indexing an array by the draw ID would not be dynamically uniform
+		auto textureOf = [](const Material& material) { return material.isFlagSet(Material::flag_texture) ? material.getTexture().get() : s_data->defaultTexture.get(); };
+		const OpenGLTexture* texture = textureOf(*head.material);
+		uint32_t unit;
+		resolveUnit(*head.material, unit); // A new batch always has a unit for its first texture
+
+		// The bucket runs while the shader, vertex source and texture stay the same
+		uint32_t end = first;
+		while (end < count) {
+			const DrawPacket& packet = packets[entries[end].index];
+			if (packet.material->getShader() != head.material->getShader() || packet.geometry != head.geometry) break;
+			if (!packet.geometry && (packet.mesh.bucket != head.mesh.bucket || packet.mesh.page != head.mesh.page)) break;
+			if (textureOf(*packet.material) != texture) break;
+
+			DrawMaterial& drawMaterial = s_data->drawMaterials[end];
+			drawMaterial.tint = packet.material->isFlagSet(Material::flag_tint) ? packet.material->getTint() : s_data->defaultTint;
+			drawMaterial.texUnit = static_cast<int32_t>(unit);
+			drawMaterial.fade = packet.fade;
+			drawMaterial.fadeOut = packet.fadeOut ? 1 : 0;
+
+			// Identical geometry and material extend the previous command by one instance
+			const DrawPacket* previous = end > first ? &packets[entries[end - 1].index] : nullptr;
+			bool sameDraw = previous && previous->material == packet.material && previous->mesh.firstIndex == packet.mesh.firstIndex && previous->mesh.baseVertex == packet.mesh.baseVertex;
+			if (sameDraw) {
+				s_data->commands[commandCount - 1].instanceCount++;
+			}
+			else {
+				DrawElementsIndirectCommand& command = s_data->commands[commandCount++];
+				command.count = packet.geometry ? packet.geometry->getDrawnCount() : packet.mesh.indexCount;
+				command.instanceCount = 1;
+				command.firstIndex = packet.geometry ? 0 : packet.mesh.firstIndex;
+				command.baseVertex = packet.geometry ? 0 : packet.mesh.baseVertex;
+				command.baseInstance = end;
+			}
+			end++;
+		}
+
+		uint32_t drawn = end - first;
+		uint32_t commands = commandCount - firstCommand;
+		s_data->materialSSBO->edit(&s_data->drawMaterials[first], drawn * sizeof(DrawMaterial), first * sizeof(DrawMaterial));
+		s_data->indirectBuffer->edit(&s_data->commands[firstCommand], commands * sizeof(DrawElementsIndirectCommand), firstCommand * sizeof(DrawElementsIndirectCommand));
+
+		shader.upload(texData, static_cast<int32_t>(unit));
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(firstCommand * sizeof(DrawElementsIndirectCommand)), commands, 0);
+
+		stats.draws++;
+		stats.indirectCommands += commands;
+		for (uint32_t c = firstCommand; c < commandCount; c++) {
+			if (s_data->commands[c].instanceCount > 1) {
+				stats.instancedDraws++;
+				stats.instances += s_data->commands[c].instanceCount;
+			}
+		}
+		return drawn;
+	}
+	const Renderer3DStats& Renderer3D::getStats(){
+		return s_data->drawStats;
 	}
 	void Renderer3D::attachShader(std::shared_ptr<OpenGLShader>& shader){
 		s_data->lightUBO->attachShaderBlock(shader, "b_lights");
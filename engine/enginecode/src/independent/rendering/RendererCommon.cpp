@@ -0,0 +1,26 @@
+/** \file RendererCommon.cpp */
+#include "engine_pch.h"
+#include "rendering/RendererCommon.h"
+
+namespace Engine {
+	TextureUnitManager RendererCommon::s_textureUnitManager = TextureUnitManager(32);
+	std::shared_ptr<OpenGLIndexBuffer> RendererCommon::s_quadIndexBuffer = nullptr;
+
+	std::shared_ptr<OpenGLIndexBuffer> RendererCommon::getQuadIndexBuffer(uint32_t quadCount){
+		if (s_quadIndexBuffer && s_quadIndexBuffer->getCount() >= quadCount * 6) return s_quadIndexBuffer;
+
+		// Two triangles per quad, sharing the diagonal vertices
+		std::vector<uint32_t> indices(quadCount * 6);
+		for (uint32_t i = 0, vertex = 0; i < indices.size(); i += 6, vertex += 4) {
+			indices[i + 0] = vertex + 0;
+			indices[i + 1] = vertex + 1;
+			indices[i + 2] = vertex + 2;
+			indices[i + 3] = vertex + 2;
+			indices[i + 4] = vertex + 3;
+			indices[i + 5] = vertex + 0;
+		}
+
+		s_quadIndexBuffer.reset(new OpenGLIndexBuffer(indices.data(), indices.size()));
+		return s_quadIndexBuffer;
+	}
+}
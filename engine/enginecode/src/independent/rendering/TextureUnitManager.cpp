@@ -3,42 +3,84 @@
 #include "engine_pch.h"
 #include "rendering/TextureUnitManager.h"
 
-namespace Engine {
-	TextureUnitManager::TextureUnitManager(size_t capacity){
-		// Resize the texture ID's
-		m_textureIds.resize(capacity);
+#include <algorithm>
+#include <emmintrin.h>
 
-		// Fill with the max value
-		std::fill(m_textureIds.begin(), m_textureIds.end(), std::numeric_limits<uint32_t>::max());
+namespace Engine {
+	namespace {
+		const uint32_t emptyUnit = std::numeric_limits<uint32_t>::max(); //!< Texture ID of a unit with nothing resident
+	}
 
-		// Create to space in map
-		m_textureUnits.reserve(capacity * 2);
+	TextureUnitManager::TextureUnitManager(uint32_t capacity){
+		m_capacity = std::min(capacity, maxUnits);
+		clear();
 	}
 	void TextureUnitManager::clear(){
-		std::fill(m_textureIds.begin(), m_textureIds.end(), std::numeric_limits<uint32_t>::max());
-		m_textureUnits.clear();
-		m_nextUnit = 0;
+		std::fill(m_textureIds, m_textureIds + maxUnits, emptyUnit);
+		std::fill(m_lastUsed, m_lastUsed + maxUnits, 0ull);
+		m_useCount = 0;
+		m_batchStart = 0;
+	}
+	void TextureUnitManager::evict(uint32_t textureID){
+		int32_t unit = find(textureID);
+		if (unit >= 0) {
+			m_textureIds[unit] = emptyUnit;
+			m_lastUsed[unit] = 0;
+		}
+	}
+	void TextureUnitManager::nextBatch(){
+		m_batchStart = m_useCount;
+	}
+	int32_t TextureUnitManager::find(uint32_t textureID) const{
+		// Units past the capacity stay empty, so the whole array can be compared
+		const __m128i key = _mm_set1_epi32(static_cast<int32_t>(textureID));
+		const __m128i* ids = reinterpret_cast<const __m128i*>(m_textureIds);
+		for (uint32_t i = 0; i < maxUnits / 4; i++) {
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_load_si128(ids + i), key)));
+			if (mask) {
+				uint32_t lane = 0;
+				while (!(mask & (1 << lane))) lane++;
+				return static_cast<int32_t>(i * 4 + lane);
+			}
+		}
+		return -1;
+	}
+	bool TextureUnitManager::full() const{
+		for (uint32_t i = 0; i < m_capacity; i++) {
+			if (m_textureIds[i] == emptyUnit || m_lastUsed[i] <= m_batchStart) return false;
+		}
+		return true;
 	}
 	bool TextureUnitManager::getUnit(uint32_t textureID, uint32_t& textureUnit){
-		auto unitItr = m_textureUnits.find(textureID);
-		if (unitItr != m_textureUnits.end()) {
-			textureUnit = unitItr->second;
+		int32_t unit = find(textureID);
+		if (unit >= 0) {
+			m_lastUsed[unit] = ++m_useCount;
+			m_stats.hits++;
+			textureUnit = static_cast<uint32_t>(unit);
 			return false;
 		}
 
-		if (full()) {
-			textureUnit = -1;
-			return true;
+		// Empty units have never been used so they go first, then the least recently used one outside the batch
+		unit = -1;
+		uint64_t oldest = std::numeric_limits<uint64_t>::max();
+		for (uint32_t i = 0; i < m_capacity; i++) {
+			bool inBatch = m_textureIds[i] != emptyUnit && m_lastUsed[i] > m_batchStart;
+			if (!inBatch && m_lastUsed[i] < oldest) {
+				oldest = m_lastUsed[i];
+				unit = static_cast<int32_t>(i);
+			}
 		}
-		else {
-			textureUnit = m_nextUnit;
-			
-			m_textureIds[m_nextUnit] = textureID;
-			m_textureUnits[textureID] = m_nextUnit;
-
-			m_nextUnit++;
 
+		if (unit < 0) {
+			textureUnit = -1;
 			return true;
 		}
+
+		if (m_textureIds[unit] != emptyUnit) m_stats.evictions++;
+		m_stats.binds++;
+		m_textureIds[unit] = textureID;
+		m_lastUsed[unit] = ++m_useCount;
+		textureUnit = static_cast<uint32_t>(unit);
+		return true;
 	}
-}
\ No newline at end of file
+}
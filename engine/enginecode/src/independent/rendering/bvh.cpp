@@ -0,0 +1,468 @@
+/** \file bvh.cpp */
+#include "engine_pch.h"
+#include "rendering/bvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+
+namespace Engine {
+	namespace {
+		const uint32_t binCount = 16; //!< SAH bins per split
+		const uint32_t parallelThreshold = 4096; //!< Smaller subtrees are built on the calling thread
+
+		//! Box enclosing two boxes
+		AABB merge(const AABB& a, const AABB& b) {
+			AABB box = a;
+			box.grow(b);
+			return box;
+		}
+	}
+
+	/** \struct BVH::BuildState
+	*\brief shared state of one build, items are partitioned in place so every node covers a contiguous range
+	*/
+	struct BVH::BuildState {
+		/** \struct Item
+		*\brief one object, copied so binning and partitioning walk memory in order
+		*/
+		struct Item {
+			AABB bounds; //!< Object bounds
+			glm::vec3 centroid; //!< Centre of the bounds
+			uint32_t object; //!< Object ID
+		};
+		std::vector<Item> items; //!< Objects being built
+		std::atomic<int32_t> nextNode; //!< Next unused node, children are taken in pairs
+	};
+
+	void BVH::build(const AABB* bounds, uint32_t count, uint32_t threadCount) {
+		clear();
+		if (count == 0) return;
+
+		// A binary tree with count leaves has exactly 2 * count - 1 nodes so the pool never grows during the build
+		m_nodes.assign(2 * count - 1, Node());
+		m_leaves.assign(count, -1);
+
+		BuildState state;
+		state.items.resize(count);
+		AABB centroidBounds;
+		for (uint32_t i = 0; i < count; i++) {
+			state.items[i] = { bounds[i], bounds[i].centre(), i };
+			m_nodes[0].bounds.grow(bounds[i]);
+			centroidBounds.grow(state.items[i].centroid);
+		}
+		state.nextNode = 1;
+
+		if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+		uint32_t parallelDepth = 0;
+		while ((1u << parallelDepth) < threadCount) parallelDepth++;
+
+		m_root = 0;
+		buildNode(state, 0, 0, count, centroidBounds, parallelDepth);
+		m_objectCount = count;
+	}
+
+	void BVH::buildNode(BuildState& state, int32_t node, uint32_t begin, uint32_t end, const AABB& centroidBounds, uint32_t parallelDepth) {
+		Node& n = m_nodes[node];
+		if (end - begin == 1) {
+			n.object = state.items[begin].object;
+			m_leaves[n.object] = node;
+			return;
+		}
+
+		// Split on the longest axis of the centroids
+		glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+		int axis = 0;
+		if (extent.y > extent[axis]) axis = 1;
+		if (extent.z > extent[axis]) axis = 2;
+
+		// Bins also track their centroids so children get their bounds from the sweep rather than another pass
+		AABB leftBounds, rightBounds, leftCentroids, rightCentroids;
+		uint32_t mid = 0;
+		if (extent[axis] > 0.f) {
+			// Small ranges use fewer bins, most nodes are near the leaves and the sweeps would cost more than the binning
+			uint32_t bins = std::min(binCount, end - begin);
+			float scale = bins / extent[axis];
+			float origin = centroidBounds.min[axis];
+			auto binOf = [&](const BuildState::Item& item) {
+				uint32_t bin = static_cast<uint32_t>((item.centroid[axis] - origin) * scale);
+				return std::min(bin, bins - 1);
+			};
+
+			AABB binBounds[binCount], binCentroids[binCount];
+			uint32_t binCounts[binCount] = {};
+			for (uint32_t i = begin; i < end; i++) {
+				const BuildState::Item& item = state.items[i];
+				uint32_t bin = binOf(item);
+				binBounds[bin].grow(item.bounds);
+				binCentroids[bin].grow(item.centroid);
+				binCounts[bin]++;
+			}
+
+			// Sweep from the right for everything above each plane, plane b sits between bins b - 1 and b
+			AABB aboveBounds[binCount], aboveCentroids[binCount];
+			uint32_t aboveCount[binCount];
+			AABB bounds, centroids;
+			uint32_t count = 0;
+			for (uint32_t b = bins - 1; b > 0; b--) {
+				bounds.grow(binBounds[b]);
+				centroids.grow(binCentroids[b]);
+				count += binCounts[b];
+				aboveBounds[b] = bounds;
+				aboveCentroids[b] = centroids;
+				aboveCount[b] = count;
+			}
+
+			bounds = AABB();
+			centroids = AABB();
+			count = 0;
+			float bestCost = std::numeric_limits<float>::max();
+			uint32_t bestPlane = 0;
+			for (uint32_t b = 1; b < bins; b++) {
+				bounds.grow(binBounds[b - 1]);
+				centroids.grow(binCentroids[b - 1]);
+				count += binCounts[b - 1];
+				if (count == 0 || aboveCount[b] == 0) continue;
+
+				float cost = bounds.surfaceArea() * count + aboveBounds[b].surfaceArea() * aboveCount[b];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestPlane = b;
+					leftBounds = bounds;
+					leftCentroids = centroids;
+					rightBounds = aboveBounds[b];
+					rightCentroids = aboveCentroids[b];
+					mid = begin + count;
+				}
+			}
+
+			// The lowest and highest centroids always land in the first and last bins so a plane is always found
+			auto first = state.items.begin();
+			std::partition(first + begin, first + end, [&](const BuildState::Item& item) { return binOf(item) < bestPlane; });
+		}
+		else {
+			// Every centroid is in the same place so the middle split is as good as any
+			mid = begin + (end - begin) / 2;
+			for (uint32_t i = begin; i < mid; i++) leftBounds.grow(state.items[i].bounds);
+			for (uint32_t i = mid; i < end; i++) rightBounds.grow(state.items[i].bounds);
+			leftCentroids = rightCentroids = centroidBounds;
+		}
+
+		int32_t leftChild = state.nextNode.fetch_add(2);
+		int32_t rightChild = leftChild + 1;
+		n.left = leftChild;
+		n.right = rightChild;
+		m_nodes[leftChild].parent = node;
+		m_nodes[leftChild].bounds = leftBounds;
+		m_nodes[rightChild].parent = node;
+		m_nodes[rightChild].bounds = rightBounds;
+
+		if (parallelDepth > 0 && end - begin >= parallelThreshold) {
+			// The subtrees share nothing but the atomic node counter
+			std::future<void> task = std::async(std::launch::async, [&, leftChild, begin, mid, parallelDepth]() {
+				buildNode(state, leftChild, begin, mid, leftCentroids, parallelDepth - 1);
+			});
+			buildNode(state, rightChild, mid, end, rightCentroids, parallelDepth - 1);
+			task.get();
+		}
+		else {
+			buildNode(state, leftChild, begin, mid, leftCentroids, 0);
+			buildNode(state, rightChild, mid, end, rightCentroids, 0);
+		}
+	}
+
+	int32_t BVH::allocateNode() {
+		if (m_freeNodes.empty()) {
+			m_nodes.push_back(Node());
+			return static_cast<int32_t>(m_nodes.size() - 1);
+		}
+
+		int32_t node = m_freeNodes.back();
+		m_freeNodes.pop_back();
+		m_nodes[node] = Node();
+		return node;
+	}
+
+	void BVH::freeNode(int32_t node) {
+		m_freeNodes.push_back(node);
+	}
+
+	void BVH::refitAncestors(int32_t node) {
+		while (node != -1) {
+			Node& n = m_nodes[node];
+			n.bounds = merge(m_nodes[n.left].bounds, m_nodes[n.right].bounds);
+			node = n.parent;
+		}
+	}
+
+	uint32_t BVH::insert(const AABB& bounds) {
+		uint32_t object;
+		if (m_freeObjects.empty()) {
+			object = static_cast<uint32_t>(m_leaves.size());
+			m_leaves.push_back(-1);
+		}
+		else {
+			object = m_freeObjects.back();
+			m_freeObjects.pop_back();
+		}
+
+		int32_t leaf = allocateNode();
+		m_nodes[leaf].bounds = bounds;
+		m_nodes[leaf].object = object;
+		m_leaves[object] = leaf;
+		m_objectCount++;
+
+		if (m_root == -1) {
+			m_root = leaf;
+			return object;
+		}
+
+		// Walk down to the sibling which adds the least area, every node passed on the way grows by the same amount
+		int32_t sibling = m_root;
+		while (!isLeaf(sibling)) {
+			const Node& n = m_nodes[sibling];
+			float combinedArea = merge(n.bounds, bounds).surfaceArea();
+			float pairCost = 2.f * combinedArea;
+			float inheritedCost = 2.f * (combinedArea - n.bounds.surfaceArea());
+
+			auto descendCost = [&](int32_t child) {
+				const AABB& childBounds = m_nodes[child].bounds;
+				float area = merge(childBounds, bounds).surfaceArea();
+				if (!isLeaf(child)) area -= childBounds.surfaceArea();
+				return area + inheritedCost;
+			};
+			float leftCost = descendCost(n.left);
+			float rightCost = descendCost(n.right);
+
+			if (pairCost < leftCost && pairCost < rightCost) break;
+			sibling = leftCost < rightCost ? n.left : n.right;
+		}
+
+		int32_t oldParent = m_nodes[sibling].parent;
+		int32_t newParent = allocateNode();
+		Node& parent = m_nodes[newParent];
+		parent.parent = oldParent;
+		parent.left = sibling;
+		parent.right = leaf;
+		parent.bounds = merge(m_nodes[sibling].bounds, bounds);
+		m_nodes[sibling].parent = newParent;
+		m_nodes[leaf].parent = newParent;
+
+		if (oldParent == -1) m_root = newParent;
+		else {
+			Node& grandParent = m_nodes[oldParent];
+			if (grandParent.left == sibling) grandParent.left = newParent;
+			else grandParent.right = newParent;
+			refitAncestors(oldParent);
+		}
+		return object;
+	}
+
+	void BVH::remove(uint32_t object) {
+		int32_t leaf = m_leaves[object];
+		m_leaves[object] = -1;
+		m_freeObjects.push_back(object);
+		m_objectCount--;
+
+		if (leaf == m_root) {
+			m_root = -1;
+			freeNode(leaf);
+			return;
+		}
+
+		// The sibling takes the place of the parent
+		int32_t parent = m_nodes[leaf].parent;
+		int32_t grandParent = m_nodes[parent].parent;
+		int32_t sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+		m_nodes[sibling].parent = grandParent;
+
+		if (grandParent == -1) m_root = sibling;
+		else {
+			Node& g = m_nodes[grandParent];
+			if (g.left == parent) g.left = sibling;
+			else g.right = sibling;
+			refitAncestors(grandParent);
+		}
+
+		freeNode(parent);
+		freeNode(leaf);
+	}
+
+	void BVH::update(uint32_t object, const AABB& bounds) {
+		m_nodes[m_leaves[object]].bounds = bounds;
+	}
+
+	void BVH::refit() {
+		if (m_root == -1) return;
+
+		// Pre-order visits parents before children so walking it backwards refits children first
+		std::vector<int32_t> order;
+		order.reserve(m_nodes.size());
+		order.push_back(m_root);
+		for (size_t i = 0; i < order.size(); i++) {
+			const Node& n = m_nodes[order[i]];
+			if (n.left != -1) {
+				order.push_back(n.left);
+				order.push_back(n.right);
+			}
+		}
+
+		for (auto it = order.rbegin(); it != order.rend(); ++it) {
+			Node& n = m_nodes[*it];
+			if (n.left != -1) n.bounds = merge(m_nodes[n.left].bounds, m_nodes[n.right].bounds);
+		}
+	}
+
+	void BVH::clear() {
+		m_nodes.clear();
+		m_freeNodes.clear();
+		m_leaves.clear();
+		m_freeObjects.clear();
+		m_root = -1;
+		m_objectCount = 0;
+	}
+
+	void BVH::collectLeaves(int32_t node, std::vector<uint32_t>& results) const {
+		std::vector<int32_t> stack = { node };
+		while (!stack.empty()) {
+			const Node& n = m_nodes[stack.back()];
+			stack.pop_back();
+			if (n.left == -1) results.push_back(n.object);
+			else {
+				stack.push_back(n.left);
+				stack.push_back(n.right);
+			}
+		}
+	}
+
+	void BVH::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const {
+		if (m_root == -1) return;
+
+		std::vector<int32_t> stack = { m_root };
+		while (!stack.empty()) {
+			int32_t node = stack.back();
+			stack.pop_back();
+
+			const Node& n = m_nodes[node];
+			bool fullyInside;
+			if (!Culling::intersects(frustum, n.bounds, fullyInside)) continue;
+
+			// Nothing below a node inside every plane needs testing
+			if (fullyInside) collectLeaves(node, results);
+			else if (n.left == -1) results.push_back(n.object);
+			else {
+				stack.push_back(n.left);
+				stack.push_back(n.right);
+			}
+		}
+	}
+
+	void BVH::queryAABB(const AABB& box, std::vector<uint32_t>& results) const {
+		if (m_root == -1) return;
+
+		std::vector<int32_t> stack = { m_root };
+		while (!stack.empty()) {
+			const Node& n = m_nodes[stack.back()];
+			stack.pop_back();
+
+			if (!n.bounds.overlaps(box)) continue;
+			if (n.left == -1) results.push_back(n.object);
+			else {
+				stack.push_back(n.left);
+				stack.push_back(n.right);
+			}
+		}
+	}
+
+	void BVH::queryRay(const Ray& ray, std::vector<uint32_t>& results) const {
+		if (m_root == -1) return;
+
+		glm::vec3 inverseDirection = 1.f / ray.direction;
+		std::vector<int32_t> stack = { m_root };
+		while (!stack.empty()) {
+			const Node& n = m_nodes[stack.back()];
+			stack.pop_back();
+
+			float distance;
+			if (!Culling::intersects(ray, inverseDirection, n.bounds, distance)) continue;
+			if (n.left == -1) results.push_back(n.object);
+			else {
+				stack.push_back(n.left);
+				stack.push_back(n.right);
+			}
+		}
+	}
+
+	bool BVH::raycast(const Ray& ray, uint32_t& object, float& distance) const {
+		if (m_root == -1) return false;
+
+		glm::vec3 inverseDirection = 1.f / ray.direction;
+		float rootDistance;
+		if (!Culling::intersects(ray, inverseDirection, m_nodes[m_root].bounds, rootDistance)) return false;
+
+		// Entries carry their entry distance so anything beyond the closest hit so far is skipped when popped
+		std::vector<std::pair<int32_t, float>> stack = { { m_root, rootDistance } };
+		Ray segment = ray;
+		bool hit = false;
+		while (!stack.empty()) {
+			auto entry = stack.back();
+			stack.pop_back();
+			if (hit && entry.second >= segment.maxDistance) continue;
+
+			const Node& n = m_nodes[entry.first];
+			if (n.left == -1) {
+				object = n.object;
+				segment.maxDistance = entry.second;
+				hit = true;
+				continue;
+			}
+
+			float leftDistance, rightDistance;
+			bool leftHit = Culling::intersects(segment, inverseDirection, m_nodes[n.left].bounds, leftDistance);
+			bool rightHit = Culling::intersects(segment, inverseDirection, m_nodes[n.right].bounds, rightDistance);
+
+			// Push the further child first so the nearer one is visited first
+			if (leftHit && rightHit) {
+				if (leftDistance < rightDistance) {
+					stack.push_back({ n.right, rightDistance });
+					stack.push_back({ n.left, leftDistance });
+				}
+				else {
+					stack.push_back({ n.left, leftDistance });
+					stack.push_back({ n.right, rightDistance });
+				}
+			}
+			else if (leftHit) stack.push_back({ n.left, leftDistance });
+			else if (rightHit) stack.push_back({ n.right, rightDistance });
+		}
+
+		if (hit) distance = segment.maxDistance;
+		return hit;
+	}
+
+	bool BVH::validate() const {
+		if (m_root == -1) return m_objectCount == 0;
+		if (m_nodes[m_root].parent != -1) return false;
+
+		uint32_t leaves = 0;
+		std::vector<int32_t> stack = { m_root };
+		while (!stack.empty()) {
+			int32_t node = stack.back();
+			stack.pop_back();
+
+			const Node& n = m_nodes[node];
+			if (n.left == -1) {
+				if (n.object < 0 || m_leaves[n.object] != node) return false;
+				leaves++;
+				continue;
+			}
+
+			for (int32_t child : { n.left, n.right }) {
+				if (m_nodes[child].parent != node || !n.bounds.contains(m_nodes[child].bounds)) return false;
+				stack.push_back(child);
+			}
+		}
+		return leaves == m_objectCount;
+	}
+}
@@ -0,0 +1,182 @@
+/** \file culling.cpp */
+#include "engine_pch.h"
+#include "rendering/culling.h"
+
+#include <cstring>
+#include <emmintrin.h>
+
+namespace Engine {
+	namespace Culling {
+		BoundingVolume computeBounds(const void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t offset) {
+			BoundingVolume bounds;
+			if (!vertices || vertexCount == 0) return bounds;
+
+			const unsigned char* data = static_cast<const unsigned char*>(vertices) + offset;
+			auto position = [&](uint32_t i) {
+				float p[3];
+				memcpy(p, data + i * stride, sizeof(p));
+				return glm::vec3(p[0], p[1], p[2]);
+			};
+
+			bounds.min = bounds.max = position(0);
+			for (uint32_t i = 1; i < vertexCount; i++) {
+				bounds.min = glm::min(bounds.min, position(i));
+				bounds.max = glm::max(bounds.max, position(i));
+			}
+
+			// Centred on the box, radius to the furthest vertex which is never larger than the half diagonal
+			glm::vec3 centre = (bounds.min + bounds.max) * 0.5f;
+			float radiusSquared = 0.f;
+			for (uint32_t i = 0; i < vertexCount; i++) {
+				glm::vec3 d = position(i) - centre;
+				radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+			}
+			bounds.sphere = glm::vec4(centre, std::sqrt(radiusSquared));
+			return bounds;
+		}
+
+		Frustum extractFrustum(const glm::mat4& viewProjection) {
+			// Gribb and Hartmann, rows of the matrix added to and subtracted from the last row
+			glm::vec4 row[4];
+			for (int i = 0; i < 4; i++) row[i] = { viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i] };
+
+			Frustum frustum;
+			frustum.planes[0] = row[3] + row[0];
+			frustum.planes[1] = row[3] - row[0];
+			frustum.planes[2] = row[3] + row[1];
+			frustum.planes[3] = row[3] - row[1];
+			frustum.planes[4] = row[3] + row[2];
+			frustum.planes[5] = row[3] - row[2];
+
+			for (auto& plane : frustum.planes) {
+				float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+				plane = plane / length;
+			}
+			return frustum;
+		}
+
+		glm::vec4 transformSphere(const glm::vec4& sphere, const glm::mat4& model) {
+			glm::vec4 centre = model * glm::vec4(sphere.x, sphere.y, sphere.z, 1.f);
+
+			// Largest axis scale keeps the sphere enclosing under non uniform scaling
+			float scaleSquared = 0.f;
+			for (int i = 0; i < 3; i++) scaleSquared = std::max(scaleSquared, model[i].x * model[i].x + model[i].y * model[i].y + model[i].z * model[i].z);
+
+			return { centre.x, centre.y, centre.z, sphere.w * std::sqrt(scaleSquared) };
+		}
+
+		AABB transformAABB(const glm::vec3& min, const glm::vec3& max, const glm::mat4& model) {
+			// Arvo, each world axis takes the smaller and larger of every local axis' contribution
+			AABB box;
+			glm::vec3 translation = { model[3].x, model[3].y, model[3].z };
+			box.min = box.max = translation;
+			for (int column = 0; column < 3; column++) {
+				for (int row = 0; row < 3; row++) {
+					float a = model[column][row] * min[column];
+					float b = model[column][row] * max[column];
+					box.min[row] += std::min(a, b);
+					box.max[row] += std::max(a, b);
+				}
+			}
+			return box;
+		}
+
+		bool intersects(const Frustum& frustum, const AABB& box, bool& fullyInside) {
+			fullyInside = true;
+			for (const auto& plane : frustum.planes) {
+				// Corners furthest along and against the plane normal
+				glm::vec3 positive = { plane.x >= 0.f ? box.max.x : box.min.x, plane.y >= 0.f ? box.max.y : box.min.y, plane.z >= 0.f ? box.max.z : box.min.z };
+				glm::vec3 negative = { plane.x >= 0.f ? box.min.x : box.max.x, plane.y >= 0.f ? box.min.y : box.max.y, plane.z >= 0.f ? box.min.z : box.max.z };
+
+				if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0.f) {
+					fullyInside = false;
+					return false;
+				}
+				if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w < 0.f) fullyInside = false;
+			}
+			return true;
+		}
+
+		bool intersects(const Ray& ray, const glm::vec3& inverseDirection, const AABB& box, float& distance) {
+			float tMin = 0.f;
+			float tMax = ray.maxDistance;
+			for (int axis = 0; axis < 3; axis++) {
+				float t0 = (box.min[axis] - ray.origin[axis]) * inverseDirection[axis];
+				float t1 = (box.max[axis] - ray.origin[axis]) * inverseDirection[axis];
+				if (t0 > t1) std::swap(t0, t1);
+				// Written so a NaN from 0 * inf keeps the current interval
+				tMin = t0 > tMin ? t0 : tMin;
+				tMax = t1 < tMax ? t1 : tMax;
+				if (tMin > tMax) return false;
+			}
+			distance = tMin;
+			return true;
+		}
+
+		Ray screenRay(const glm::mat4& view, const glm::mat4& projection, const glm::vec2& screenPosition, const glm::vec2& screenSize) {
+			glm::vec2 ndc = { 2.f * screenPosition.x / screenSize.x - 1.f, 1.f - 2.f * screenPosition.y / screenSize.y };
+			glm::mat4 inverse = glm::inverse(projection * view);
+
+			glm::vec4 nearPoint = inverse * glm::vec4(ndc.x, ndc.y, -1.f, 1.f);
+			glm::vec4 farPoint = inverse * glm::vec4(ndc.x, ndc.y, 1.f, 1.f);
+			glm::vec3 start = glm::vec3(nearPoint.x, nearPoint.y, nearPoint.z) / nearPoint.w;
+			glm::vec3 end = glm::vec3(farPoint.x, farPoint.y, farPoint.z) / farPoint.w;
+
+			Ray ray;
+			ray.origin = start;
+			ray.direction = glm::normalize(end - start);
+			ray.maxDistance = glm::length(end - start);
+			return ray;
+		}
+
+		uint32_t cullSpheresScalar(const Frustum& frustum, const glm::vec4* spheres, uint32_t count, uint8_t* visible) {
+			uint32_t visibleCount = 0;
+			for (uint32_t i = 0; i < count; i++) {
+				const glm::vec4& s = spheres[i];
+				bool inside = true;
+				for (const auto& plane : frustum.planes) {
+					float distance = plane.x * s.x + plane.y * s.y + plane.z * s.z + plane.w;
+					inside = inside && distance > -s.w;
+				}
+				visible[i] = inside ? 1 : 0;
+				visibleCount += visible[i];
+			}
+			return visibleCount;
+		}
+
+		uint32_t cullSpheres(const Frustum& frustum, const glm::vec4* spheres, uint32_t count, uint8_t* visible) {
+			__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+			for (int p = 0; p < 6; p++) {
+				planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+				planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+				planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+				planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+			}
+
+			uint32_t visibleCount = 0;
+			uint32_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				// Transpose four spheres into structure of arrays form
+				__m128 x = _mm_loadu_ps(&spheres[i + 0].x), y = _mm_loadu_ps(&spheres[i + 1].x), z = _mm_loadu_ps(&spheres[i + 2].x), r = _mm_loadu_ps(&spheres[i + 3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, r);
+				__m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (int p = 0; p < 6; p++) {
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)), _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+					inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negR));
+				}
+
+				int mask = _mm_movemask_ps(inside);
+				for (int lane = 0; lane < 4; lane++) {
+					visible[i + lane] = (mask >> lane) & 1;
+					visibleCount += visible[i + lane];
+				}
+			}
+
+			// Remaining spheres which do not fill a whole register
+			if (i < count) visibleCount += cullSpheresScalar(frustum, spheres + i, count - i, visible + i);
+			return visibleCount;
+		}
+	}
+}
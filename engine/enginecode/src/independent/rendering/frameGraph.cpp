@@ -0,0 +1,286 @@
+/** \file frameGraph.cpp */
+#include "engine_pch.h"
+#include "rendering/frameGraph.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace Engine {
+	namespace {
+		uint32_t barrierBefore(FrameGraphAccess access){
+			// Only storage writes bypass the automatic ordering GL gives rendering and sampling
+			switch (access) {
+			case FrameGraphAccess::StorageRead:
+			case FrameGraphAccess::StorageWrite: return FrameGraphBarrier::Storage;
+			case FrameGraphAccess::Indirect: return FrameGraphBarrier::Command;
+			case FrameGraphAccess::Sampled: return FrameGraphBarrier::TextureFetch;
+			case FrameGraphAccess::ColourTarget:
+			case FrameGraphAccess::DepthTarget: return FrameGraphBarrier::Framebuffer;
+			default: return FrameGraphBarrier::None;
+			}
+		}
+		bool isTarget(FrameGraphAccess access){
+			return access == FrameGraphAccess::ColourTarget || access == FrameGraphAccess::DepthTarget;
+		}
+	}
+
+	FrameGraphResource FrameGraphBuilder::create(const std::string& name, const FrameGraphTextureDesc& desc){
+		m_graph.m_resources.push_back({ name, desc, false, 0, FrameGraph::none, FrameGraph::none, FrameGraph::none, 0 });
+		return { m_graph.addVersion(static_cast<uint32_t>(m_graph.m_resources.size() - 1), FrameGraph::none) };
+	}
+	FrameGraphResource FrameGraphBuilder::read(FrameGraphResource resource, FrameGraphAccess access){
+		m_graph.m_passes[m_pass].accesses.push_back({ resource.index, resource.index, access, false });
+		m_graph.m_versions[resource.index].readers.push_back(m_pass);
+		return resource;
+	}
+	FrameGraphResource FrameGraphBuilder::write(FrameGraphResource resource, FrameGraphAccess access){
+		uint32_t version = m_graph.addVersion(m_graph.m_versions[resource.index].resource, static_cast<int32_t>(m_pass));
+		m_graph.m_passes[m_pass].accesses.push_back({ version, resource.index, access, true });
+		return { version };
+	}
+	void FrameGraphBuilder::sideEffect(){
+		m_graph.m_passes[m_pass].sideEffect = true;
+	}
+
+	uint32_t FrameGraphPassResources::get(FrameGraphResource resource) const{
+		return m_graph.m_resources[m_graph.m_versions[resource.index].resource].object;
+	}
+	const FrameGraphTextureDesc& FrameGraphPassResources::getDesc(FrameGraphResource resource) const{
+		return m_graph.m_resources[m_graph.m_versions[resource.index].resource].desc;
+	}
+
+	void FrameGraph::reset(){
+		m_resources.clear();
+		m_versions.clear();
+		m_passes.clear();
+		m_order.clear();
+		m_physical.clear();
+		m_compiled = false;
+	}
+	uint32_t FrameGraph::addVersion(uint32_t resource, int32_t producer){
+		m_versions.push_back({ resource, producer, {} });
+		m_compiled = false;
+		return static_cast<uint32_t>(m_versions.size() - 1);
+	}
+	FrameGraphResource FrameGraph::importTexture(const std::string& name, const FrameGraphTextureDesc& desc, uint32_t texture){
+		m_resources.push_back({ name, desc, true, texture, none, none, none, texture });
+		return { addVersion(static_cast<uint32_t>(m_resources.size() - 1), none) };
+	}
+	FrameGraphResource FrameGraph::importBuffer(const std::string& name, uint32_t buffer){
+		m_resources.push_back({ name, FrameGraphTextureDesc(), true, buffer, none, none, none, buffer });
+		return { addVersion(static_cast<uint32_t>(m_resources.size() - 1), none) };
+	}
+	uint32_t FrameGraph::addPass(const std::string& name, const std::function<FrameGraphExecute(FrameGraphBuilder&)>& setup){
+		uint32_t pass = static_cast<uint32_t>(m_passes.size());
+		m_passes.push_back({ name, {}, nullptr, false, false, false, FrameGraphBarrier::None });
+
+		FrameGraphBuilder builder(*this, pass);
+		m_passes[pass].execute = setup(builder);
+		m_compiled = false;
+		return pass;
+	}
+	int32_t FrameGraph::getPhysicalTexture(FrameGraphResource resource) const{
+		return m_resources[m_versions[resource.index].resource].physical;
+	}
+	void FrameGraph::getTargets(const Pass& pass, std::vector<uint32_t>& targets) const{
+		targets.clear();
+		for (const Access& access : pass.accesses) {
+			if (access.write && isTarget(access.access)) targets.push_back(m_versions[access.version].resource);
+		}
+	}
+
+	void FrameGraph::cull(){
+		// Walk back from everything that leaves the graph, through the producers of what each pass reads or builds on
+		std::vector<uint32_t> stack;
+		for (uint32_t i = 0; i < m_passes.size(); i++) {
+			Pass& pass = m_passes[i];
+			pass.alive = pass.sideEffect;
+			for (const Access& access : pass.accesses) {
+				if (access.write && m_resources[m_versions[access.version].resource].imported) pass.alive = true;
+			}
+			if (pass.alive) stack.push_back(i);
+		}
+
+		while (!stack.empty()) {
+			uint32_t pass = stack.back();
+			stack.pop_back();
+			for (const Access& access : m_passes[pass].accesses) {
+				int32_t producer = m_versions[access.previous].producer;
+				if (producer != none && !m_passes[producer].alive) {
+					m_passes[producer].alive = true;
+					stack.push_back(producer);
+				}
+			}
+		}
+	}
+	void FrameGraph::order(){
+		std::vector<std::vector<uint32_t>> successors(m_passes.size());
+		std::vector<uint32_t> dependencies(m_passes.size(), 0);
+		auto addEdge = [&](int32_t from, uint32_t to) {
+			if (from == none || static_cast<uint32_t>(from) == to || !m_passes[from].alive) return;
+			successors[from].push_back(to);
+			dependencies[to]++;
+		};
+
+		for (uint32_t i = 0; i < m_passes.size(); i++) {
+			if (!m_passes[i].alive) continue;
+			for (const Access& access : m_passes[i].accesses) {
+				// Reads wait for the write, writes wait for the version they overwrite and everyone reading it
+				const Version& previous = m_versions[access.previous];
+				addEdge(previous.producer, i);
+				if (access.write) for (uint32_t reader : previous.readers) addEdge(static_cast<int32_t>(reader), i);
+			}
+		}
+
+		std::vector<uint32_t> ready;
+		for (uint32_t i = 0; i < m_passes.size(); i++) if (m_passes[i].alive && dependencies[i] == 0) ready.push_back(i);
+
+		std::vector<uint32_t> bound, targets;
+		m_order.clear();
+		while (!ready.empty()) {
+			// Prefer a pass which keeps the bound targets, then declaration order
+			size_t pick = 0;
+			bool matched = false;
+			for (size_t i = 0; i < ready.size(); i++) {
+				getTargets(m_passes[ready[i]], targets);
+				bool matches = !bound.empty() && targets == bound;
+				if ((matches && !matched) || (matches == matched && ready[i] < ready[pick])) {
+					pick = i;
+					matched = matches;
+				}
+			}
+
+			uint32_t pass = ready[pick];
+			ready.erase(ready.begin() + pick);
+			m_order.push_back(pass);
+
+			getTargets(m_passes[pass], targets);
+			if (!targets.empty()) bound = targets;
+
+			for (uint32_t next : successors[pass]) {
+				if (--dependencies[next] == 0) ready.push_back(next);
+			}
+		}
+	}
+	void FrameGraph::allocate(){
+		for (Resource& resource : m_resources) {
+			resource.firstUse = none;
+			resource.lastUse = none;
+			resource.physical = none;
+		}
+		for (uint32_t position = 0; position < m_order.size(); position++) {
+			for (const Access& access : m_passes[m_order[position]].accesses) {
+				Resource& resource = m_resources[m_versions[access.version].resource];
+				if (resource.firstUse == none) resource.firstUse = position;
+				resource.lastUse = position;
+			}
+		}
+
+		std::vector<uint32_t> transients;
+		for (uint32_t i = 0; i < m_resources.size(); i++) {
+			if (!m_resources[i].imported && m_resources[i].firstUse != none) transients.push_back(i);
+		}
+		std::stable_sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) { return m_resources[a].firstUse < m_resources[b].firstUse; });
+
+		// Greedy interval allocation, a texture is reused once the last transient in it is finished with
+		std::vector<int32_t> freeAfter;
+		m_physical.clear();
+		for (uint32_t index : transients) {
+			Resource& resource = m_resources[index];
+			for (uint32_t slot = 0; slot < m_physical.size(); slot++) {
+				if (freeAfter[slot] < resource.firstUse && m_physical[slot] == resource.desc) {
+					resource.physical = slot;
+					break;
+				}
+			}
+			if (resource.physical == none) {
+				resource.physical = static_cast<int32_t>(m_physical.size());
+				m_physical.push_back(resource.desc);
+				freeAfter.push_back(none);
+			}
+			freeAfter[resource.physical] = resource.lastUse;
+		}
+
+		m_stats.transientTextures = static_cast<uint32_t>(transients.size());
+		m_stats.physicalTextures = static_cast<uint32_t>(m_physical.size());
+	}
+	void FrameGraph::transition(){
+		std::vector<FrameGraphAccess> current(m_resources.size(), FrameGraphAccess::None);
+		std::vector<uint32_t> bound, targets;
+
+		for (uint32_t index : m_order) {
+			Pass& pass = m_passes[index];
+			pass.barriers = FrameGraphBarrier::None;
+			for (const Access& access : pass.accesses) {
+				uint32_t resource = m_versions[access.version].resource;
+				if (current[resource] == FrameGraphAccess::StorageWrite) pass.barriers |= barrierBefore(access.access);
+				if (current[resource] != access.access) {
+					current[resource] = access.access;
+					m_stats.transitions++;
+				}
+			}
+			if (pass.barriers != FrameGraphBarrier::None) m_stats.barriers++;
+
+			getTargets(pass, targets);
+			pass.bindTargets = !targets.empty() && targets != bound;
+			if (pass.bindTargets) {
+				bound = targets;
+				m_stats.targetBinds++;
+			}
+		}
+	}
+	void FrameGraph::compile(){
+		m_stats = FrameGraphStats();
+		m_stats.passes = static_cast<uint32_t>(m_passes.size());
+
+		cull();
+		order();
+		m_stats.culledPasses = m_stats.passes - static_cast<uint32_t>(m_order.size());
+		allocate();
+		transition();
+
+		m_compiled = true;
+	}
+	void FrameGraph::execute(FrameGraphDevice& device){
+		if (!m_compiled) compile();
+
+		std::vector<uint32_t> textures(m_physical.size());
+		for (uint32_t slot = 0; slot < m_physical.size(); slot++) textures[slot] = device.acquireTexture(m_physical[slot]);
+		for (Resource& resource : m_resources) {
+			if (!resource.imported) resource.object = resource.physical != none ? textures[resource.physical] : 0;
+		}
+
+		m_timings.clear();
+		std::vector<uint32_t> colour;
+		FrameGraphPassResources resources(*this);
+		for (uint32_t index : m_order) {
+			Pass& pass = m_passes[index];
+			if (pass.barriers != FrameGraphBarrier::None) device.barrier(pass.barriers);
+
+			if (pass.bindTargets) {
+				colour.clear();
+				uint32_t depth = 0;
+				const FrameGraphTextureDesc* desc = nullptr;
+				for (const Access& access : pass.accesses) {
+					if (!access.write || !isTarget(access.access)) continue;
+					const Resource& resource = m_resources[m_versions[access.version].resource];
+					if (access.access == FrameGraphAccess::ColourTarget) colour.push_back(resource.object);
+					else depth = resource.object;
+					if (!desc) desc = &resource.desc;
+				}
+				device.bindRenderTargets(colour.data(), static_cast<uint32_t>(colour.size()), depth, *desc);
+			}
+
+			device.beginTimer(pass.name);
+			auto start = std::chrono::high_resolution_clock::now();
+			if (pass.execute) pass.execute(resources);
+			std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now() - start;
+			device.endTimer();
+
+			m_timings.push_back({ pass.name, elapsed.count(), -1.f });
+		}
+
+		for (FrameGraphPassTiming& timing : m_timings) timing.gpuTime = device.getGPUTime(timing.name);
+		device.releaseTextures();
+	}
+}
@@ -0,0 +1,372 @@
+/** \file glyphCache.cpp */
+#include "engine_pch.h"
+#include "rendering/glyphCache.h"
+#include "systems/loggerSys.h"
+
+#include <fstream>
+#include <iterator>
+
+namespace Engine {
+	GlyphCache::GlyphCache(glm::ivec2 atlasSize, GlyphRenderMode mode, uint32_t spread) : m_atlas(atlasSize, 1, 32, 1), m_mode(mode), m_spread(spread) {}
+
+	void GlyphCache::setFont(FT_Face font, float metricScale){
+		m_font = font;
+		m_metricScale = metricScale;
+		m_entries.clear();
+		m_lru.clear();
+		m_atlas.clear();
+	}
+
+	const GlyphData* GlyphCache::get(uint32_t codepoint){
+		auto it = m_entries.find(codepoint);
+		if (it != m_entries.end()) {
+			m_stats.hits++;
+			Entry& entry = it->second;
+			m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+			entry.lastFrame = m_frame;
+			return &entry.glyph;
+		}
+
+		m_stats.misses++;
+		if (!m_font && m_fontLoader) {
+			m_font = m_fontLoader();
+			m_fontLoader = nullptr;
+		}
+		if (!m_font) return nullptr;
+		if (FT_Load_Char(m_font, codepoint, FT_LOAD_RENDER)) {
+			LoggerSys::error("Could not load glyph for codepoint {0}", codepoint);
+			return nullptr;
+		}
+
+		const FT_GlyphSlot slot = m_font->glyph;
+		Entry entry;
+		entry.width = slot->bitmap.width;
+		entry.height = slot->bitmap.rows;
+		entry.lastFrame = m_frame;
+
+		// Rows can be padded, copy them tightly packed
+		entry.bitmap.resize(entry.width * entry.height);
+		for (uint32_t row = 0; row < entry.height; row++)
+			memcpy(entry.bitmap.data() + row * entry.width, slot->bitmap.buffer + row * slot->bitmap.pitch, entry.width);
+
+		glm::vec2 bearing(slot->bitmap_left, -slot->bitmap_top);
+		if (m_mode == GlyphRenderMode::SDF && entry.width > 0 && entry.height > 0) {
+			// The field reaches past the coverage, so the quad grows by the spread on every side
+			std::vector<unsigned char> coverage;
+			coverage.swap(entry.bitmap);
+			generateSDF(coverage.data(), entry.width, entry.height, m_spread, entry.bitmap);
+			entry.width += m_spread * 2;
+			entry.height += m_spread * 2;
+			bearing -= glm::vec2(static_cast<float>(m_spread));
+		}
+
+		entry.glyph.size = glm::vec2(entry.width, entry.height) * m_metricScale;
+		entry.glyph.bearing = bearing * m_metricScale;
+		entry.glyph.advance = static_cast<float>(slot->advance.x >> 6) * m_metricScale;
+
+		// Never fits, evicting would not help
+		if (entry.width >= m_atlas.getBaseTexture()->getWidth() || entry.height >= m_atlas.getBaseTexture()->getHeight()) return nullptr;
+
+		while (!place(entry)) {
+			if (!evictAndRepack()) return nullptr;
+		}
+
+		m_lru.push_front(codepoint);
+		entry.lru = m_lru.begin();
+		return &m_entries.emplace(codepoint, std::move(entry)).first->second.glyph;
+	}
+
+	bool GlyphCache::place(Entry& entry){
+		// Single channel page, the coverage or distance goes up as it is
+		std::shared_ptr<SubTexture> placed;
+		if (!m_atlas.add(entry.width, entry.height, 1, entry.bitmap.data(), placed)) return false;
+
+		// Update in place so every holder of the sub texture sees the new location
+		if (entry.glyph.subTexture) *entry.glyph.subTexture = *placed;
+		else entry.glyph.subTexture = placed;
+		return true;
+	}
+
+	bool GlyphCache::evictAndRepack(){
+		// Evict a quarter of the glyphs not used this frame, oldest first
+		uint32_t target = std::max<uint32_t>(1, static_cast<uint32_t>(m_entries.size()) / 4);
+		uint32_t evicted = 0;
+		while (evicted < target && !m_lru.empty()) {
+			auto it = m_entries.find(m_lru.back());
+			if (it->second.lastFrame == m_frame) break;
+
+			m_retired.push_back(it->second.glyph.subTexture);
+			m_entries.erase(it);
+			m_lru.pop_back();
+			evicted++;
+		}
+		if (evicted == 0) return false;
+
+		if (m_beforeRepack) m_beforeRepack();
+
+		m_stats.evictions += evicted;
+		m_stats.repacks++;
+
+		// Repack most recently used first
+		m_atlas.clear();
+		for (auto it = m_lru.begin(); it != m_lru.end();) {
+			Entry& entry = m_entries.at(*it);
+			if (place(entry)) { ++it; continue; }
+
+			m_retired.push_back(entry.glyph.subTexture);
+			m_entries.erase(*it);
+			it = m_lru.erase(it);
+			m_stats.evictions++;
+		}
+
+		return true;
+	}
+
+	namespace {
+		/** \struct BakeHeader
+		*\brief start of a baked glyph cache file
+		*/
+		struct BakeHeader {
+			char magic[4]; //!< GLYC
+			uint32_t version; //!< File version
+			uint64_t fontHash; //!< Hash of the font file
+			uint32_t pixelSize; //!< Raster size
+			uint32_t mode; //!< GlyphRenderMode
+			uint32_t spread; //!< Distance field spread
+			float metricScale; //!< Raster size to display size
+			uint32_t atlasWidth; //!< Atlas width, the width of the pixel block
+			uint32_t atlasHeight; //!< Atlas height
+			uint32_t blockRows; //!< Rows of pixels after the glyphs
+			uint32_t glyphCount; //!< Glyph records after the header
+		};
+
+		/** \struct BakeGlyph
+		*\brief one glyph in a baked glyph cache file
+		*/
+		struct BakeGlyph {
+			uint32_t codepoint; //!< Codepoint
+			uint32_t x, y, width, height; //!< Pixel rect in the block
+			float size[2]; //!< GlyphData size
+			float bearing[2]; //!< GlyphData bearing
+			float advance; //!< GlyphData advance
+		};
+
+		const uint32_t bakeVersion = 1;
+	}
+
+	bool GlyphCache::save(const std::string& filepath, uint64_t fontHash, uint32_t pixelSize) const{
+		uint32_t atlasWidth = m_atlas.getBaseTexture()->getWidth();
+		uint32_t atlasHeight = m_atlas.getBaseTexture()->getHeight();
+
+		std::vector<BakeGlyph> glyphs;
+		glyphs.reserve(m_entries.size());
+		uint32_t blockRows = 0;
+
+		for (const auto& pair : m_entries) {
+			const Entry& entry = pair.second;
+			BakeGlyph glyph;
+			glyph.codepoint = pair.first;
+			glyph.width = entry.width;
+			glyph.height = entry.height;
+			glyph.x = (entry.width > 0) ? static_cast<uint32_t>(entry.glyph.subTexture->getUVStart().x * atlasWidth + 0.5f) : 0;
+			glyph.y = (entry.height > 0) ? static_cast<uint32_t>(entry.glyph.subTexture->getUVStart().y * atlasHeight + 0.5f) : 0;
+			glyph.size[0] = entry.glyph.size.x; glyph.size[1] = entry.glyph.size.y;
+			glyph.bearing[0] = entry.glyph.bearing.x; glyph.bearing[1] = entry.glyph.bearing.y;
+			glyph.advance = entry.glyph.advance;
+			glyphs.push_back(glyph);
+
+			blockRows = std::max(blockRows, glyph.y + glyph.height);
+		}
+
+		// Rebuild the used part of the atlas from the CPU copies, no read back from the GPU
+		std::vector<unsigned char> block(static_cast<size_t>(atlasWidth) * blockRows, 0);
+		for (const BakeGlyph& glyph : glyphs) {
+			const Entry& entry = m_entries.at(glyph.codepoint);
+			for (uint32_t row = 0; row < glyph.height; row++)
+				memcpy(block.data() + (glyph.y + row) * atlasWidth + glyph.x, entry.bitmap.data() + row * glyph.width, glyph.width);
+		}
+
+		BakeHeader header = { { 'G', 'L', 'Y', 'C' }, bakeVersion, fontHash, pixelSize, static_cast<uint32_t>(m_mode), m_spread, m_metricScale,
+			atlasWidth, atlasHeight, blockRows, static_cast<uint32_t>(glyphs.size()) };
+
+		std::ofstream file(filepath, std::ios::binary);
+		if (!file) return false;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(glyphs.data()), glyphs.size() * sizeof(BakeGlyph));
+		file.write(reinterpret_cast<const char*>(block.data()), block.size());
+		return static_cast<bool>(file);
+	}
+
+	bool GlyphCache::load(const std::string& filepath, uint64_t fontHash, uint32_t pixelSize){
+		std::ifstream file(filepath, std::ios::binary);
+		if (!file) return false;
+		std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (bytes.size() < sizeof(BakeHeader)) return false;
+
+		BakeHeader header;
+		memcpy(&header, bytes.data(), sizeof(header));
+
+		// Stale when anything the pixels depend on has changed
+		if (memcmp(header.magic, "GLYC", 4) != 0 || header.version != bakeVersion || header.fontHash != fontHash || header.pixelSize != pixelSize ||
+			header.mode != static_cast<uint32_t>(m_mode) || header.spread != m_spread || header.metricScale != m_metricScale ||
+			header.atlasWidth != m_atlas.getBaseTexture()->getWidth() || header.atlasHeight != m_atlas.getBaseTexture()->getHeight()) return false;
+
+		size_t glyphBytes = static_cast<size_t>(header.glyphCount) * sizeof(BakeGlyph);
+		size_t blockBytes = static_cast<size_t>(header.atlasWidth) * header.blockRows;
+		if (bytes.size() != sizeof(BakeHeader) + glyphBytes + blockBytes) return false;
+
+		const BakeGlyph* glyphs = reinterpret_cast<const BakeGlyph*>(bytes.data() + sizeof(BakeHeader));
+		unsigned char* block = reinterpret_cast<unsigned char*>(bytes.data() + sizeof(BakeHeader) + glyphBytes);
+
+		for (uint32_t i = 0; i < header.glyphCount; i++)
+			if (glyphs[i].x + glyphs[i].width > header.atlasWidth || glyphs[i].y + glyphs[i].height > header.blockRows) return false;
+
+		m_entries.clear();
+		m_lru.clear();
+		m_atlas.clear();
+
+		// The whole block goes up in one upload
+		std::shared_ptr<OpenGLTexture> texture = m_atlas.getBaseTexture();
+		if (header.blockRows > 0 && !m_atlas.addBlock(header.blockRows, 1, block, texture)) return false;
+
+		glm::vec2 atlasSize(static_cast<float>(header.atlasWidth), static_cast<float>(header.atlasHeight));
+		for (uint32_t i = 0; i < header.glyphCount; i++) {
+			const BakeGlyph& glyph = glyphs[i];
+
+			Entry entry;
+			entry.width = glyph.width;
+			entry.height = glyph.height;
+			entry.lastFrame = m_frame;
+			entry.glyph.size = { glyph.size[0], glyph.size[1] };
+			entry.glyph.bearing = { glyph.bearing[0], glyph.bearing[1] };
+			entry.glyph.advance = glyph.advance;
+
+			entry.bitmap.resize(glyph.width * glyph.height);
+			for (uint32_t row = 0; row < glyph.height; row++)
+				memcpy(entry.bitmap.data() + row * glyph.width, block + (glyph.y + row) * header.atlasWidth + glyph.x, glyph.width);
+
+			glm::vec2 UVStart(glyph.x, glyph.y);
+			glm::vec2 UVEnd(glyph.x + glyph.width, glyph.y + glyph.height);
+			if (glyph.width == 0 || glyph.height == 0) entry.glyph.subTexture.reset(new SubTexture(texture, glm::vec2(0.f), glm::vec2(0.f)));
+			else entry.glyph.subTexture.reset(new SubTexture(texture, UVStart / atlasSize, UVEnd / atlasSize));
+
+			m_lru.push_front(glyph.codepoint);
+			entry.lru = m_lru.begin();
+			m_entries.emplace(glyph.codepoint, std::move(entry));
+		}
+
+		return true;
+	}
+
+	uint64_t GlyphCache::hashFile(const char* filepath){
+		std::ifstream file(filepath, std::ios::binary);
+		if (!file) return 0;
+
+		uint64_t hash = 14695981039346656037ull;
+		char buffer[4096];
+		while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+			std::streamsize count = file.gcount();
+			for (std::streamsize i = 0; i < count; i++) {
+				hash ^= static_cast<unsigned char>(buffer[i]);
+				hash *= 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	void GlyphCache::nextFrame(){
+		m_frame++;
+		m_retired.clear();
+	}
+
+	uint32_t GlyphCache::decodeUTF8(const char*& text, const char* end){
+		const uint32_t replacement = 0xFFFD;
+		unsigned char lead = static_cast<unsigned char>(*text++);
+
+		uint32_t codepoint;
+		uint32_t continuation;
+		if (lead < 0x80) return lead;
+		else if ((lead & 0xE0) == 0xC0) { codepoint = lead & 0x1F; continuation = 1; }
+		else if ((lead & 0xF0) == 0xE0) { codepoint = lead & 0x0F; continuation = 2; }
+		else if ((lead & 0xF8) == 0xF0) { codepoint = lead & 0x07; continuation = 3; }
+		else return replacement;
+
+		for (uint32_t i = 0; i < continuation; i++) {
+			if (text == end || (static_cast<unsigned char>(*text) & 0xC0) != 0x80) return replacement;
+			codepoint = (codepoint << 6) | (static_cast<unsigned char>(*text++) & 0x3F);
+		}
+
+		// Overlong forms, surrogates and values past the last plane
+		const uint32_t minimum[4] = { 0, 0x80, 0x800, 0x10000 };
+		if (codepoint < minimum[continuation] || (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF) return replacement;
+
+		return codepoint;
+	}
+
+	namespace {
+		/** \struct SDFOffset
+		*\brief offset from a pixel to the nearest seed pixel
+		*/
+		struct SDFOffset {
+			int32_t dx, dy; //!< Offset
+			inline int32_t dist2() const { return dx * dx + dy * dy; } //!< Squared distance
+		};
+
+		const SDFOffset farAway = { 9999, 9999 };
+
+		// Two pass 8 point sequential signed euclidean distance transform
+		void sweep(std::vector<SDFOffset>& grid, int32_t width, int32_t height) {
+			auto compare = [&](SDFOffset& p, int32_t x, int32_t y, int32_t ox, int32_t oy) {
+				int32_t nx = x + ox, ny = y + oy;
+				SDFOffset other = (nx < 0 || ny < 0 || nx >= width || ny >= height) ? farAway : grid[ny * width + nx];
+				other.dx += ox;
+				other.dy += oy;
+				if (other.dist2() < p.dist2()) p = other;
+			};
+
+			for (int32_t y = 0; y < height; y++) {
+				for (int32_t x = 0; x < width; x++) {
+					SDFOffset& p = grid[y * width + x];
+					compare(p, x, y, -1, 0); compare(p, x, y, 0, -1); compare(p, x, y, -1, -1); compare(p, x, y, 1, -1);
+				}
+				for (int32_t x = width - 1; x >= 0; x--) compare(grid[y * width + x], x, y, 1, 0);
+			}
+
+			for (int32_t y = height - 1; y >= 0; y--) {
+				for (int32_t x = width - 1; x >= 0; x--) {
+					SDFOffset& p = grid[y * width + x];
+					compare(p, x, y, 1, 0); compare(p, x, y, 0, 1); compare(p, x, y, -1, 1); compare(p, x, y, 1, 1);
+				}
+				for (int32_t x = 0; x < width; x++) compare(grid[y * width + x], x, y, -1, 0);
+			}
+		}
+	}
+
+	void GlyphCache::generateSDF(const unsigned char* coverage, uint32_t width, uint32_t height, uint32_t spread, std::vector<unsigned char>& result){
+		int32_t paddedWidth = width + spread * 2;
+		int32_t paddedHeight = height + spread * 2;
+		size_t count = paddedWidth * paddedHeight;
+
+		// Distance to the nearest inside pixel, and to the nearest outside pixel
+		std::vector<SDFOffset> toInside(count, farAway);
+		std::vector<SDFOffset> toOutside(count, { 0, 0 });
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				if (coverage[y * width + x] < 128) continue;
+				size_t index = (y + spread) * paddedWidth + x + spread;
+				toInside[index] = { 0, 0 };
+				toOutside[index] = farAway;
+			}
+		}
+
+		sweep(toInside, paddedWidth, paddedHeight);
+		sweep(toOutside, paddedWidth, paddedHeight);
+
+		result.resize(count);
+		float scale = 127.f / static_cast<float>(spread);
+		for (size_t i = 0; i < count; i++) {
+			float distance = std::sqrt(static_cast<float>(toOutside[i].dist2())) - std::sqrt(static_cast<float>(toInside[i].dist2()));
+			result[i] = static_cast<unsigned char>(glm::clamp(128.f + distance * scale, 0.f, 255.f));
+		}
+	}
+}
@@ -0,0 +1,161 @@
+/** \file lightClusters.cpp */
+#include "engine_pch.h"
+#include "rendering/lightClusters.h"
+#include "core/parallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace Engine {
+	namespace {
+		const uint32_t parallelThreshold = 64; //!< Fewer lights are binned on the calling thread
+	}
+
+	Light Light::point(const glm::vec3& position, float range, const glm::vec3& colour, float intensity) {
+		return { glm::vec4(position, range), glm::vec4(colour, intensity), glm::vec4(0.f, 0.f, -1.f, -1.f) };
+	}
+
+	Light Light::spot(const glm::vec3& position, const glm::vec3& direction, float range, float angle, const glm::vec3& colour, float intensity) {
+		return { glm::vec4(position, range), glm::vec4(colour, intensity), glm::vec4(glm::normalize(direction), std::cos(angle)) };
+	}
+
+	glm::vec4 Light::getBoundingSphere() const {
+		float range = position.w;
+		float cosAngle = direction.w;
+		if (cosAngle <= 0.f) return position;
+
+		// Smallest sphere around the cone, through the cap's rim for wide cones and through the apex for narrow ones
+		glm::vec3 apex = { position.x, position.y, position.z };
+		glm::vec3 axis = { direction.x, direction.y, direction.z };
+		if (cosAngle < 0.70710678f) {
+			float sinAngle = std::sqrt(1.f - cosAngle * cosAngle);
+			return glm::vec4(apex + axis * (cosAngle * range), sinAngle * range);
+		}
+		float radius = range / (2.f * cosAngle);
+		return glm::vec4(apex + axis * radius, radius);
+	}
+
+	LightClusters::LightClusters(const glm::uvec3& grid) : m_grid(grid) {
+		m_clusterBounds.resize(getClusterCount());
+		m_clusterLights.resize(getClusterCount());
+		m_clusters.resize(getClusterCount());
+	}
+
+	void LightClusters::buildClusterBounds(const glm::mat4& projection) {
+		m_projection = projection;
+		m_near = projection[3][2] / (projection[2][2] - 1.f);
+		m_far = projection[3][2] / (projection[2][2] + 1.f);
+		m_sliceScale = m_grid.z / std::log(m_far / m_near);
+
+		for (uint32_t z = 0; z < m_grid.z; z++) {
+			float depths[2] = { m_near * std::exp(z / m_sliceScale), m_near * std::exp((z + 1) / m_sliceScale) };
+			for (uint32_t y = 0; y < m_grid.y; y++) {
+				float ndcY[2] = { -1.f + 2.f * y / m_grid.y, -1.f + 2.f * (y + 1) / m_grid.y };
+				for (uint32_t x = 0; x < m_grid.x; x++) {
+					float ndcX[2] = { -1.f + 2.f * x / m_grid.x, -1.f + 2.f * (x + 1) / m_grid.x };
+
+					// Corners of the tile on the slice's near and far depths
+					AABB& box = m_clusterBounds[getClusterIndex(x, y, z)];
+					box = AABB();
+					for (float depth : depths) {
+						for (float nx : ndcX) {
+							for (float ny : ndcY) {
+								box.grow({ depth * (nx + projection[2][0]) / projection[0][0], depth * (ny + projection[2][1]) / projection[1][1], -depth });
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	uint32_t LightClusters::slice(float depth) const {
+		float s = std::floor(std::log(depth / m_near) * m_sliceScale);
+		return static_cast<uint32_t>(glm::clamp(s, 0.f, static_cast<float>(m_grid.z - 1)));
+	}
+
+	void LightClusters::rangeLight(const Light& light, const glm::mat4& view, LightRange& range) const {
+		glm::vec4 world = light.getBoundingSphere();
+		glm::vec4 centre = view * glm::vec4(world.x, world.y, world.z, 1.f);
+		float radius = world.w;
+		range.sphere = { centre.x, centre.y, centre.z, radius };
+
+		float depth = -centre.z;
+		float nearDepth = std::max(depth - radius, m_near);
+		float farDepth = std::min(depth + radius, m_far);
+		range.visible = nearDepth <= farDepth;
+		if (!range.visible) return;
+
+		range.min[2] = slice(nearDepth);
+		range.max[2] = slice(farDepth);
+
+		// Over the sphere's box x / depth is extreme at a corner, so the tiles follow from four divisions per axis
+		auto tiles = [&](float lo, float hi, float scale, float offset, uint32_t count, uint32_t& first, uint32_t& last) {
+			float ndcMin = scale * std::min(lo / nearDepth, lo / farDepth) - offset;
+			float ndcMax = scale * std::max(hi / nearDepth, hi / farDepth) - offset;
+			if (ndcMax < -1.f || ndcMin > 1.f) return false;
+
+			float maxTile = static_cast<float>(count - 1);
+			first = static_cast<uint32_t>(glm::clamp(std::floor((ndcMin * 0.5f + 0.5f) * count), 0.f, maxTile));
+			last = static_cast<uint32_t>(glm::clamp(std::floor((ndcMax * 0.5f + 0.5f) * count), 0.f, maxTile));
+			return true;
+		};
+		range.visible = tiles(centre.x - radius, centre.x + radius, m_projection[0][0], m_projection[2][0], m_grid.x, range.min[0], range.max[0])
+			&& tiles(centre.y - radius, centre.y + radius, m_projection[1][1], m_projection[2][1], m_grid.y, range.min[1], range.max[1]);
+	}
+
+	bool LightClusters::intersects(const glm::vec4& sphere, const AABB& box) {
+		glm::vec3 centre = { sphere.x, sphere.y, sphere.z };
+		glm::vec3 closest = glm::clamp(centre, box.min, box.max);
+		glm::vec3 offset = closest - centre;
+		return offset.x * offset.x + offset.y * offset.y + offset.z * offset.z <= sphere.w * sphere.w;
+	}
+
+	void LightClusters::binSlices(uint32_t firstSlice, uint32_t lastSlice) {
+		uint32_t lightCount = static_cast<uint32_t>(m_lightRanges.size());
+		for (uint32_t i = 0; i < lightCount; i++) {
+			const LightRange& range = m_lightRanges[i];
+			if (!range.visible || range.max[2] < firstSlice || range.min[2] > lastSlice) continue;
+
+			uint32_t zEnd = std::min(range.max[2], lastSlice);
+			for (uint32_t z = std::max(range.min[2], firstSlice); z <= zEnd; z++) {
+				for (uint32_t y = range.min[1]; y <= range.max[1]; y++) {
+					for (uint32_t x = range.min[0]; x <= range.max[0]; x++) {
+						uint32_t cluster = getClusterIndex(x, y, z);
+						if (intersects(range.sphere, m_clusterBounds[cluster])) m_clusterLights[cluster].push_back(i);
+					}
+				}
+			}
+		}
+	}
+
+	void LightClusters::bin(const Light* lights, uint32_t count, const glm::mat4& view, const glm::mat4& projection, uint32_t threadCount) {
+		if (projection != m_projection) buildClusterBounds(projection);
+
+		if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+		if (count < parallelThreshold) threadCount = 1;
+
+		m_lightRanges.resize(count);
+		parallelFor(count, threadCount, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) rangeLight(lights[i], view, m_lightRanges[i]);
+		});
+
+		// Each thread owns whole depth slices, so no two threads write the same cluster
+		for (auto& list : m_clusterLights) list.clear();
+		parallelFor(m_grid.z, threadCount, [&](uint32_t begin, uint32_t end) {
+			if (begin < end) binSlices(begin, end - 1);
+		});
+
+		m_lightIndices.clear();
+		for (uint32_t c = 0; c < getClusterCount(); c++) {
+			const std::vector<uint32_t>& list = m_clusterLights[c];
+			m_clusters[c] = { static_cast<uint32_t>(m_lightIndices.size()), static_cast<uint32_t>(list.size()) };
+			m_lightIndices.insert(m_lightIndices.end(), list.begin(), list.end());
+		}
+	}
+
+	ClusterHeader LightClusters::getHeader(uint32_t lightCount) const {
+		return { glm::uvec4(m_grid.x, m_grid.y, m_grid.z, lightCount), glm::vec4(m_near, m_far, m_sliceScale, 0.f) };
+	}
+}
@@ -0,0 +1,70 @@
+/** \file lodSet.cpp */
+#include "engine_pch.h"
+#include "rendering/lodSet.h"
+#include "systems/loggerSys.h"
+
+#include <algorithm>
+
+namespace Engine {
+	uint32_t LODLevel::getTriangleCount() const {
+		return (geometry ? geometry->getDrawnCount() : mesh.indexCount) / 3;
+	}
+
+	const BoundingVolume& LODLevel::getBounds() const {
+		return geometry ? geometry->getBounds() : mesh.bounds;
+	}
+
+	void LODSet::addLevel(const LODLevel& level) {
+		if (m_levels.size() == maxLevels) {
+			LoggerSys::error("LOD set already has {0} levels", maxLevels);
+			return;
+		}
+		m_levels.push_back(level);
+	}
+
+	uint32_t LODSet::select(float screenSize, uint32_t current) const {
+		uint32_t count = getLevelCount();
+
+		// The first selection has nothing to hold on to
+		if (current == LODState::none) {
+			current = 0;
+			while (current < count && screenSize < m_levels[current].screenSize) current++;
+			return current;
+		}
+
+		// Finer once the finer threshold is passed by the margin, coarser once the current one is missed by it
+		current = std::min(current, count);
+		while (current > 0 && screenSize >= m_levels[current - 1].screenSize * (1.f + m_hysteresis)) current--;
+		while (current < count && screenSize < m_levels[current].screenSize * (1.f - m_hysteresis)) current++;
+		return current;
+	}
+
+	void LODSet::update(float screenSize, LODState& state) const {
+		uint32_t level = select(screenSize, state.level);
+		if (level != state.level) {
+			bool fade = m_fadeFrames > 0 && state.level != LODState::none;
+			state.previous = fade ? state.level : LODState::none;
+			state.fade = fade ? 1.f / m_fadeFrames : 1.f;
+			state.level = level;
+		}
+		else if (state.fade < 1.f) {
+			state.fade = std::min(1.f, state.fade + 1.f / m_fadeFrames);
+		}
+	}
+
+	float LODSet::projectedSize(const glm::vec4& sphere, const glm::mat4& view, const glm::mat4& projection) {
+		glm::vec4 centre = view * glm::vec4(sphere.x, sphere.y, sphere.z, 1.f);
+		float distance = std::sqrt(centre.x * centre.x + centre.y * centre.y + centre.z * centre.z);
+
+		// Inside the sphere it covers the whole screen
+		if (distance <= sphere.w) return std::numeric_limits<float>::max();
+
+		// Distance rather than depth so turning the camera does not change the level
+		return sphere.w * projection[1][1] / distance;
+	}
+
+	float LODSet::adjustBias(float bias, float frameTime, float budget, float rate, float maxBias) {
+		float overBudget = frameTime / budget - 1.f;
+		return glm::clamp(bias + rate * overBudget, 0.f, maxBias);
+	}
+}
@@ -0,0 +1,265 @@
+/** \file occlusionCuller.cpp */
+#include "engine_pch.h"
+#include "rendering/occlusionCuller.h"
+#include "core/parallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace Engine {
+	namespace {
+		const float minW = 1e-5f; //!< Clip w below which a point is treated as behind the camera
+		const uint32_t maxFootprint = 4; //!< Most texels across a box is tested against on each axis
+	}
+
+	OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height) {
+		m_tilesX = (width + tileSize - 1) / tileSize;
+		m_tilesY = (height + tileSize - 1) / tileSize;
+		m_width = m_tilesX * tileSize;
+		m_height = m_tilesY * tileSize;
+		m_tileTriangles.resize(m_tilesX * m_tilesY);
+
+		uint32_t w = m_width, h = m_height;
+		while (true) {
+			m_levels.push_back(std::vector<float>(w * h, 1.f));
+			if (w == 1 && h == 1) break;
+			w = std::max(1u, w / 2);
+			h = std::max(1u, h / 2);
+		}
+	}
+
+	void OcclusionCuller::begin(const glm::mat4& viewProjection) {
+		m_viewProjection = viewProjection;
+		m_occluders.clear();
+		m_stats = OcclusionStats();
+		std::fill(m_levels[0].begin(), m_levels[0].end(), 1.f);
+	}
+
+	void OcclusionCuller::addOccluder(const void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t offset, const uint32_t* indices, uint32_t indexCount, const glm::mat4& model) {
+		m_occluders.push_back({ static_cast<const unsigned char*>(vertices) + offset, vertexCount, stride, indices, indexCount, model });
+	}
+
+	void OcclusionCuller::setup(const Occluder& occluder) {
+		glm::mat4 transform = m_viewProjection * occluder.model;
+		m_clip.resize(occluder.vertexCount);
+		for (uint32_t i = 0; i < occluder.vertexCount; i++) {
+			float p[3];
+			memcpy(p, occluder.vertices + i * occluder.stride, sizeof(p));
+			m_clip[i] = transform * glm::vec4(p[0], p[1], p[2], 1.f);
+		}
+
+		// Clip against the near plane z = -w before the divide, like the GPU does, leaving up to four vertices to fan
+		for (uint32_t i = 0; i + 2 < occluder.indexCount; i += 3) {
+			const glm::vec4* v[3] = { &m_clip[occluder.indices[i]], &m_clip[occluder.indices[i + 1]], &m_clip[occluder.indices[i + 2]] };
+
+			glm::vec4 clipped[4];
+			uint32_t count = 0;
+			for (int j = 0; j < 3; j++) {
+				const glm::vec4& a = *v[j];
+				const glm::vec4& b = *v[(j + 1) % 3];
+				float da = a.z + a.w, db = b.z + b.w;
+				if (da >= 0.f) clipped[count++] = a;
+				if ((da >= 0.f) != (db >= 0.f)) clipped[count++] = a + (b - a) * (da / (da - db));
+			}
+
+			for (uint32_t j = 1; j + 1 < count; j++) addTriangle(clipped[0], clipped[j], clipped[j + 1]);
+		}
+	}
+
+	void OcclusionCuller::addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+		const glm::vec4* v[3] = { &a, &b, &c };
+		if (v[0]->w < minW || v[1]->w < minW || v[2]->w < minW) return;
+
+		float width = static_cast<float>(m_width);
+		float height = static_cast<float>(m_height);
+		float x[3], y[3], z[3];
+		for (int j = 0; j < 3; j++) {
+			float invW = 1.f / v[j]->w;
+			x[j] = (v[j]->x * invW * 0.5f + 0.5f) * width;
+			y[j] = (v[j]->y * invW * 0.5f + 0.5f) * height;
+			z[j] = v[j]->z * invW * 0.5f + 0.5f;
+		}
+
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (std::abs(area) < 1e-6f) return;
+
+		Triangle triangle;
+		triangle.minX = std::max(0, static_cast<int32_t>(std::floor(std::min({ x[0], x[1], x[2] }))));
+		triangle.maxX = std::min(static_cast<int32_t>(m_width) - 1, static_cast<int32_t>(std::ceil(std::max({ x[0], x[1], x[2] }))));
+		triangle.minY = std::max(0, static_cast<int32_t>(std::floor(std::min({ y[0], y[1], y[2] }))));
+		triangle.maxY = std::min(static_cast<int32_t>(m_height) - 1, static_cast<int32_t>(std::ceil(std::max({ y[0], y[1], y[2] }))));
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+
+		// Edge functions wound so the inside is positive whichever way the triangle faces
+		float sign = area > 0.f ? 1.f : -1.f;
+		for (int j = 0; j < 3; j++) {
+			int k = (j + 1) % 3;
+			triangle.edges[j][0] = sign * (y[j] - y[k]);
+			triangle.edges[j][1] = sign * (x[k] - x[j]);
+			triangle.edges[j][2] = sign * (x[j] * y[k] - x[k] * y[j]);
+		}
+
+		// NDC depth is linear in screen space
+		float dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+		float dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+		triangle.depth[0] = dzdx;
+		triangle.depth[1] = dzdy;
+		triangle.depth[2] = z[0] - dzdx * x[0] - dzdy * y[0];
+
+		uint32_t index = static_cast<uint32_t>(m_triangles.size());
+		m_triangles.push_back(triangle);
+		m_stats.occluderTriangles++;
+
+		for (int32_t ty = triangle.minY / tileSize; ty <= triangle.maxY / static_cast<int32_t>(tileSize); ty++) {
+			for (int32_t tx = triangle.minX / tileSize; tx <= triangle.maxX / static_cast<int32_t>(tileSize); tx++) {
+				m_tileTriangles[ty * m_tilesX + tx].push_back(index);
+			}
+		}
+	}
+
+	void OcclusionCuller::rasterizeTile(uint32_t tile) {
+		int32_t tileX = static_cast<int32_t>((tile % m_tilesX) * tileSize);
+		int32_t tileY = static_cast<int32_t>((tile / m_tilesX) * tileSize);
+		float* depth = m_levels[0].data();
+
+		const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+
+		for (uint32_t index : m_tileTriangles[tile]) {
+			const Triangle& t = m_triangles[index];
+
+			// Tiles start on a multiple of 4 so every group of 4 pixels stays inside the tile
+			int32_t x0 = std::max(t.minX, tileX) & ~3;
+			int32_t x1 = std::min(t.maxX, tileX + static_cast<int32_t>(tileSize) - 1);
+			int32_t y0 = std::max(t.minY, tileY);
+			int32_t y1 = std::min(t.maxY, tileY + static_cast<int32_t>(tileSize) - 1);
+
+			__m128 a[3], step[3];
+			for (int j = 0; j < 3; j++) {
+				a[j] = _mm_set1_ps(t.edges[j][0]);
+				step[j] = _mm_set1_ps(t.edges[j][0] * 4.f);
+			}
+			__m128 depthX = _mm_set1_ps(t.depth[0]);
+			__m128 depthStep = _mm_set1_ps(t.depth[0] * 4.f);
+			__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x0)), laneOffsets);
+
+			for (int32_t y = y0; y <= y1; y++) {
+				float py = y + 0.5f;
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(a[0], px), _mm_set1_ps(t.edges[0][1] * py + t.edges[0][2]));
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(a[1], px), _mm_set1_ps(t.edges[1][1] * py + t.edges[1][2]));
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(a[2], px), _mm_set1_ps(t.edges[2][1] * py + t.edges[2][2]));
+				__m128 z = _mm_add_ps(_mm_mul_ps(depthX, px), _mm_set1_ps(t.depth[1] * py + t.depth[2]));
+
+				float* row = depth + y * m_width;
+				for (int32_t x = x0; x <= x1; x += 4) {
+					__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+					if (_mm_movemask_ps(inside)) {
+						__m128 current = _mm_loadu_ps(row + x);
+						__m128 nearest = _mm_min_ps(current, z);
+						_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+					}
+					e0 = _mm_add_ps(e0, step[0]);
+					e1 = _mm_add_ps(e1, step[1]);
+					e2 = _mm_add_ps(e2, step[2]);
+					z = _mm_add_ps(z, depthStep);
+				}
+			}
+		}
+	}
+
+	void OcclusionCuller::buildHierarchy() {
+		uint32_t w = m_width, h = m_height;
+		for (size_t level = 1; level < m_levels.size(); level++) {
+			const std::vector<float>& source = m_levels[level - 1];
+			std::vector<float>& target = m_levels[level];
+			uint32_t targetW = std::max(1u, w / 2), targetH = std::max(1u, h / 2);
+
+			// Each texel keeps the furthest depth beneath it, an odd row or column left over folds into the last texel
+			for (uint32_t y = 0; y < targetH; y++) {
+				for (uint32_t x = 0; x < targetW; x++) {
+					uint32_t sx0 = x * 2, sx1 = std::min(w - 1, x * 2 + 1 + (x == targetW - 1 ? w % 2 : 0));
+					uint32_t sy0 = y * 2, sy1 = std::min(h - 1, y * 2 + 1 + (y == targetH - 1 ? h % 2 : 0));
+					float furthest = 0.f;
+					for (uint32_t sy = sy0; sy <= sy1; sy++) {
+						for (uint32_t sx = sx0; sx <= sx1; sx++) furthest = std::max(furthest, source[sy * w + sx]);
+					}
+					target[y * targetW + x] = furthest;
+				}
+			}
+			w = targetW;
+			h = targetH;
+		}
+	}
+
+	void OcclusionCuller::rasterize(uint32_t threadCount) {
+		m_triangles.clear();
+		for (auto& list : m_tileTriangles) list.clear();
+		for (const Occluder& occluder : m_occluders) setup(occluder);
+
+		// Threads own whole tiles so no two write the same pixel
+		parallelFor(m_tilesX * m_tilesY, threadCount, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t tile = begin; tile < end; tile++) rasterizeTile(tile);
+		});
+
+		buildHierarchy();
+	}
+
+	bool OcclusionCuller::isVisible(const AABB& box) {
+		m_stats.tested++;
+
+		// Screen rectangle and nearest depth of the box's corners
+		float minX = std::numeric_limits<float>::max(), minY = minX, minZ = minX;
+		float maxX = -minX, maxY = -minX;
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec4 point = { corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z, 1.f };
+			glm::vec4 clip = m_viewProjection * point;
+			if (clip.w < minW) return true; // Reaches behind the camera
+
+			float invW = 1.f / clip.w;
+			float x = (clip.x * invW * 0.5f + 0.5f) * m_width;
+			float y = (clip.y * invW * 0.5f + 0.5f) * m_height;
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			minZ = std::min(minZ, clip.z * invW * 0.5f + 0.5f);
+		}
+
+		// Off screen boxes are left to frustum culling
+		if (maxX < 0.f || maxY < 0.f || minX >= m_width || minY >= m_height) return true;
+
+		int32_t x0 = std::max(0, static_cast<int32_t>(minX));
+		int32_t x1 = std::min(static_cast<int32_t>(m_width) - 1, static_cast<int32_t>(maxX));
+		int32_t y0 = std::max(0, static_cast<int32_t>(minY));
+		int32_t y1 = std::min(static_cast<int32_t>(m_height) - 1, static_cast<int32_t>(maxY));
+
+		// Coarsest level first where the rectangle covers at most maxFootprint texels each way
+		uint32_t level = 0;
+		while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) >= static_cast<int32_t>(maxFootprint) || (y1 >> level) - (y0 >> level) >= static_cast<int32_t>(maxFootprint))) level++;
+
+		uint32_t levelWidth = std::max(1u, m_width >> level);
+		uint32_t levelHeight = std::max(1u, m_height >> level);
+		const std::vector<float>& depth = m_levels[level];
+		int32_t lx1 = std::min(x1 >> level, static_cast<int32_t>(levelWidth) - 1);
+		int32_t ly1 = std::min(y1 >> level, static_cast<int32_t>(levelHeight) - 1);
+		for (int32_t y = std::min(y0 >> level, ly1); y <= ly1; y++) {
+			for (int32_t x = std::min(x0 >> level, lx1); x <= lx1; x++) {
+				if (minZ <= depth[y * levelWidth + x]) return true;
+			}
+		}
+
+		m_stats.occluded++;
+		return false;
+	}
+
+	uint32_t OcclusionCuller::testVisibility(const AABB* boxes, uint32_t count, uint8_t* visible) {
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			visible[i] = isVisible(boxes[i]) ? 1 : 0;
+			visibleCount += visible[i];
+		}
+		return visibleCount;
+	}
+}
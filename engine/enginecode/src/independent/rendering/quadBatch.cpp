@@ -0,0 +1,126 @@
+/** \file quadBatch.cpp */
+#include "engine_pch.h"
+#include "rendering/quadBatch.h"
+#include "rendering/Renderer2D.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <emmintrin.h>
+
+namespace Engine {
+	namespace QuadBatch {
+		void writeVerticesScalar(const QuadInstance* quads, const uint32_t* texUnits, const glm::vec4* uvRects, uint32_t count, Renderer2DVertex* out) {
+			const glm::vec4 corners[4] = { { -0.5f, -0.5f, 1.f, 1.f }, { -0.5f, 0.5f, 1.f, 1.f }, { 0.5f, 0.5f, 1.f, 1.f }, { 0.5f, -0.5f, 1.f, 1.f } };
+
+			for (uint32_t i = 0; i < count; i++) {
+				const QuadInstance& quad = quads[i];
+				float angle = std::atan2(quad.rotation.y, quad.rotation.x);
+				glm::mat4 model = glm::scale(glm::rotate(glm::translate(glm::mat4(1.f), glm::vec3(quad.translate, 0.f)), angle, { 0.f, 0.f, 1.f }), glm::vec3(quad.scale, 1.f));
+
+				uint32_t packedTint = Renderer2DVertex::pack(quad.tint);
+				const glm::vec4& uv = uvRects[i];
+
+				for (int j = 0; j < 4; j++) {
+					out[j].position = model * corners[j];
+					out[j].texUnit = texUnits[i];
+					out[j].tint = packedTint;
+				}
+
+				out[0].uvCoords = { uv.x, uv.y };
+				out[1].uvCoords = { uv.x, uv.w };
+				out[2].uvCoords = { uv.z, uv.w };
+				out[3].uvCoords = { uv.z, uv.y };
+
+				out += 4;
+			}
+		}
+
+		void writeVertices(const QuadInstance* quads, const uint32_t* texUnits, const glm::vec4* uvRects, uint32_t count, Renderer2DVertex* out) {
+			static_assert(sizeof(Renderer2DVertex) == 32, "SIMD quad writer expects 32 byte vertices");
+
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 one = _mm_set1_ps(1.f);
+			const __m128 maxByte = _mm_set1_ps(255.f);
+
+			uint32_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				const float* q0 = &quads[i + 0].translate.x;
+				const float* q1 = &quads[i + 1].translate.x;
+				const float* q2 = &quads[i + 2].translate.x;
+				const float* q3 = &quads[i + 3].translate.x;
+
+				// Transpose four quads into structure of arrays form
+				__m128 tx = _mm_loadu_ps(q0), ty = _mm_loadu_ps(q1), sx = _mm_loadu_ps(q2), sy = _mm_loadu_ps(q3);
+				_MM_TRANSPOSE4_PS(tx, ty, sx, sy);
+
+				__m128 cosA = _mm_loadu_ps(q0 + 4), sinA = _mm_loadu_ps(q1 + 4), pad0 = _mm_loadu_ps(q2 + 4), pad1 = _mm_loadu_ps(q3 + 4);
+				_MM_TRANSPOSE4_PS(cosA, sinA, pad0, pad1);
+
+				__m128 r = _mm_loadu_ps(q0 + 8), g = _mm_loadu_ps(q1 + 8), b = _mm_loadu_ps(q2 + 8), a = _mm_loadu_ps(q3 + 8);
+				_MM_TRANSPOSE4_PS(r, g, b, a);
+
+				__m128 u0 = _mm_loadu_ps(&uvRects[i + 0].x), v0 = _mm_loadu_ps(&uvRects[i + 1].x), u1 = _mm_loadu_ps(&uvRects[i + 2].x), v1 = _mm_loadu_ps(&uvRects[i + 3].x);
+				_MM_TRANSPOSE4_PS(u0, v0, u1, v1);
+
+				// Pack the tints, truncating like Renderer2DVertex::pack
+				__m128i packed = _mm_cvttps_epi32(_mm_mul_ps(r, maxByte));
+				packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(g, maxByte)), 8));
+				packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(b, maxByte)), 16));
+				packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(a, maxByte)), 24));
+				__m128 tints = _mm_castsi128_ps(packed);
+				__m128 units = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(texUnits + i)));
+
+				// Half extents along the rotated axes, corners are then +/- combinations of these
+				__m128 hx = _mm_mul_ps(sx, half), hy = _mm_mul_ps(sy, half);
+				__m128 axisXx = _mm_mul_ps(cosA, hx), axisXy = _mm_mul_ps(sinA, hx);
+				__m128 axisYx = _mm_mul_ps(sinA, hy), axisYy = _mm_mul_ps(cosA, hy);
+
+				// Corner order matches Renderer2D: (-,-), (-,+), (+,+), (+,-)
+				__m128 px[4], py[4];
+				px[0] = _mm_add_ps(_mm_sub_ps(tx, axisXx), axisYx); py[0] = _mm_sub_ps(_mm_sub_ps(ty, axisXy), axisYy);
+				px[1] = _mm_sub_ps(_mm_sub_ps(tx, axisXx), axisYx); py[1] = _mm_add_ps(_mm_sub_ps(ty, axisXy), axisYy);
+				px[2] = _mm_sub_ps(_mm_add_ps(tx, axisXx), axisYx); py[2] = _mm_add_ps(_mm_add_ps(ty, axisXy), axisYy);
+				px[3] = _mm_add_ps(_mm_add_ps(tx, axisXx), axisYx); py[3] = _mm_sub_ps(_mm_add_ps(ty, axisXy), axisYy);
+
+				__m128 cu[4] = { u0, u0, u1, u1 };
+				__m128 cv[4] = { v0, v1, v1, v0 };
+
+				float* dst = reinterpret_cast<float*>(out + i * 4);
+				for (int c = 0; c < 4; c++) {
+					__m128 p0 = px[c], p1 = py[c], p2 = one, p3 = one;
+					_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+					__m128 a0 = cu[c], a1 = cv[c], a2 = units, a3 = tints;
+					_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+
+					// Quad n corner c lives at vertex n * 4 + c, 8 floats per vertex
+					_mm_storeu_ps(dst + (0 * 4 + c) * 8, p0); _mm_storeu_ps(dst + (0 * 4 + c) * 8 + 4, a0);
+					_mm_storeu_ps(dst + (1 * 4 + c) * 8, p1); _mm_storeu_ps(dst + (1 * 4 + c) * 8 + 4, a1);
+					_mm_storeu_ps(dst + (2 * 4 + c) * 8, p2); _mm_storeu_ps(dst + (2 * 4 + c) * 8 + 4, a2);
+					_mm_storeu_ps(dst + (3 * 4 + c) * 8, p3); _mm_storeu_ps(dst + (3 * 4 + c) * 8 + 4, a3);
+				}
+			}
+
+			// Remaining quads which do not fill a whole register
+			if (i < count) writeVerticesScalar(quads + i, texUnits + i, uvRects + i, count - i, out + i * 4);
+		}
+
+		void writeInstances(const QuadInstance* quads, const uint32_t* texUnits, const glm::vec4* uvRects, uint32_t count, Renderer2DInstance* out) {
+			for (uint32_t i = 0; i < count; i++) {
+				out[i].translate = quads[i].translate;
+				out[i].scale = quads[i].scale;
+				Renderer2DInstance::packUVs({ uvRects[i].x, uvRects[i].y }, { uvRects[i].z, uvRects[i].w }, out[i].uvRect);
+				out[i].rotation = quads[i].rotation;
+				out[i].texUnit = texUnits[i];
+				out[i].tint = Renderer2DVertex::pack(quads[i].tint);
+			}
+		}
+
+		uint64_t sortKey(int32_t layer, uint32_t segment, bool translucent, bool strict, uint32_t texture, uint32_t index) {
+			uint64_t layerBits = static_cast<uint64_t>(glm::clamp(layer, -32768, 32767) + 32768);
+			uint64_t segmentBits = segment < maxSortSegment ? segment : maxSortSegment;
+			uint64_t classBits = (translucent && !strict) ? 1 : 0;
+			uint64_t textureBits = strict ? 0 : (texture & 0xFFFF);
+			uint64_t indexBits = index < maxSortIndex ? index : maxSortIndex;
+			return (layerBits << 48) | (segmentBits << 40) | (classBits << 39) | (textureBits << 23) | indexBits;
+		}
+	}
+}
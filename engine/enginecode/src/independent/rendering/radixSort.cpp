@@ -0,0 +1,43 @@
+/** \file radixSort.cpp */
+#include "engine_pch.h"
+#include "rendering/radixSort.h"
+
+#include <utility>
+
+namespace Engine {
+	void radixSort(SortEntry* entries, SortEntry* scratch, uint32_t count) {
+		if (count < 2) return;
+
+		// Histograms for all eight bytes in one read of the keys
+		uint32_t histograms[8][256] = {};
+		for (uint32_t i = 0; i < count; i++) {
+			uint64_t key = entries[i].key;
+			for (int pass = 0; pass < 8; pass++) histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+		}
+
+		SortEntry* src = entries;
+		SortEntry* dst = scratch;
+
+		for (int pass = 0; pass < 8; pass++) {
+			uint32_t* histogram = histograms[pass];
+			uint32_t shift = pass * 8;
+
+			// Every key has the same byte here so this pass would not move anything
+			if (histogram[(src[0].key >> shift) & 0xFF] == count) continue;
+
+			uint32_t offset = 0;
+			for (int bucket = 0; bucket < 256; bucket++) {
+				uint32_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+
+			for (uint32_t i = 0; i < count; i++) dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+			std::swap(src, dst);
+		}
+
+		// An odd number of passes leaves the result in the scratch space
+		if (src != entries) for (uint32_t i = 0; i < count; i++) entries[i] = src[i];
+	}
+}
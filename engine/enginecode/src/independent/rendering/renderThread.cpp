@@ -0,0 +1,140 @@
+/** \file renderThread.cpp */
+#include "engine_pch.h"
+#include "rendering/renderThread.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace Engine {
+	FramePacket::~FramePacket(){
+		clear();
+	}
+	void* FramePacket::allocate(size_t size, size_t alignment){
+		while (true) {
+			if (m_block < m_blocks.size()) {
+				size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+				if (offset + size <= m_blockSizes[m_block]) {
+					m_offset = offset + size;
+					return m_blocks[m_block].get() + offset;
+				}
+				// Move on to the next block, adding one when every block kept from earlier frames is used
+				m_block++;
+				m_offset = 0;
+				continue;
+			}
+
+			// new[] is aligned for any fundamental type, oversized requests get a block of their own
+			size_t capacity = std::max(blockSize, size + alignment);
+			m_blocks.emplace_back(new unsigned char[capacity]);
+			m_blockSizes.push_back(capacity);
+		}
+	}
+	void FramePacket::execute(){
+		for (Command& command : m_commands) {
+			command.execute(command.object);
+			command.destroy(command.object);
+		}
+		m_commands.clear();
+		m_block = 0;
+		m_offset = 0;
+	}
+	void FramePacket::clear(){
+		for (Command& command : m_commands) command.destroy(command.object);
+		m_commands.clear();
+		m_block = 0;
+		m_offset = 0;
+	}
+
+	RenderThread::~RenderThread(){
+		stop();
+	}
+	void RenderThread::start(const std::function<void()>& onStart, const std::function<void()>& onStop){
+		if (m_running) return;
+		m_stopping = false;
+		m_running = true;
+		m_thread = std::thread(&RenderThread::loop, this, onStart, onStop);
+	}
+	void RenderThread::stop(){
+		if (!m_running) return;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_condition.notify_all();
+		m_thread.join();
+		m_running = false;
+	}
+	bool RenderThread::isRenderThread() const{
+		if (!m_running) return true;
+		return std::this_thread::get_id() == m_renderThreadID;
+	}
+	void RenderThread::loop(const std::function<void()>& onStart, const std::function<void()>& onStop){
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_renderThreadID = std::this_thread::get_id();
+		}
+		if (onStart) onStart();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			m_condition.wait(lock, [this] { return m_pending || m_stopping; });
+			if (m_pending) {
+				// The packet not being recorded is ours until pending is cleared
+				FramePacket& packet = m_packets[1 - m_recording];
+				lock.unlock();
+
+				auto start = std::chrono::high_resolution_clock::now();
+				packet.execute();
+				std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+				lock.lock();
+				m_stats.frames++;
+				m_stats.lastExecuteTime = elapsed.count();
+				m_pending = false;
+				m_condition.notify_all();
+			}
+			else if (m_stopping) break;
+		}
+		lock.unlock();
+
+		if (onStop) onStop();
+	}
+	void RenderThread::waitIdle(std::unique_lock<std::mutex>& lock){
+		m_condition.wait(lock, [this] { return !m_pending; });
+	}
+	void RenderThread::submitFrame(){
+		if (!m_running) {
+			auto start = std::chrono::high_resolution_clock::now();
+			m_packets[m_recording].execute();
+			std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stats.frames++;
+			m_stats.lastExecuteTime = elapsed.count();
+			m_stats.lastWaitTime = 0.f;
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// Bound the latency to one frame, the previous packet must finish before this one is handed over
+		auto start = std::chrono::high_resolution_clock::now();
+		waitIdle(lock);
+		std::chrono::duration<float> waited = std::chrono::high_resolution_clock::now() - start;
+		m_stats.lastWaitTime = waited.count();
+
+		m_recording = 1 - m_recording;
+		m_pending = true;
+		lock.unlock();
+		m_condition.notify_all();
+	}
+	void RenderThread::finish(){
+		if (!m_running) return;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		waitIdle(lock);
+	}
+	RenderThreadStats RenderThread::getStats(){
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+}
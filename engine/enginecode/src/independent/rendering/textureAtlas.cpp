@@ -6,46 +6,83 @@
 #include <stb_image.h>
 
 namespace Engine {
-	TextureAtlas::TextureAtlas(glm::ivec2 size, uint32_t channels, uint32_t reservedSpaces){
-		m_baseTexture.reset(new OpenGLTexture(size.x, size.y, channels, nullptr, 0));
-
-		m_spaces.reserve(reservedSpaces);
-		m_spaces.push_back({ 0,0,size.x,size.y });
+	TextureAtlas::TextureAtlas(glm::ivec2 size, uint32_t channels, uint32_t reservedSpaces, uint32_t maxPages) :
+		m_pageSize(size), m_reservedSpaces(reservedSpaces), m_maxPages(maxPages) {
+		addPage(channels);
+	}
+	void TextureAtlas::addPage(uint32_t channels){
+		AtlasPage page;
+		page.texture.reset(new OpenGLTexture(m_pageSize.x, m_pageSize.y, channels, nullptr, 0));
+		page.channels = channels;
+		page.spaces.reserve(m_reservedSpaces);
+		page.spaces.push_back({ 0, 0, m_pageSize.x, m_pageSize.y });
+		m_pages.push_back(page);
+	}
+	void TextureAtlas::clear(){
+		for (auto& page : m_pages) {
+			page.spaces.clear();
+			page.spaces.push_back({ 0, 0, m_pageSize.x, m_pageSize.y });
+		}
 	}
 	bool TextureAtlas::add(const char* filepath, std::shared_ptr<SubTexture>& result){
 		int32_t width, height, channels;
 		unsigned char* data = stbi_load(filepath, &width, &height, &channels, static_cast<int>(getChannels()));
+		if (!data) return false;
 
-		if (data) return add(width, height, channels, data, result);
+		// Loaded with the channels asked for, not the ones in the file
+		bool added = add(width, height, getChannels(), data, result);
 
 		stbi_image_free(data);
-		return false;
+		return added;
 	}
 	bool TextureAtlas::add(int32_t width, int32_t height, uint32_t channels, unsigned char* data, std::shared_ptr<SubTexture>& result){
-		if (channels != getChannels()) return false; // Early exit as channels don't match
+		for (auto& page : m_pages) {
+			if (page.channels == channels && add(page, width, height, data, result)) return true;
+		}
 
+		// No page of this format has space, start a new one
+		if (m_pages.size() >= m_maxPages) return false;
+		addPage(channels);
+		return add(m_pages.back(), width, height, data, result);
+	}
+	bool TextureAtlas::addBlock(int32_t rows, uint32_t channels, unsigned char* data, std::shared_ptr<OpenGLTexture>& texture){
+		if (rows <= 0 || rows >= m_pageSize.y) return false;
+
+		for (auto& page : m_pages) {
+			// Only an untouched page, the block starts at the top left
+			bool empty = page.spaces.size() == 1 && page.spaces[0].x == 0 && page.spaces[0].y == 0 && page.spaces[0].w == m_pageSize.x && page.spaces[0].h == m_pageSize.y;
+			if (page.channels != channels || !empty) continue;
+
+			page.texture->edit(0, 0, m_pageSize.x, rows, data);
+			page.spaces[0] = { 0, rows, m_pageSize.x, m_pageSize.y - rows };
+			texture = page.texture;
+			return true;
+		}
+		return false;
+	}
+	bool TextureAtlas::add(AtlasPage& page, int32_t width, int32_t height, unsigned char* data, std::shared_ptr<SubTexture>& result){
 		if (width == 0 || height == 0) {
-			result.reset(new SubTexture(m_baseTexture, glm::vec2(0.f), glm::vec2(0.f)));
+			result.reset(new SubTexture(page.texture, glm::vec2(0.f), glm::vec2(0.f)));
 			return true;
 		}
-		for (auto it = m_spaces.begin(); it != m_spaces.end(); ++it) {
+		for (auto it = page.spaces.begin(); it != page.spaces.end(); ++it) {
 			auto& space = *it;
 			// Does the texture fit this space
 			if (width < space.w && height < space.h) {
 				// Texture fits
-				m_baseTexture->edit(space.x, space.y, width, height, data);
+				page.texture->edit(space.x, space.y, width, height, data);
 
 				//Set subTexture result
-				glm::vec2 UVStart(static_cast<float>(space.x) / m_baseTexture->getWidthf(), static_cast<float>(space.y) / m_baseTexture->getHeightf());
-				glm::vec2 UVEnd(static_cast<float>(space.x + width) / m_baseTexture->getWidthf(), static_cast<float>(space.y + height) / m_baseTexture->getHeightf());
+				glm::vec2 UVStart(static_cast<float>(space.x) / page.texture->getWidthf(), static_cast<float>(space.y) / page.texture->getHeightf());
+				glm::vec2 UVEnd(static_cast<float>(space.x + width) / page.texture->getWidthf(), static_cast<float>(space.y + height) / page.texture->getHeightf());
 
-				result.reset(new SubTexture(m_baseTexture, UVStart, UVEnd));
+				result.reset(new SubTexture(page.texture, UVStart, UVEnd));
 
 				//Sort out remaining spaces
 
 				//Case 1: Texture matches space size, delete space
 				if (width == space.w && height == space.h){
-					m_spaces.erase(it);
+					page.spaces.erase(it);
 					return true;
 				}
 
@@ -89,9 +126,9 @@ namespace Engine {
 
 					space.x += width;
 					space.w -= width;
-					m_spaces.push_back(newRect);
+					page.spaces.push_back(newRect);
 
-					std::sort(m_spaces.begin(), m_spaces.end(), [](SimpleRect& a, SimpleRect& b)
+					std::sort(page.spaces.begin(), page.spaces.end(), [](SimpleRect& a, SimpleRect& b)
 						{return a.w < b.w; }
 					);
 
@@ -0,0 +1,72 @@
+/** \file transformBatch.cpp */
+#include "engine_pch.h"
+#include "rendering/transformBatch.h"
+
+#include <emmintrin.h>
+
+namespace Engine {
+	namespace TransformBatch {
+		void writeNormalMatricesScalar(ObjectTransform* transforms, uint32_t count) {
+			for (uint32_t i = 0; i < count; i++) {
+				const glm::mat4& model = transforms[i].model;
+				glm::vec3 c0 = { model[0].x, model[0].y, model[0].z };
+				glm::vec3 c1 = { model[1].x, model[1].y, model[1].z };
+				glm::vec3 c2 = { model[2].x, model[2].y, model[2].z };
+
+				// The inverse transpose of the upper 3x3 is its cofactor matrix over the determinant
+				glm::vec3 n0 = glm::cross(c1, c2);
+				glm::vec3 n1 = glm::cross(c2, c0);
+				glm::vec3 n2 = glm::cross(c0, c1);
+				float invDet = 1.f / glm::dot(c0, n0);
+
+				transforms[i].normal[0] = glm::vec4(n0 * invDet, 0.f);
+				transforms[i].normal[1] = glm::vec4(n1 * invDet, 0.f);
+				transforms[i].normal[2] = glm::vec4(n2 * invDet, 0.f);
+			}
+		}
+
+		void writeNormalMatrices(ObjectTransform* transforms, uint32_t count) {
+			static_assert(sizeof(ObjectTransform) == 112, "Transform buffer expects 112 byte entries");
+
+			const __m128 zero = _mm_setzero_ps();
+
+			uint32_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				// Transpose the first three columns of four models into structure of arrays form
+				__m128 c[3][4];
+				for (int k = 0; k < 3; k++) {
+					c[k][0] = _mm_loadu_ps(&transforms[i + 0].model[k].x);
+					c[k][1] = _mm_loadu_ps(&transforms[i + 1].model[k].x);
+					c[k][2] = _mm_loadu_ps(&transforms[i + 2].model[k].x);
+					c[k][3] = _mm_loadu_ps(&transforms[i + 3].model[k].x);
+					_MM_TRANSPOSE4_PS(c[k][0], c[k][1], c[k][2], c[k][3]);
+				}
+
+				// Columns of the cofactor matrix are the cross products of the other two columns
+				__m128 n[3][3];
+				for (int k = 0; k < 3; k++) {
+					const __m128* a = c[(k + 1) % 3];
+					const __m128* b = c[(k + 2) % 3];
+					n[k][0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+					n[k][1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+					n[k][2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+				}
+
+				__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0][0], n[0][0]), _mm_mul_ps(c[0][1], n[0][1])), _mm_mul_ps(c[0][2], n[0][2]));
+				__m128 invDet = _mm_div_ps(_mm_set1_ps(1.f), det);
+
+				for (int k = 0; k < 3; k++) {
+					__m128 x = _mm_mul_ps(n[k][0], invDet), y = _mm_mul_ps(n[k][1], invDet), z = _mm_mul_ps(n[k][2], invDet), w = zero;
+					_MM_TRANSPOSE4_PS(x, y, z, w);
+					_mm_storeu_ps(&transforms[i + 0].normal[k].x, x);
+					_mm_storeu_ps(&transforms[i + 1].normal[k].x, y);
+					_mm_storeu_ps(&transforms[i + 2].normal[k].x, z);
+					_mm_storeu_ps(&transforms[i + 3].normal[k].x, w);
+				}
+			}
+
+			// Remaining transforms which do not fill a whole register
+			if (i < count) writeNormalMatricesScalar(transforms + i, count - i);
+		}
+	}
+}
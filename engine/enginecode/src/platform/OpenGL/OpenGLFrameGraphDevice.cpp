@@ -0,0 +1,142 @@
+/** \file OpenGLFrameGraphDevice.cpp */
+#include "engine_pch.h"
+#include "platform/OpenGL/OpenGLFrameGraphDevice.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
+#include "rendering/RendererCommon.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace Engine {
+	OpenGLFrameGraphDevice::~OpenGLFrameGraphDevice(){
+		m_framebuffers.clear();
+		while (!m_textures.empty()) deleteTexture(m_textures.back().id);
+		for (auto& timer : m_timers) {
+			if (timer.second.queries[0]) glDeleteQueries(queryLatency, timer.second.queries);
+		}
+	}
+	void OpenGLFrameGraphDevice::deleteTexture(uint32_t id){
+		for (size_t i = 0; i < m_framebuffers.size();) {
+			CachedFramebuffer& cached = m_framebuffers[i];
+			bool uses = cached.depth == id;
+			for (uint32_t colour : cached.colour) uses |= colour == id;
+			if (uses) {
+				m_framebuffers[i] = m_framebuffers.back();
+				m_framebuffers.pop_back();
+			}
+			else i++;
+		}
+		for (size_t i = 0; i < m_textures.size(); i++) {
+			if (m_textures[i].id != id) continue;
+			m_textures[i] = m_textures.back();
+			m_textures.pop_back();
+			break;
+		}
+		RendererCommon::s_textureUnitManager.evict(id);
+		OpenGLStateCache::onTextureDeleted(id);
+		glDeleteTextures(1, &id);
+	}
+	uint32_t OpenGLFrameGraphDevice::acquireTexture(const FrameGraphTextureDesc& desc){
+		for (PooledTexture& texture : m_textures) {
+			if (texture.inUse || !(texture.desc == desc)) continue;
+			texture.inUse = true;
+			texture.idleFrames = 0;
+			return texture.id;
+		}
+
+		GLenum internalFormat = GL_RGBA8;
+		if (desc.format == FrameGraphFormat::RGBA16F) internalFormat = GL_RGBA16F;
+		else if (desc.format == FrameGraphFormat::Depth24Stencil8) internalFormat = GL_DEPTH24_STENCIL8;
+
+		uint32_t id;
+		glCreateTextures(GL_TEXTURE_2D, 1, &id);
+		glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureStorage2D(id, 1, internalFormat, desc.width, desc.height);
+
+		m_textures.push_back({ desc, id, true, 0 });
+		return id;
+	}
+	void OpenGLFrameGraphDevice::releaseTextures(){
+		for (size_t i = 0; i < m_textures.size();) {
+			PooledTexture& texture = m_textures[i];
+			if (!texture.inUse && ++texture.idleFrames > maxIdleFrames) {
+				deleteTexture(texture.id);
+				continue;
+			}
+			texture.inUse = false;
+			i++;
+		}
+	}
+	void OpenGLFrameGraphDevice::bindRenderTargets(const uint32_t* colour, uint32_t colourCount, uint32_t depth, const FrameGraphTextureDesc& desc){
+		if ((colourCount == 0 || colour[0] == 0) && depth == 0) OpenGLStateCache::bindFramebuffer(0);
+		else {
+			CachedFramebuffer* found = nullptr;
+			for (CachedFramebuffer& cached : m_framebuffers) {
+				if (cached.depth == depth && cached.colour.size() == colourCount && std::equal(cached.colour.begin(), cached.colour.end(), colour)) {
+					found = &cached;
+					break;
+				}
+			}
+			if (!found) {
+				bool stencil = false;
+				for (const PooledTexture& texture : m_textures) {
+					if (texture.id == depth) stencil = texture.desc.format == FrameGraphFormat::Depth24Stencil8;
+				}
+				m_framebuffers.push_back({ std::vector<uint32_t>(colour, colour + colourCount), depth, std::make_shared<OpenGLFramebuffer>(colour, colourCount, depth, stencil) });
+				found = &m_framebuffers.back();
+			}
+			found->framebuffer->bind();
+		}
+		glViewport(0, 0, desc.width, desc.height);
+	}
+	void OpenGLFrameGraphDevice::barrier(uint32_t barriers){
+		GLbitfield bits = 0;
+		if (barriers & FrameGraphBarrier::Storage) bits |= GL_SHADER_STORAGE_BARRIER_BIT;
+		if (barriers & FrameGraphBarrier::Command) bits |= GL_COMMAND_BARRIER_BIT;
+		if (barriers & FrameGraphBarrier::TextureFetch) bits |= GL_TEXTURE_FETCH_BARRIER_BIT;
+		if (barriers & FrameGraphBarrier::Framebuffer) bits |= GL_FRAMEBUFFER_BARRIER_BIT;
+		if (bits) glMemoryBarrier(bits);
+	}
+	void OpenGLFrameGraphDevice::poll(PassTimer& timer){
+		// Oldest first, so the newest finished result is the one kept
+		for (uint32_t i = 0; i < queryLatency; i++) {
+			uint32_t slot = (timer.next + i) % queryLatency;
+			if (!timer.pending[slot]) continue;
+
+			GLint available = 0;
+			glGetQueryObjectiv(timer.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) continue;
+
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(timer.queries[slot], GL_QUERY_RESULT, &elapsed);
+			timer.latest = static_cast<float>(elapsed) * 1e-9f;
+			timer.pending[slot] = false;
+		}
+	}
+	void OpenGLFrameGraphDevice::beginTimer(const std::string& pass){
+		PassTimer& timer = m_timers[pass];
+		if (!timer.queries[0]) glCreateQueries(GL_TIME_ELAPSED, queryLatency, timer.queries);
+
+		// Skip the frame rather than wait when the GPU is further behind than the ring
+		poll(timer);
+		m_timing = !timer.pending[timer.next];
+		if (!m_timing) return;
+
+		glBeginQuery(GL_TIME_ELAPSED, timer.queries[timer.next]);
+		timer.pending[timer.next] = true;
+		timer.next = (timer.next + 1) % queryLatency;
+	}
+	void OpenGLFrameGraphDevice::endTimer(){
+		if (m_timing) glEndQuery(GL_TIME_ELAPSED);
+		m_timing = false;
+	}
+	float OpenGLFrameGraphDevice::getGPUTime(const std::string& pass){
+		auto it = m_timers.find(pass);
+		if (it == m_timers.end()) return -1.f;
+		poll(it->second);
+		return it->second.latest;
+	}
+}
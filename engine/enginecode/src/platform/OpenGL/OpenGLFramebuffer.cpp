@@ -0,0 +1,35 @@
+/** \file OpenGLFramebuffer.cpp */
+#include "engine_pch.h"
+#include "platform/OpenGL/OpenGLFramebuffer.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
+#include "systems/loggerSys.h"
+
+#include <glad/glad.h>
+
+namespace Engine {
+	OpenGLFramebuffer::OpenGLFramebuffer(const uint32_t* colour, uint32_t colourCount, uint32_t depth, bool stencil){
+		glCreateFramebuffers(1, &m_OpenGL_ID);
+
+		GLenum drawBuffers[8];
+		for (uint32_t i = 0; i < colourCount && i < 8; i++) {
+			glNamedFramebufferTexture(m_OpenGL_ID, GL_COLOR_ATTACHMENT0 + i, colour[i], 0);
+			drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+		}
+		if (colourCount > 0) glNamedFramebufferDrawBuffers(m_OpenGL_ID, colourCount < 8 ? colourCount : 8, drawBuffers);
+		else glNamedFramebufferDrawBuffer(m_OpenGL_ID, GL_NONE);
+
+		if (depth) glNamedFramebufferTexture(m_OpenGL_ID, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, depth, 0);
+
+		if (!isComplete()) LoggerSys::error("Framebuffer {0} is incomplete", m_OpenGL_ID);
+	}
+	OpenGLFramebuffer::~OpenGLFramebuffer(){
+		OpenGLStateCache::onFramebufferDeleted(m_OpenGL_ID);
+		glDeleteFramebuffers(1, &m_OpenGL_ID);
+	}
+	void OpenGLFramebuffer::bind(){
+		OpenGLStateCache::bindFramebuffer(m_OpenGL_ID);
+	}
+	bool OpenGLFramebuffer::isComplete() const{
+		return glCheckNamedFramebufferStatus(m_OpenGL_ID, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	}
+}
@@ -0,0 +1,118 @@
+/** \file OpenGLGeometryArena.cpp */
+#include "engine_pch.h"
+#include <glad/glad.h>
+#include "platform/OpenGL/OpenGLGeometryArena.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
+
+#include <numeric>
+
+namespace Engine {
+	OpenGLGeometryArena::OpenGLGeometryArena(uint32_t pageSize, uint32_t pageIndices, uint32_t maxDraws, uint32_t drawIDLocation) :
+		m_pageSize(pageSize), m_pageIndices(pageIndices), m_drawIDLocation(drawIDLocation), m_maxDraws(0)
+	{
+		glCreateBuffers(1, &m_drawIDBuffer);
+		reserveDraws(maxDraws);
+	}
+	OpenGLGeometryArena::~OpenGLGeometryArena()
+	{
+		for (auto& bucket : m_buckets) {
+			for (auto& page : bucket.pages) {
+				OpenGLStateCache::onBufferDeleted(page.vertexBuffer);
+				OpenGLStateCache::onBufferDeleted(page.indexBuffer);
+				glDeleteBuffers(1, &page.vertexBuffer);
+				glDeleteBuffers(1, &page.indexBuffer);
+			}
+		}
+		OpenGLStateCache::onBufferDeleted(m_drawIDBuffer);
+		glDeleteBuffers(1, &m_drawIDBuffer);
+	}
+	void OpenGLGeometryArena::reserveDraws(uint32_t count)
+	{
+		if (count <= m_maxDraws) return;
+		m_maxDraws = std::max(count, m_maxDraws * 2);
+
+		std::vector<uint32_t> drawIDs(m_maxDraws);
+		std::iota(drawIDs.begin(), drawIDs.end(), 0);
+
+		// Mutable storage, so the new store replaces the old one behind the same name and every vertex array reading it stays valid
+		glNamedBufferData(m_drawIDBuffer, m_maxDraws * sizeof(uint32_t), drawIDs.data(), GL_STATIC_DRAW);
+	}
+	uint32_t OpenGLGeometryArena::findBucket(const VertexBufferLayout& layout)
+	{
+		for (uint32_t i = 0; i < m_buckets.size(); i++) {
+			const VertexBufferLayout& other = m_buckets[i].layout;
+			if (other.getStride() != layout.getStride()) continue;
+
+			bool match = std::equal(layout.begin(), layout.end(), other.begin(), other.end(), [](const VertexBufferElement& a, const VertexBufferElement& b) {
+				return a.m_dataType == b.m_dataType && a.m_normalized == b.m_normalized && a.m_offset == b.m_offset;
+			});
+			if (match) return i;
+		}
+
+		Bucket bucket;
+		bucket.layout = layout;
+		bucket.VAO.reset(new OpenGLVertexArray);
+		bucket.VAO->setVertexFormat(layout);
+		bucket.VAO->addDrawIDBuffer(m_drawIDBuffer, m_drawIDLocation);
+		m_buckets.push_back(bucket);
+		return static_cast<uint32_t>(m_buckets.size() - 1);
+	}
+	void OpenGLGeometryArena::addPage(Bucket& bucket, uint32_t vertexCount, uint32_t indexCount)
+	{
+		uint32_t stride = bucket.layout.getStride();
+
+		Page page;
+		page.vertexCapacity = std::max(m_pageSize / stride, vertexCount);
+		page.indexCapacity = std::max(m_pageIndices, indexCount);
+
+		// Immutable stores, written once per mesh with glNamedBufferSubData
+		glCreateBuffers(1, &page.vertexBuffer);
+		glNamedBufferStorage(page.vertexBuffer, page.vertexCapacity * stride, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		glCreateBuffers(1, &page.indexBuffer);
+		glNamedBufferStorage(page.indexBuffer, page.indexCapacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+		bucket.pages.push_back(page);
+	}
+	ArenaMesh OpenGLGeometryArena::add(const VertexBufferLayout& layout, const void* vertices, uint32_t size, const uint32_t* indices, uint32_t indexCount)
+	{
+		ArenaMesh mesh;
+		mesh.bucket = findBucket(layout);
+		Bucket& bucket = m_buckets[mesh.bucket];
+
+		uint32_t stride = layout.getStride();
+		uint32_t vertexCount = size / stride;
+
+		// First page with room, otherwise a new one
+		uint32_t pageIndex = 0;
+		for (; pageIndex < bucket.pages.size(); pageIndex++) {
+			const Page& page = bucket.pages[pageIndex];
+			if (page.vertexCount + vertexCount <= page.vertexCapacity && page.indexCount + indexCount <= page.indexCapacity) break;
+		}
+		if (pageIndex == bucket.pages.size()) addPage(bucket, vertexCount, indexCount);
+
+		Page& page = bucket.pages[pageIndex];
+		mesh.page = pageIndex;
+		mesh.baseVertex = static_cast<int32_t>(page.vertexCount);
+		mesh.firstIndex = page.indexCount;
+		mesh.indexCount = indexCount;
+
+		auto position = layout.begin();
+		if (position != layout.end() && position->m_dataType == ShaderDataType::Float3) {
+			mesh.bounds = Culling::computeBounds(vertices, vertexCount, stride, position->m_offset);
+		}
+
+		glNamedBufferSubData(page.vertexBuffer, page.vertexCount * stride, size, vertices);
+		glNamedBufferSubData(page.indexBuffer, page.indexCount * sizeof(uint32_t), indexCount * sizeof(uint32_t), indices);
+
+		page.vertexCount += vertexCount;
+		page.indexCount += indexCount;
+
+		return mesh;
+	}
+	void OpenGLGeometryArena::bindPage(const ArenaMesh& mesh)
+	{
+		Bucket& bucket = m_buckets[mesh.bucket];
+		const Page& page = bucket.pages[mesh.page];
+		bucket.VAO->setBuffers(page.vertexBuffer, bucket.layout.getStride(), page.indexBuffer);
+	}
+}
@@ -2,14 +2,16 @@
 #include "engine_pch.h"
 #include <glad/glad.h>
 #include "platform/OpenGL/OpenGLIndexBuffer.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
 
 namespace Engine {
 	OpenGLIndexBuffer::OpenGLIndexBuffer(uint32_t* indices, uint32_t count) : m_count(count) {
+		// Indices never change so the storage is immutable, it is attached to a vertex array by OpenGLVertexArray::setIndexBuffer
 		glCreateBuffers(1, &m_OpenGL_ID);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_OpenGL_ID);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * count , indices, GL_STATIC_DRAW);
+		glNamedBufferStorage(m_OpenGL_ID, sizeof(uint32_t) * count, indices, 0);
 	}
 	OpenGLIndexBuffer::~OpenGLIndexBuffer(){
+		OpenGLStateCache::onBufferDeleted(m_OpenGL_ID);
 		glDeleteBuffers(1, &m_OpenGL_ID);
 	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "engine_pch.h"
 #include "platform/OpenGL/OpenGLShader.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
 #include "systems/loggerSys.h"
 #include "glad/glad.h"
 
@@ -9,6 +10,8 @@
 #include <string>
 #include <array>
 #include <fstream>
+#include <cstring>
+#include <algorithm>
 
 
 namespace Engine {
@@ -67,35 +70,181 @@ namespace Engine {
 		compileAndLink(src[Region::Vertex].c_str(), src[Region::Fragment].c_str());
 	}
 	OpenGLShader::~OpenGLShader(){
+		OpenGLStateCache::onProgramDeleted(m_OpenGL_ID);
 		glDeleteProgram(m_OpenGL_ID);
 	}
+	const ShaderUniformBlock* OpenGLShader::getUniformBlock(const char* name) const{
+		for (auto& block : m_uniformBlocks) if (block.name == name) return &block;
+		return nullptr;
+	}
+	int32_t OpenGLShader::getInputLocation(const char* name) const{
+		auto it = m_inputLocations.find(name);
+		if (it == m_inputLocations.end()) return -1;
+		return it->second;
+	}
+	int32_t OpenGLShader::findUniform(const char* name, ShaderDataType type) const{
+		auto it = m_uniformLookup.find(name);
+		if (it == m_uniformLookup.end()) return -1;
+#ifdef NG_DEBUG
+		const ShaderUniform& uniform = m_uniforms[it->second];
+		if (uniform.type != type) LoggerSys::error("Uniform {0} is not of the type it is uploaded as", uniform.name);
+#endif
+		return it->second;
+	}
+	bool OpenGLShader::updateCache(int32_t index, const void* data, uint32_t size){
+		ShaderUniform& uniform = m_uniforms[index];
+		if (size > uniform.cacheSize) {
+			// Uploaded as a larger type than reflected, nothing sensible to cache
+			uniform.cached = false;
+			return true;
+		}
+		unsigned char* cached = m_uniformCache.data() + uniform.cacheOffset;
+		if (uniform.cached && memcmp(cached, data, size) == 0) return false;
+		memcpy(cached, data, size);
+		uniform.cached = true;
+		return true;
+	}
+	void OpenGLShader::upload(UniformHandle<int32_t> handle, int32_t value){
+		if (!handle.isValid() || !updateCache(handle.index, &value, sizeof(value))) return;
+		glProgramUniform1i(m_OpenGL_ID, m_uniforms[handle.index].location, value);
+	}
+	void OpenGLShader::upload(UniformHandle<int32_t> handle, const int32_t* values, uint32_t count){
+		if (!handle.isValid()) return;
+		count = std::min(count, static_cast<uint32_t>(m_uniforms[handle.index].arraySize));
+		if (!updateCache(handle.index, values, count * sizeof(int32_t))) return;
+		glProgramUniform1iv(m_OpenGL_ID, m_uniforms[handle.index].location, count, values);
+	}
+	void OpenGLShader::upload(UniformHandle<float> handle, float value){
+		if (!handle.isValid() || !updateCache(handle.index, &value, sizeof(value))) return;
+		glProgramUniform1f(m_OpenGL_ID, m_uniforms[handle.index].location, value);
+	}
+	void OpenGLShader::upload(UniformHandle<glm::vec2> handle, const glm::vec2& value){
+		if (!handle.isValid() || !updateCache(handle.index, &value, sizeof(value))) return;
+		glProgramUniform2f(m_OpenGL_ID, m_uniforms[handle.index].location, value.x, value.y);
+	}
+	void OpenGLShader::upload(UniformHandle<glm::vec3> handle, const glm::vec3& value){
+		if (!handle.isValid() || !updateCache(handle.index, &value, sizeof(value))) return;
+		glProgramUniform3f(m_OpenGL_ID, m_uniforms[handle.index].location, value.x, value.y, value.z);
+	}
+	void OpenGLShader::upload(UniformHandle<glm::vec4> handle, const glm::vec4& value){
+		if (!handle.isValid() || !updateCache(handle.index, &value, sizeof(value))) return;
+		glProgramUniform4f(m_OpenGL_ID, m_uniforms[handle.index].location, value.x, value.y, value.z, value.w);
+	}
+	void OpenGLShader::upload(UniformHandle<glm::mat3> handle, const glm::mat3& value){
+		if (!handle.isValid() || !updateCache(handle.index, &value, sizeof(value))) return;
+		glProgramUniformMatrix3fv(m_OpenGL_ID, m_uniforms[handle.index].location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+	void OpenGLShader::upload(UniformHandle<glm::mat4> handle, const glm::mat4& value){
+		if (!handle.isValid() || !updateCache(handle.index, &value, sizeof(value))) return;
+		glProgramUniformMatrix4fv(m_OpenGL_ID, m_uniforms[handle.index].location, 1, GL_FALSE, glm::value_ptr(value));
+	}
 	void OpenGLShader::uploadInt(const char* name, int value){
-		uint32_t uniformLocation = glGetUniformLocation(m_OpenGL_ID, name);
-		glUniform1i(uniformLocation, value);
+		upload(getUniform<int32_t>(name), value);
 	}
 	void OpenGLShader::uploadIntArray(const char* name, int32_t* values, uint32_t count){
-		uint32_t uniformLocation = glGetUniformLocation(m_OpenGL_ID, name);
-		glUniform1iv(uniformLocation, count, values);
+		upload(getUniform<int32_t>(name), values, count);
 	}
 	void OpenGLShader::uploadFloat(const char* name, float value){
-		uint32_t uniformLocation = glGetUniformLocation(m_OpenGL_ID, name);
-		glUniform1f(uniformLocation, value);
+		upload(getUniform<float>(name), value);
 	}
 	void OpenGLShader::uploadFloat2(const char* name, const glm::vec2& value){
-		uint32_t uniformLocation = glGetUniformLocation(m_OpenGL_ID, name);
-		glUniform2f(uniformLocation, value.x, value.y);
+		upload(getUniform<glm::vec2>(name), value);
 	}
 	void OpenGLShader::uploadFloat3(const char* name, const glm::vec3& value){
-		uint32_t uniformLocation = glGetUniformLocation(m_OpenGL_ID, name);
-		glUniform3f(uniformLocation, value.x, value.y, value.z);
+		upload(getUniform<glm::vec3>(name), value);
 	}
 	void OpenGLShader::uploadFloat4(const char* name, const glm::vec4& value){
-		uint32_t uniformLocation = glGetUniformLocation(m_OpenGL_ID, name);
-		glUniform4f(uniformLocation, value.x, value.y, value.z, value.w);
+		upload(getUniform<glm::vec4>(name), value);
 	}
 	void OpenGLShader::uploadMat4(const char* name, const glm::mat4& value){
-		uint32_t uniformLocation = glGetUniformLocation(m_OpenGL_ID, name);
-		glUniformMatrix4fv(uniformLocation, 1, GL_FALSE, glm::value_ptr(value));
+		upload(getUniform<glm::mat4>(name), value);
+	}
+	void OpenGLShader::reflect() {
+		m_uniforms.clear();
+		m_uniformLookup.clear();
+		m_uniformBlocks.clear();
+		m_inputLocations.clear();
+
+		// Default block uniforms, members of uniform blocks are left to the uniform buffers
+		GLint count = 0;
+		glGetProgramInterfaceiv(m_OpenGL_ID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+
+		const GLenum uniformProps[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+		uint32_t cacheSize = 0;
+		for (GLint i = 0; i < count; i++) {
+			GLint values[5];
+			glGetProgramResourceiv(m_OpenGL_ID, GL_UNIFORM, i, 5, uniformProps, 5, nullptr, values);
+			if (values[4] != -1) continue;
+
+			std::string name(values[0], '\0');
+			glGetProgramResourceName(m_OpenGL_ID, GL_UNIFORM, i, values[0], nullptr, &name[0]);
+			name.resize(values[0] - 1);
+			size_t bracket = name.find('[');
+			if (bracket != std::string::npos) name.resize(bracket);
+
+			ShaderDataType type;
+			switch (values[1]) {
+			case GL_INT:
+			case GL_BOOL:
+			case GL_SAMPLER_2D:
+			case GL_SAMPLER_2D_ARRAY:
+			case GL_SAMPLER_3D:
+			case GL_SAMPLER_CUBE:
+			case GL_INT_SAMPLER_2D:
+			case GL_UNSIGNED_INT_SAMPLER_2D: type = ShaderDataType::Int; break;
+			case GL_FLOAT: type = ShaderDataType::Float; break;
+			case GL_FLOAT_VEC2: type = ShaderDataType::Float2; break;
+			case GL_FLOAT_VEC3: type = ShaderDataType::Float3; break;
+			case GL_FLOAT_VEC4: type = ShaderDataType::Float4; break;
+			case GL_FLOAT_MAT3: type = ShaderDataType::Mat3; break;
+			case GL_FLOAT_MAT4: type = ShaderDataType::Mat4; break;
+			default: type = ShaderDataType::None; break;
+			}
+
+			ShaderUniform uniform;
+			uniform.name = name;
+			uniform.type = type;
+			uniform.location = values[2];
+			uniform.arraySize = values[3];
+			uniform.cacheOffset = cacheSize;
+			uniform.cacheSize = STD::size(type) * values[3];
+			cacheSize += uniform.cacheSize;
+
+			m_uniformLookup[name] = static_cast<int32_t>(m_uniforms.size());
+			m_uniforms.push_back(uniform);
+		}
+		m_uniformCache.assign(cacheSize, 0);
+
+		glGetProgramInterfaceiv(m_OpenGL_ID, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &count);
+
+		const GLenum blockProps[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+		for (GLint i = 0; i < count; i++) {
+			GLint values[3];
+			glGetProgramResourceiv(m_OpenGL_ID, GL_UNIFORM_BLOCK, i, 3, blockProps, 3, nullptr, values);
+
+			ShaderUniformBlock block;
+			block.name.resize(values[0]);
+			glGetProgramResourceName(m_OpenGL_ID, GL_UNIFORM_BLOCK, i, values[0], nullptr, &block.name[0]);
+			block.name.resize(values[0] - 1);
+			block.index = static_cast<uint32_t>(i);
+			block.binding = values[1];
+			block.dataSize = values[2];
+			m_uniformBlocks.push_back(block);
+		}
+
+		glGetProgramInterfaceiv(m_OpenGL_ID, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &count);
+
+		const GLenum inputProps[] = { GL_NAME_LENGTH, GL_LOCATION };
+		for (GLint i = 0; i < count; i++) {
+			GLint values[2];
+			glGetProgramResourceiv(m_OpenGL_ID, GL_PROGRAM_INPUT, i, 2, inputProps, 2, nullptr, values);
+			if (values[1] == -1) continue; // Built in inputs such as gl_VertexID
+
+			std::string name(values[0], '\0');
+			glGetProgramResourceName(m_OpenGL_ID, GL_PROGRAM_INPUT, i, values[0], nullptr, &name[0]);
+			name.resize(values[0] - 1);
+			m_inputLocations[name] = values[1];
+		}
 	}
 	void OpenGLShader::compileAndLink(const char* vertexShaderSrc, const char* fragmentShaderSrc) {
 		GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -166,5 +315,7 @@ namespace Engine {
 
 		glDetachShader(m_OpenGL_ID, vertexShader);
 		glDetachShader(m_OpenGL_ID, fragmentShader);
+
+		reflect();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+/** \file OpenGLStateCache.cpp */
+#include "engine_pch.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
+
+#include <glad/glad.h>
+#include <cstring>
+
+namespace Engine {
+	OpenGLStateCache::State OpenGLStateCache::s_state = [] {
+		State state;
+		memset(&state, 0xFF, sizeof(State)); // Every field unknown
+		return state;
+	}();
+	OpenGLStateStats OpenGLStateCache::s_frameStats;
+	OpenGLStateStats OpenGLStateCache::s_lastFrameStats;
+
+	void OpenGLStateCache::invalidate(){
+		memset(&s_state, 0xFF, sizeof(State));
+	}
+	void OpenGLStateCache::nextFrame(){
+		s_lastFrameStats = s_frameStats;
+		s_frameStats = OpenGLStateStats();
+	}
+	bool OpenGLStateCache::change(uint32_t& cached, uint32_t value){
+		if (cached == value) {
+			s_frameStats.elided++;
+			return false;
+		}
+		cached = value;
+		s_frameStats.issued++;
+		return true;
+	}
+	int32_t OpenGLStateCache::targetIndex(uint32_t target){
+		switch (target) {
+		case GL_ARRAY_BUFFER: return 0;
+		case GL_UNIFORM_BUFFER: return 1;
+		case GL_SHADER_STORAGE_BUFFER: return 2;
+		case GL_DRAW_INDIRECT_BUFFER: return 3;
+		default: return -1;
+		}
+	}
+	int32_t OpenGLStateCache::capabilityIndex(uint32_t capability){
+		switch (capability) {
+		case GL_BLEND: return 0;
+		case GL_DEPTH_TEST: return 1;
+		case GL_CULL_FACE: return 2;
+		default: return -1;
+		}
+	}
+	bool OpenGLStateCache::bindIndexed(IndexedBinding& cached, uint32_t buffer, uint32_t offset, uint32_t size){
+		if (cached.buffer == buffer && cached.offset == offset && cached.size == size) {
+			s_frameStats.elided++;
+			return false;
+		}
+		cached = { buffer, offset, size };
+		s_frameStats.issued++;
+		return true;
+	}
+	void OpenGLStateCache::useProgram(uint32_t program){
+		if (change(s_state.program, program)) glUseProgram(program);
+	}
+	void OpenGLStateCache::bindVertexArray(uint32_t vertexArray){
+		if (change(s_state.vertexArray, vertexArray)) glBindVertexArray(vertexArray);
+	}
+	void OpenGLStateCache::bindFramebuffer(uint32_t framebuffer){
+		if (change(s_state.framebuffer, framebuffer)) glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+	void OpenGLStateCache::bindBuffer(uint32_t target, uint32_t buffer){
+		int32_t index = targetIndex(target);
+		if (index < 0) {
+			s_frameStats.issued++;
+			glBindBuffer(target, buffer);
+			return;
+		}
+		if (change(s_state.buffers[index], buffer)) glBindBuffer(target, buffer);
+	}
+	void OpenGLStateCache::bindBufferBase(uint32_t target, uint32_t index, uint32_t buffer){
+		// Size 0 stands for the whole buffer, which stays correct when the store is reallocated
+		bindBufferRange(target, index, buffer, 0, 0);
+	}
+	void OpenGLStateCache::bindBufferRange(uint32_t target, uint32_t index, uint32_t buffer, uint32_t offset, uint32_t size){
+		IndexedBinding* bindings = target == GL_UNIFORM_BUFFER ? s_state.uniformBuffers : (target == GL_SHADER_STORAGE_BUFFER ? s_state.storageBuffers : nullptr);
+		bool tracked = bindings && index < indexedBindings;
+		if (tracked && !bindIndexed(bindings[index], buffer, offset, size)) return;
+		if (!tracked) s_frameStats.issued++;
+
+		if (size == 0) glBindBufferBase(target, index, buffer);
+		else glBindBufferRange(target, index, buffer, offset, size);
+
+		// Indexed binds also bind the generic target
+		int32_t generic = targetIndex(target);
+		if (generic >= 0) s_state.buffers[generic] = buffer;
+	}
+	void OpenGLStateCache::bindTexture(uint32_t unit, uint32_t texture){
+		if (unit >= textureUnits) {
+			s_frameStats.issued++;
+			glBindTextureUnit(unit, texture);
+			return;
+		}
+		if (change(s_state.textures[unit], texture)) glBindTextureUnit(unit, texture);
+	}
+	void OpenGLStateCache::setEnabled(uint32_t capability, bool enabled){
+		int32_t index = capabilityIndex(capability);
+		if (index >= 0 && !change(s_state.enabled[index], enabled ? 1 : 0)) return;
+		if (index < 0) s_frameStats.issued++;
+
+		if (enabled) glEnable(capability);
+		else glDisable(capability);
+	}
+	void OpenGLStateCache::setBlendFunc(uint32_t source, uint32_t destination){
+		if (s_state.blendSource == source && s_state.blendDestination == destination) {
+			s_frameStats.elided++;
+			return;
+		}
+		s_state.blendSource = source;
+		s_state.blendDestination = destination;
+		s_frameStats.issued++;
+		glBlendFunc(source, destination);
+	}
+	void OpenGLStateCache::setDepthMask(bool write){
+		if (change(s_state.depthMask, write ? 1 : 0)) glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+	void OpenGLStateCache::onProgramDeleted(uint32_t program){
+		if (s_state.program == program) s_state.program = unknown;
+	}
+	void OpenGLStateCache::onVertexArrayDeleted(uint32_t vertexArray){
+		if (s_state.vertexArray == vertexArray) s_state.vertexArray = 0; // GL reverts to no vertex array
+	}
+	void OpenGLStateCache::onFramebufferDeleted(uint32_t framebuffer){
+		if (s_state.framebuffer == framebuffer) s_state.framebuffer = 0; // GL reverts to the default framebuffer
+	}
+	void OpenGLStateCache::onBufferDeleted(uint32_t buffer){
+		// GL unbinds a deleted buffer from every binding in the context
+		for (uint32_t& bound : s_state.buffers) if (bound == buffer) bound = 0;
+		for (IndexedBinding& binding : s_state.uniformBuffers) if (binding.buffer == buffer) binding = { 0, 0, 0 };
+		for (IndexedBinding& binding : s_state.storageBuffers) if (binding.buffer == buffer) binding = { 0, 0, 0 };
+	}
+	void OpenGLStateCache::onTextureDeleted(uint32_t texture){
+		for (uint32_t& bound : s_state.textures) if (bound == texture) bound = 0;
+	}
+}
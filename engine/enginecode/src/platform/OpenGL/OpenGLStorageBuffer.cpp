@@ -0,0 +1,34 @@
+/** \file OpenGLStorageBuffer.cpp */
+#include "engine_pch.h"
+#include "platform/OpenGL/OpenGLStorageBuffer.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
+
+#include <glad/glad.h>
+
+namespace Engine {
+	OpenGLStorageBuffer::OpenGLStorageBuffer(uint32_t capacity) : m_capacity(capacity) {
+		glCreateBuffers(1, &m_OpenGL_ID);
+		glNamedBufferData(m_OpenGL_ID, m_capacity, nullptr, GL_STREAM_DRAW);
+	}
+	OpenGLStorageBuffer::~OpenGLStorageBuffer(){
+		OpenGLStateCache::onBufferDeleted(m_OpenGL_ID);
+		glDeleteBuffers(1, &m_OpenGL_ID);
+	}
+	void OpenGLStorageBuffer::allocate(uint32_t size){
+		if (size > m_capacity) {
+			m_capacity = size > m_capacity * 2 ? size : m_capacity * 2;
+		}
+		// Orphan the old store so the driver does not wait on draws still reading it
+		glNamedBufferData(m_OpenGL_ID, m_capacity, nullptr, GL_STREAM_DRAW);
+	}
+	void OpenGLStorageBuffer::edit(const void* data, uint32_t size, uint32_t offset){
+		glNamedBufferSubData(m_OpenGL_ID, offset, size, data);
+	}
+	void OpenGLStorageBuffer::upload(const void* data, uint32_t size){
+		allocate(size);
+		edit(data, size, 0);
+	}
+	void OpenGLStorageBuffer::bind(uint32_t binding){
+		OpenGLStateCache::bindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, m_OpenGL_ID);
+	}
+}
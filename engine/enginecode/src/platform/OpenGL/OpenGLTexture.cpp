@@ -3,6 +3,8 @@
 #include "engine_pch.h"
 #include "stb_image.h"
 #include "platform/OpenGL/OpenGLTexture.h"
+#include "rendering/RendererCommon.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
 
 #include <glad/glad.h>
 
@@ -10,19 +12,22 @@
 #include "stb_image.h"
 
 namespace Engine {
-	OpenGLTexture::OpenGLTexture(const char* filepath, uint32_t slot){
+	OpenGLTexture::OpenGLTexture(const char* filepath, uint32_t slot, bool mipmaps){
 		int width, height, channels;
 
 		unsigned char* data = stbi_load(filepath, &width, &height, &channels, 0);
 
-		if (data) init(width, height, channels, data, slot); else LoggerSys::error("Cannot load file {0}", filepath);
+		if (data) init(width, height, channels, data, slot, mipmaps); else LoggerSys::error("Cannot load file {0}", filepath);
 
 		stbi_image_free(data);
 	}
-	OpenGLTexture::OpenGLTexture(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t slot){
-		init(width, height, channels, data, slot);
+	OpenGLTexture::OpenGLTexture(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t slot, bool mipmaps){
+		init(width, height, channels, data, slot, mipmaps);
 	}
 	OpenGLTexture::~OpenGLTexture(){
+		// GL may hand the ID to a new texture, which must not be taken as already bound
+		RendererCommon::s_textureUnitManager.evict(m_OpenGL_ID);
+		OpenGLStateCache::onTextureDeleted(m_OpenGL_ID);
 		glDeleteTextures(1, &m_OpenGL_ID);
 	}
 	void OpenGLTexture::edit(uint32_t xOffset, uint32_t yOffset, uint32_t width, uint32_t height, unsigned char* data){
@@ -34,37 +39,59 @@ namespace Engine {
 				glTextureSubImage2D(m_OpenGL_ID, 0, xOffset, yOffset ,width, height, GL_RED, GL_UNSIGNED_BYTE, data);
 				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 			}
+			else if (m_channels == 2) {
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+				glTextureSubImage2D(m_OpenGL_ID, 0, xOffset, yOffset, width, height, GL_RG, GL_UNSIGNED_BYTE, data);
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			}
+			if (m_levels > 1) glGenerateTextureMipmap(m_OpenGL_ID);
 		}
 	}
 
 	void OpenGLTexture::bindToSlot(uint32_t slot)
 	{
-		glActiveTexture(GL_TEXTURE0 + slot);
-		glBindTexture(GL_TEXTURE_2D, m_OpenGL_ID);
-		LoggerSys::info("Binding texture {0} to slot {1}", m_OpenGL_ID, slot);
+		OpenGLStateCache::bindTexture(slot, m_OpenGL_ID);
 	}
 
-	void OpenGLTexture::init(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t slot) {
-		glGenTextures(1, &m_OpenGL_ID);
-		glActiveTexture(GL_TEXTURE0 + slot);
-		glBindTexture(GL_TEXTURE_2D, m_OpenGL_ID);
-		RendererCommon::s_textureUnitManager.clear();
+	void OpenGLTexture::init(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t slot, bool mipmaps) {
+		// Immutable storage set up with DSA, so no texture unit is disturbed and slot is unused
+		glCreateTextures(GL_TEXTURE_2D, 1, &m_OpenGL_ID);
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		GLenum internalFormat, format;
+		if (channels == 3) { internalFormat = GL_RGB8; format = GL_RGB; }
+		else if (channels == 4) { internalFormat = GL_RGBA8; format = GL_RGBA; }
+		else if (channels == 1) { internalFormat = GL_R8; format = GL_RED; }
+		else if (channels == 2) { internalFormat = GL_RG8; format = GL_RG; }
+		else return;
+
+		glTextureParameteri(m_OpenGL_ID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_OpenGL_ID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(m_OpenGL_ID, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTextureParameteri(m_OpenGL_ID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-		if (channels == 3) glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		else if (channels == 4) glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		else if (channels == 1) {
-			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data);
-			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (channels == 1) {
+			// Single channel is an alpha mask, white in colour so shaders treat it like RGBA
+			GLint swizzle[4] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+			glTextureParameteriv(m_OpenGL_ID, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+		else if (channels == 2) {
+			// Two channels are luminance and alpha
+			GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+			glTextureParameteriv(m_OpenGL_ID, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+
+		// Levels below the base are never sampled without a mipmapped min filter
+		m_levels = 1;
+		if (mipmaps) while ((std::max(width, height) >> m_levels) > 0) m_levels++;
+		glTextureStorage2D(m_OpenGL_ID, m_levels, internalFormat, width, height);
+
+		if (data) {
+			if (channels < 3) glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTextureSubImage2D(m_OpenGL_ID, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+			if (channels < 3) glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			if (m_levels > 1) glGenerateTextureMipmap(m_OpenGL_ID);
 		}
-		else return;
-		glGenerateMipmap(GL_TEXTURE_2D);
 
 		m_width = width;
 		m_height = height;
@@ -1,6 +1,7 @@
 /** \file OpenGLUniformBuffer.cpp */
 #include "engine_pch.h"
 #include "platform/OpenGL/OpenGLUniformBuffer.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
 
 #include <glad/glad.h>
 
@@ -10,16 +11,16 @@ namespace Engine {
 		m_blockNumber = s_blockNumber;
 		s_blockNumber++;
 
-		glGenBuffers(1, &m_OpenGL_ID);
-		glBindBuffer(GL_UNIFORM_BUFFER, m_OpenGL_ID);
-		glBufferData(GL_UNIFORM_BUFFER, m_layout.getStride(), nullptr, GL_DYNAMIC_DRAW);
-		glBindBufferRange(GL_UNIFORM_BUFFER, m_blockNumber, m_OpenGL_ID, 0, m_layout.getStride());
+		glCreateBuffers(1, &m_OpenGL_ID);
+		glNamedBufferData(m_OpenGL_ID, m_layout.getStride(), nullptr, GL_DYNAMIC_DRAW);
+		OpenGLStateCache::bindBufferRange(GL_UNIFORM_BUFFER, m_blockNumber, m_OpenGL_ID, 0, m_layout.getStride());
 
 		for (auto& element : m_layout) {
 			m_uniformCache[element.m_name] = std::pair<uint32_t, uint32_t>(element.m_offset, element.m_size);
 		}
 	}
 	OpenGLUniformBuffer::~OpenGLUniformBuffer(){
+		OpenGLStateCache::onBufferDeleted(m_OpenGL_ID);
 		glDeleteBuffers(1, &m_OpenGL_ID);
 	}
 	void OpenGLUniformBuffer::attachShaderBlock(const std::shared_ptr<OpenGLShader>& shader, const char* blockname){
@@ -28,7 +29,6 @@ namespace Engine {
 	}
 	void OpenGLUniformBuffer::uploadData(const char* uniformName, void* data){
 		auto& pair = m_uniformCache[uniformName];
-		glBindBuffer(GL_UNIFORM_BUFFER, m_OpenGL_ID);
-		glBufferSubData(GL_UNIFORM_BUFFER, pair.first, pair.second, data);
+		glNamedBufferSubData(m_OpenGL_ID, pair.first, pair.second, data);
 	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "engine_pch.h"
 #include <glad/glad.h>
 #include "platform/OpenGL/OpenGLVertexArray.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
 
 namespace Engine {
 	namespace STD {
@@ -9,6 +10,10 @@ namespace Engine {
 			switch (type) {
 			case ShaderDataType::FlatByte: return GL_BYTE;
 			case ShaderDataType::Byte4   : return GL_UNSIGNED_BYTE;
+			case ShaderDataType::Short   : return GL_UNSIGNED_SHORT;
+			case ShaderDataType::Short2  : return GL_UNSIGNED_SHORT;
+			case ShaderDataType::Short3  : return GL_UNSIGNED_SHORT;
+			case ShaderDataType::Short4  : return GL_UNSIGNED_SHORT;
 			case ShaderDataType::FlatInt : return GL_INT;
 			case ShaderDataType::Int     : return GL_INT;
 			case ShaderDataType::Float   : return GL_FLOAT;
@@ -23,47 +28,69 @@ namespace Engine {
 	OpenGLVertexArray::OpenGLVertexArray()
 	{
 		glCreateVertexArrays(1, &m_OpenGL_ID);
-		glBindVertexArray(m_OpenGL_ID);
 	}
 	OpenGLVertexArray::~OpenGLVertexArray()
 	{
+		OpenGLStateCache::onVertexArrayDeleted(m_OpenGL_ID);
 		glDeleteVertexArrays(1, &m_OpenGL_ID);
 	}
-	void OpenGLVertexArray::addVertexBuffer(const std::shared_ptr<OpenGLVertexBuffer>& vertexBuffer)
+	void OpenGLVertexArray::addVertexBuffer(const std::shared_ptr<OpenGLVertexBuffer>& vertexBuffer, uint32_t divisor)
 	{
 		m_vertexBuffer.push_back(vertexBuffer);
+		if (!m_bounds.isBounded()) m_bounds = vertexBuffer->getBounds();
 
-		glBindVertexArray(m_OpenGL_ID);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer->getRenderID());
-
+		// Each vertex buffer gets its own buffer binding, so nothing has to be bound to set it up
 		const auto& layout = vertexBuffer->getLayout();
+		uint32_t binding = static_cast<uint32_t>(m_vertexBuffer.size() - 1);
+		glVertexArrayVertexBuffer(m_OpenGL_ID, binding, vertexBuffer->getRenderID(), 0, layout.getStride());
+		if (divisor) glVertexArrayBindingDivisor(m_OpenGL_ID, binding, divisor);
+
 		for (const auto& element : layout) {
-			uint32_t normalized = GL_FALSE;
-			if (element.m_normalized) { normalized = GL_TRUE; }
-			glEnableVertexAttribArray(m_attributeIndex);
+			glEnableVertexArrayAttrib(m_OpenGL_ID, m_attributeIndex);
 			if (element.m_dataType == ShaderDataType::FlatInt || element.m_dataType == ShaderDataType::FlatByte) {
-				glVertexAttribIPointer(
-					m_attributeIndex,
-					STD::componentCount(element.m_dataType),
-					STD::toGLType(element.m_dataType),
-					layout.getStride(),
-					(const void*)element.m_offset);
-				m_attributeIndex++;
+				glVertexArrayAttribIFormat(m_OpenGL_ID, m_attributeIndex, STD::componentCount(element.m_dataType), STD::toGLType(element.m_dataType), element.m_offset);
 			}
 			else {
-				glVertexAttribPointer(
-					m_attributeIndex,
-					STD::componentCount(element.m_dataType),
-					STD::toGLType(element.m_dataType),
-					normalized,
-					layout.getStride(),
-					(void*)element.m_offset);
-				m_attributeIndex++;
+				glVertexArrayAttribFormat(m_OpenGL_ID, m_attributeIndex, STD::componentCount(element.m_dataType), STD::toGLType(element.m_dataType), element.m_normalized ? GL_TRUE : GL_FALSE, element.m_offset);
 			}
+			glVertexArrayAttribBinding(m_OpenGL_ID, m_attributeIndex, binding);
+			m_attributeIndex++;
 		}
 	}
 	void OpenGLVertexArray::setIndexBuffer(const std::shared_ptr<OpenGLIndexBuffer>& indexBuffer)
 	{
 		m_indexBuffer = indexBuffer;
+		glVertexArrayElementBuffer(m_OpenGL_ID, indexBuffer->getRenderID());
+	}
+	void OpenGLVertexArray::setVertexFormat(const VertexBufferLayout& layout)
+	{
+		for (const auto& element : layout) {
+			glEnableVertexArrayAttrib(m_OpenGL_ID, m_attributeIndex);
+			if (element.m_dataType == ShaderDataType::FlatInt || element.m_dataType == ShaderDataType::FlatByte) {
+				glVertexArrayAttribIFormat(m_OpenGL_ID, m_attributeIndex, STD::componentCount(element.m_dataType), STD::toGLType(element.m_dataType), element.m_offset);
+			}
+			else {
+				glVertexArrayAttribFormat(m_OpenGL_ID, m_attributeIndex, STD::componentCount(element.m_dataType), STD::toGLType(element.m_dataType), element.m_normalized ? GL_TRUE : GL_FALSE, element.m_offset);
+			}
+			glVertexArrayAttribBinding(m_OpenGL_ID, m_attributeIndex, 0);
+			m_attributeIndex++;
+		}
+	}
+	void OpenGLVertexArray::setBuffers(uint32_t vertexBufferID, uint32_t stride, uint32_t indexBufferID)
+	{
+		glVertexArrayVertexBuffer(m_OpenGL_ID, 0, vertexBufferID, 0, stride);
+		glVertexArrayElementBuffer(m_OpenGL_ID, indexBufferID);
+	}
+	void OpenGLVertexArray::addDrawIDBuffer(uint32_t bufferID, uint32_t location)
+	{
+		// Last buffer binding, clear of the bindings used by addVertexBuffer and setVertexFormat
+		const uint32_t binding = 15;
+
+		glVertexArrayVertexBuffer(m_OpenGL_ID, binding, bufferID, 0, sizeof(uint32_t));
+		glVertexArrayBindingDivisor(m_OpenGL_ID, binding, 1);
+		glEnableVertexArrayAttrib(m_OpenGL_ID, location);
+		glVertexArrayAttribIFormat(m_OpenGL_ID, location, 1, GL_UNSIGNED_INT, 0);
+		glVertexArrayAttribBinding(m_OpenGL_ID, location, binding);
+		m_hasDrawIDs = true;
 	}
 }
\ No newline at end of file
@@ -3,20 +3,63 @@
 #include "engine_pch.h"
 #include <glad/glad.h>
 #include "platform/OpenGL/OpenGLVertexBuffer.h"
+#include "platform/OpenGL/OpenGLStateCache.h"
+
+#include <cstring>
 
 namespace Engine {
 
 	OpenGLVertexBuffer::OpenGLVertexBuffer(void* vertices, uint32_t size, VertexBufferLayout layout) : m_layout(layout) {
 		glCreateBuffers(1, &m_OpenGL_ID);
-		glBindBuffer(GL_ARRAY_BUFFER, m_OpenGL_ID);
-		glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_DYNAMIC_DRAW);
+		glNamedBufferData(m_OpenGL_ID, size, vertices, GL_DYNAMIC_DRAW);
+
+		auto position = m_layout.begin();
+		if (position != m_layout.end() && position->m_dataType == ShaderDataType::Float3) {
+			m_bounds = Culling::computeBounds(vertices, size / m_layout.getStride(), m_layout.getStride(), position->m_offset);
+		}
+	}
+	OpenGLVertexBuffer::OpenGLVertexBuffer(uint32_t regionSize, uint32_t regionCount, VertexBufferLayout layout) : m_layout(layout), m_regionSize(regionSize) {
+		// Immutable storage which stays mapped for the lifetime of the buffer, writes are visible to the GPU without a flush
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glCreateBuffers(1, &m_OpenGL_ID);
+		glNamedBufferStorage(m_OpenGL_ID, regionSize * regionCount, nullptr, flags);
+		m_mapped = static_cast<unsigned char*>(glMapNamedBufferRange(m_OpenGL_ID, 0, regionSize * regionCount, flags));
+
+		m_fences.resize(regionCount, nullptr);
 	}
 	OpenGLVertexBuffer::~OpenGLVertexBuffer(){
+		for (auto& fence : m_fences) if (fence) glDeleteSync(static_cast<GLsync>(fence));
+		if (m_mapped) glUnmapNamedBuffer(m_OpenGL_ID);
+		OpenGLStateCache::onBufferDeleted(m_OpenGL_ID);
 		glDeleteBuffers(1, &m_OpenGL_ID);
 	}
 	void OpenGLVertexBuffer::edit(void* vertices, uint32_t size, uint32_t offset)
 	{
-		glBindBuffer(GL_ARRAY_BUFFER, m_OpenGL_ID);
-		glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertices);
+		if (m_mapped) {
+			memcpy(m_mapped + m_regionIndex * m_regionSize + offset, vertices, size);
+			return;
+		}
+		glNamedBufferSubData(m_OpenGL_ID, offset, size, vertices);
+	}
+	void* OpenGLVertexBuffer::beginRegion()
+	{
+		void*& fence = m_fences[m_regionIndex];
+		if (fence) {
+			// Only stalls when the CPU is a whole ring ahead of the GPU
+			GLenum result = glClientWaitSync(static_cast<GLsync>(fence), 0, 0);
+			while (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+				result = glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+				if (result == GL_WAIT_FAILED) break;
+			}
+			glDeleteSync(static_cast<GLsync>(fence));
+			fence = nullptr;
+		}
+		return m_mapped + m_regionIndex * m_regionSize;
+	}
+	void OpenGLVertexBuffer::endRegion()
+	{
+		m_fences[m_regionIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_regionIndex = (m_regionIndex + 1) % m_fences.size();
 	}
-}
\ No newline at end of file
+}
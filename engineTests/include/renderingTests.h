@@ -0,0 +1,18 @@
+#pragma once
+#include <gtest/gtest.h>
+#include "rendering/Renderer2D.h"
+#include "rendering/quadBatch.h"
+#include "rendering/radixSort.h"
+#include "rendering/transformBatch.h"
+#include "rendering/culling.h"
+#include "rendering/bvh.h"
+#include "rendering/lodSet.h"
+#include "rendering/lightClusters.h"
+#include "rendering/occlusionCuller.h"
+#include "rendering/TextureUnitManager.h"
+#include "rendering/renderThread.h"
+#include "rendering/frameGraph.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <thread>
+#include <random>
+#include <algorithm>
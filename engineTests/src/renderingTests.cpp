@@ -0,0 +1,810 @@
+#include "renderingTests.h"
+
+// SIMD quad writer matches the scalar matrix path
+TEST(Rendering, QuadBatchMatchesScalar) {
+	const uint32_t count = 7; // One full SIMD group plus a scalar tail
+	Engine::QuadInstance quads[count];
+	uint32_t texUnits[count];
+	glm::vec4 uvRects[count];
+
+	for (uint32_t i = 0; i < count; i++) {
+		quads[i].translate = { 10.f * i, 300.f - 20.f * i };
+		quads[i].scale = { 5.f + i, 40.f - i };
+		quads[i].setRotation(0.7f * i);
+		quads[i].tint = { 0.1f * i, 0.5f, 1.f, 0.25f };
+		texUnits[i] = i;
+		uvRects[i] = { 0.f, 0.25f, 0.5f, 1.f };
+	}
+
+	Engine::Renderer2DVertex expected[count * 4];
+	Engine::Renderer2DVertex result[count * 4];
+
+	Engine::QuadBatch::writeVerticesScalar(quads, texUnits, uvRects, count, expected);
+	Engine::QuadBatch::writeVertices(quads, texUnits, uvRects, count, result);
+
+	for (uint32_t i = 0; i < count * 4; i++) {
+		EXPECT_NEAR(result[i].position.x, expected[i].position.x, 0.001f);
+		EXPECT_NEAR(result[i].position.y, expected[i].position.y, 0.001f);
+		EXPECT_FLOAT_EQ(result[i].position.z, expected[i].position.z);
+		EXPECT_FLOAT_EQ(result[i].position.w, expected[i].position.w);
+		EXPECT_EQ(result[i].uvCoords, expected[i].uvCoords);
+		EXPECT_EQ(result[i].texUnit, expected[i].texUnit);
+		EXPECT_EQ(result[i].tint, expected[i].tint);
+	}
+}
+
+// Instance records keep the same UV rect, unit and tint as the expanded vertices
+TEST(Rendering, QuadInstancesMatchVertices) {
+	const uint32_t count = 3;
+	Engine::QuadInstance quads[count];
+	uint32_t texUnits[count] = { 0, 5, 31 };
+	glm::vec4 uvRects[count] = { { 0.f, 0.f, 1.f, 1.f }, { 0.25f, 0.5f, 0.75f, 1.f }, { 0.1f, 0.2f, 0.3f, 0.4f } };
+
+	for (uint32_t i = 0; i < count; i++) {
+		quads[i].translate = { 3.f * i, -2.f * i };
+		quads[i].scale = { 8.f, 4.f };
+		quads[i].setRotation(0.5f * i);
+		quads[i].tint = { 1.f, 0.5f * i, 0.f, 1.f };
+	}
+
+	Engine::Renderer2DVertex vertices[count * 4];
+	Engine::Renderer2DInstance instances[count];
+
+	Engine::QuadBatch::writeVerticesScalar(quads, texUnits, uvRects, count, vertices);
+	Engine::QuadBatch::writeInstances(quads, texUnits, uvRects, count, instances);
+
+	EXPECT_EQ(sizeof(Engine::Renderer2DInstance), Engine::Renderer2DInstance::layout.getStride());
+	EXPECT_LT(sizeof(Engine::Renderer2DInstance) * 3, sizeof(Engine::Renderer2DVertex) * 4);
+
+	for (uint32_t i = 0; i < count; i++) {
+		EXPECT_EQ(instances[i].texUnit, vertices[i * 4].texUnit);
+		EXPECT_EQ(instances[i].tint, vertices[i * 4].tint);
+		EXPECT_NEAR(instances[i].uvRect[0] / 65535.f, vertices[i * 4 + 0].uvCoords.x, 0.0001f);
+		EXPECT_NEAR(instances[i].uvRect[1] / 65535.f, vertices[i * 4 + 0].uvCoords.y, 0.0001f);
+		EXPECT_NEAR(instances[i].uvRect[2] / 65535.f, vertices[i * 4 + 2].uvCoords.x, 0.0001f);
+		EXPECT_NEAR(instances[i].uvRect[3] / 65535.f, vertices[i * 4 + 2].uvCoords.y, 0.0001f);
+
+		// Centre of the expanded quad is the instance translation
+		glm::vec2 centre = (glm::vec2(vertices[i * 4].position.x, vertices[i * 4].position.y) + glm::vec2(vertices[i * 4 + 2].position.x, vertices[i * 4 + 2].position.y)) * 0.5f;
+		EXPECT_NEAR(centre.x, instances[i].translate.x, 0.001f);
+		EXPECT_NEAR(centre.y, instances[i].translate.y, 0.001f);
+	}
+}
+
+// Recorders on different threads fill their own staging buffers
+TEST(Rendering, RecordersRecordConcurrently) {
+	const uint32_t threadCount = 4;
+	const uint32_t quadsPerThread = 1000;
+	std::shared_ptr<Engine::Renderer2DRecorder> recorders[threadCount];
+	std::vector<std::thread> workers;
+
+	for (uint32_t t = 0; t < threadCount; t++) {
+		recorders[t] = std::make_shared<Engine::Renderer2DRecorder>();
+		workers.emplace_back([&recorders, t, quadsPerThread]() {
+			Engine::Renderer2DRecorder& recorder = *recorders[t];
+			recorder.setLayer(static_cast<int32_t>(t));
+			for (uint32_t i = 0; i < quadsPerThread; i++) {
+				Engine::Quad quad = Engine::Quad::createCentralHalfExtents({ float(i), float(t) }, { 1.f, 1.f });
+				recorder.submit(quad, glm::vec4(1.f), 90.f, true);
+			}
+			recorder.submit("Label", { 0.f, 0.f }, glm::vec4(1.f));
+		});
+	}
+	for (auto& worker : workers) worker.join();
+
+	for (uint32_t t = 0; t < threadCount; t++) {
+		EXPECT_EQ(recorders[t]->getCommandCount(), quadsPerThread + 1);
+		EXPECT_EQ(recorders[t]->getLayer(), static_cast<int32_t>(t));
+		recorders[t]->clear();
+		EXPECT_EQ(recorders[t]->getCommandCount(), 0u);
+	}
+}
+
+// Merging orders by layer, then recorder creation order, then submission order
+TEST(Rendering, RecordersMergeByLayerThenSubmission) {
+	std::vector<std::shared_ptr<Engine::Renderer2DRecorder>> recorders;
+	for (uint32_t r = 0; r < 3; r++) recorders.push_back(std::make_shared<Engine::Renderer2DRecorder>());
+
+	// Each quad's x is its recorder and y its submission index, layers interleave across the recorders
+	const int32_t layers[3][4] = { { 2, 0, 1, 0 }, { 0, 2, 0, 1 }, { 1, 1, 2, 0 } };
+	for (uint32_t r = 0; r < 3; r++) {
+		for (uint32_t i = 0; i < 4; i++) {
+			recorders[r]->setLayer(layers[r][i]);
+			recorders[r]->submit(Engine::Quad::createCentralHalfExtents({ float(r), float(i) }, { 1.f, 1.f }), glm::vec4(1.f));
+		}
+	}
+	recorders[1]->setLayer(1);
+	recorders[1]->submit("Hi", { 5.f, 5.f }, glm::vec4(1.f));
+
+	std::vector<Engine::Renderer2DRecorder::MergedCommand> merged;
+	Engine::Renderer2DRecorder::merge(recorders, merged);
+	ASSERT_EQ(merged.size(), 13u);
+
+	// Expected order built independently: layer, recorder, submission
+	std::vector<glm::vec2> expected;
+	for (int32_t layer = 0; layer <= 2; layer++) {
+		for (uint32_t r = 0; r < 3; r++) {
+			for (uint32_t i = 0; i < 4; i++) if (layers[r][i] == layer) expected.push_back({ float(r), float(i) });
+			if (layer == 1 && r == 1) expected.push_back({ 5.f, 5.f });
+		}
+	}
+	for (size_t i = 0; i < merged.size(); i++) {
+		EXPECT_EQ(merged[i].command->quad.translate, expected[i]) << "at " << i;
+		if (i > 0) EXPECT_LE(merged[i - 1].command->layer, merged[i].command->layer);
+	}
+
+	// The text keeps a pointer into its recorder's storage
+	for (const auto& merge : merged) {
+		if (merge.command->textLength) EXPECT_EQ(std::string(merge.text + merge.command->textOffset, merge.command->textLength), "Hi");
+	}
+}
+
+// A snapshot copies the commands into the packet, so the recorder can record the next frame straight away
+TEST(Rendering, RecorderSnapshotOutlivesRecording) {
+	Engine::Renderer2DRecorder recorder;
+	Engine::FramePacket packet;
+
+	recorder.setLayer(3);
+	recorder.submit(Engine::Quad::createCentralHalfExtents({ 1.f, 2.f }, { 1.f, 1.f }), glm::vec4(1.f));
+	recorder.submit("Frame", { 4.f, 5.f }, glm::vec4(1.f));
+	Engine::Renderer2DRecorder::Snapshot snapshot = recorder.snapshot(packet);
+	EXPECT_EQ(recorder.getCommandCount(), 0u);
+
+	recorder.submit(Engine::Quad::createCentralHalfExtents({ 9.f, 9.f }, { 1.f, 1.f }), glm::vec4(1.f));
+	recorder.submit("Next", { 9.f, 9.f }, glm::vec4(1.f));
+
+	ASSERT_EQ(snapshot.count, 2u);
+	EXPECT_EQ(snapshot.commands[0].quad.translate, glm::vec2(1.f, 2.f));
+	EXPECT_EQ(snapshot.commands[0].layer, 3);
+	EXPECT_EQ(snapshot.commands[1].quad.translate, glm::vec2(4.f, 5.f));
+	EXPECT_EQ(std::string(snapshot.text + snapshot.commands[1].textOffset, snapshot.commands[1].textLength), "Frame");
+}
+
+// Radix sort orders by key and keeps equal keys in their original order
+TEST(Rendering, RadixSortIsStable) {
+	const uint32_t count = 5000;
+	std::vector<Engine::SortEntry> entries(count), scratch(count);
+	std::mt19937_64 rng(7);
+
+	for (uint32_t i = 0; i < count; i++) {
+		// Few distinct keys in the high bytes so plenty of ties and skipped passes
+		entries[i].key = ((rng() % 40) << 46) | (rng() % 3);
+		entries[i].index = i;
+	}
+
+	std::vector<Engine::SortEntry> expected = entries;
+	std::stable_sort(expected.begin(), expected.end(), [](const Engine::SortEntry& a, const Engine::SortEntry& b) { return a.key < b.key; });
+
+	Engine::radixSort(entries.data(), scratch.data(), count);
+
+	for (uint32_t i = 0; i < count; i++) {
+		EXPECT_EQ(entries[i].key, expected[i].key);
+		EXPECT_EQ(entries[i].index, expected[i].index);
+	}
+}
+
+// Deferred 2D keys order by layer, strict segment, blend class, texture, then submission
+TEST(Rendering, DeferredSortKeysGroupTexturesAndKeepStrictOrder) {
+	using Engine::QuadBatch::sortKey;
+
+	// Layer beats everything, opaque draws before translucent, then texture, then submission
+	EXPECT_LT(sortKey(-1, 5, true, false, 9, 50), sortKey(0, 0, false, false, 1, 0));
+	EXPECT_LT(sortKey(0, 0, false, false, 9, 50), sortKey(0, 0, true, false, 1, 0));
+	EXPECT_LT(sortKey(0, 0, true, false, 1, 50), sortKey(0, 0, true, false, 2, 0));
+	EXPECT_LT(sortKey(0, 0, true, false, 2, 3), sortKey(0, 0, true, false, 2, 4));
+
+	// Turning strict order on part way through a layer keeps it after everything submitted before, translucent or not,
+	// and strict quads keep submission order whatever their texture or blending
+	EXPECT_LT(sortKey(0, 0, true, false, 9, 0), sortKey(0, 1, false, true, 1, 1));
+	EXPECT_LT(sortKey(0, 1, true, true, 9, 1), sortKey(0, 1, false, true, 1, 2));
+	EXPECT_LT(sortKey(0, 1, false, true, 1, 2), sortKey(0, 2, false, false, 1, 3));
+
+	// 40 textures alternating in one layer need one unit flush once sorted, and a flush for nearly every 32 quads unsorted
+	const uint32_t textureCount = 40, quadCount = 400;
+	std::vector<Engine::SortEntry> entries(quadCount), scratch(quadCount);
+	for (uint32_t i = 0; i < quadCount; i++) entries[i] = { sortKey(0, 0, false, false, 1 + (i * 7) % textureCount, i), i };
+
+	auto countFlushes = [&](const std::vector<Engine::SortEntry>& order) {
+		Engine::TextureUnitManager units(32);
+		uint32_t flushes = 0, unit;
+		for (const Engine::SortEntry& entry : order) {
+			uint32_t texture = 1 + (entry.index * 7) % textureCount;
+			units.getUnit(texture, unit);
+			if (unit == static_cast<uint32_t>(-1)) {
+				flushes++;
+				units.nextBatch();
+				units.getUnit(texture, unit);
+			}
+		}
+		return flushes;
+	};
+	uint32_t unsortedFlushes = countFlushes(entries);
+
+	Engine::radixSort(entries.data(), scratch.data(), quadCount);
+	EXPECT_EQ(countFlushes(entries), 1u);
+	EXPECT_GT(unsortedFlushes, 5u);
+
+	// Textures form one run each, in submission order inside the run
+	for (uint32_t i = 1; i < quadCount; i++) {
+		uint32_t previous = (entries[i - 1].index * 7) % textureCount, current = (entries[i].index * 7) % textureCount;
+		EXPECT_LE(previous, current);
+		if (previous == current) EXPECT_LT(entries[i - 1].index, entries[i].index);
+	}
+}
+
+// UTF-8 decoding for the glyph cache, invalid sequences become U+FFFD
+TEST(Rendering, GlyphCacheDecodesUTF8) {
+	const char text[] = "A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\xC0\xAF\xE2\x82";
+	const char* walker = text;
+	const char* end = text + sizeof(text) - 1;
+
+	EXPECT_EQ(Engine::GlyphCache::decodeUTF8(walker, end), 0x41u); // A
+	EXPECT_EQ(Engine::GlyphCache::decodeUTF8(walker, end), 0xE9u); // e acute
+	EXPECT_EQ(Engine::GlyphCache::decodeUTF8(walker, end), 0x20ACu); // Euro sign
+	EXPECT_EQ(Engine::GlyphCache::decodeUTF8(walker, end), 0x1F600u); // Emoji
+	EXPECT_EQ(Engine::GlyphCache::decodeUTF8(walker, end), 0xFFFDu); // Overlong slash
+	EXPECT_EQ(Engine::GlyphCache::decodeUTF8(walker, end), 0xFFFDu); // Truncated sequence
+	EXPECT_EQ(walker, end);
+}
+
+// Distance field of a filled square is high inside, low outside and crosses the middle on the edge
+TEST(Rendering, GlyphCacheGeneratesSDF) {
+	const uint32_t size = 16, spread = 4;
+	std::vector<unsigned char> coverage(size * size, 0);
+	for (uint32_t y = 4; y < 12; y++)
+		for (uint32_t x = 4; x < 12; x++) coverage[y * size + x] = 255;
+
+	std::vector<unsigned char> sdf;
+	Engine::GlyphCache::generateSDF(coverage.data(), size, size, spread, sdf);
+
+	const uint32_t padded = size + spread * 2;
+	ASSERT_EQ(sdf.size(), padded * padded);
+
+	auto at = [&](uint32_t x, uint32_t y) { return sdf[(y + spread) * padded + x + spread]; };
+	EXPECT_EQ(at(8, 8), 255); // Four pixels from the edge, saturated
+	EXPECT_EQ(sdf[0], 0); // Corner of the padding, far outside
+	EXPECT_GT(at(4, 8), 128); // Inside edge pixel
+	EXPECT_LT(at(3, 8), 128); // Outside edge pixel
+	EXPECT_GT(at(5, 8), at(4, 8)); // Increases inwards
+	EXPECT_LT(at(2, 8), at(3, 8)); // Decreases outwards
+}
+
+// SIMD normal matrices match the inverse transpose of the model's upper 3x3
+TEST(Rendering, TransformBatchMatchesInverseTranspose) {
+	const uint32_t count = 6; // One full SIMD group plus a scalar tail
+	Engine::ObjectTransform transforms[count];
+
+	for (uint32_t i = 0; i < count; i++) {
+		glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3(1.f * i, -2.f, 3.f));
+		model = glm::rotate(model, 0.4f * (i + 1), glm::normalize(glm::vec3(1.f, 0.5f * i, -1.f)));
+		model = glm::scale(model, glm::vec3(1.f + i, 2.f, i % 2 ? -0.5f : 0.5f)); // Non uniform, some mirrored
+		transforms[i].model = model;
+	}
+
+	Engine::TransformBatch::writeNormalMatrices(transforms, count);
+
+	for (uint32_t i = 0; i < count; i++) {
+		glm::mat3 expected = glm::transpose(glm::inverse(glm::mat3(transforms[i].model)));
+		for (int c = 0; c < 3; c++) {
+			EXPECT_NEAR(transforms[i].normal[c].x, expected[c].x, 0.0001f);
+			EXPECT_NEAR(transforms[i].normal[c].y, expected[c].y, 0.0001f);
+			EXPECT_NEAR(transforms[i].normal[c].z, expected[c].z, 0.0001f);
+			EXPECT_FLOAT_EQ(transforms[i].normal[c].w, 0.f);
+		}
+	}
+}
+
+// SIMD sphere culling agrees with the scalar test and with obvious cases
+TEST(Rendering, FrustumCullingMatchesScalar) {
+	glm::mat4 projection = glm::perspective(glm::radians(60.f), 1.f, 0.1f, 100.f);
+	Engine::Frustum frustum = Engine::Culling::extractFrustum(projection); // Camera at the origin looking down -z
+
+	const uint32_t count = 1003;
+	std::vector<glm::vec4> spheres(count);
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> position(-120.f, 120.f), radius(0.f, 5.f);
+	for (auto& sphere : spheres) sphere = { position(rng), position(rng), position(rng), radius(rng) };
+
+	spheres[0] = { 0.f, 0.f, -10.f, 1.f }; // In front
+	spheres[1] = { 0.f, 0.f, 10.f, 1.f }; // Behind
+	spheres[2] = { 0.f, 0.f, -150.f, 1.f }; // Past the far plane
+	spheres[3] = { 0.f, 0.f, -101.f, 2.f }; // Straddles the far plane
+
+	std::vector<uint8_t> expected(count), result(count);
+	uint32_t expectedCount = Engine::Culling::cullSpheresScalar(frustum, spheres.data(), count, expected.data());
+	uint32_t resultCount = Engine::Culling::cullSpheres(frustum, spheres.data(), count, result.data());
+
+	EXPECT_EQ(resultCount, expectedCount);
+	EXPECT_EQ(result, expected);
+	EXPECT_EQ(result[0], 1);
+	EXPECT_EQ(result[1], 0);
+	EXPECT_EQ(result[2], 0);
+	EXPECT_EQ(result[3], 1);
+}
+
+// Bounds enclose every vertex and the sphere is no larger than the box's half diagonal
+TEST(Rendering, CullingComputesBounds) {
+	float vertices[4 * 5] = {
+		-1.f, 0.f, 2.f, 0.f, 0.f,
+		3.f, 1.f, 2.f, 1.f, 0.f,
+		-1.f, 4.f, -2.f, 0.f, 1.f,
+		3.f, 4.f, -2.f, 1.f, 1.f,
+	};
+	Engine::BoundingVolume bounds = Engine::Culling::computeBounds(vertices, 4, 5 * sizeof(float), 0);
+
+	EXPECT_TRUE(bounds.isBounded());
+	EXPECT_EQ(bounds.min, glm::vec3(-1.f, 0.f, -2.f));
+	EXPECT_EQ(bounds.max, glm::vec3(3.f, 4.f, 2.f));
+	EXPECT_FLOAT_EQ(bounds.sphere.x, 1.f);
+	EXPECT_FLOAT_EQ(bounds.sphere.y, 2.f);
+	EXPECT_FLOAT_EQ(bounds.sphere.z, 0.f);
+	EXPECT_LE(bounds.sphere.w, glm::length(bounds.max - bounds.min) * 0.5f + 0.0001f);
+	EXPECT_FALSE(Engine::BoundingVolume().isBounded());
+}
+
+// Queries agree with testing every box, through a parallel build, inserts, removes and a refit
+TEST(Rendering, BVHMatchesBruteForce) {
+	const uint32_t count = 5000;
+	std::vector<Engine::AABB> boxes(count);
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> position(-100.f, 100.f), size(0.1f, 4.f);
+	auto randomBox = [&]() {
+		Engine::AABB box;
+		box.min = { position(rng), position(rng), position(rng) };
+		box.max = box.min + glm::vec3(size(rng), size(rng), size(rng));
+		return box;
+	};
+	for (auto& box : boxes) box = randomBox();
+
+	Engine::BVH bvh;
+	bvh.build(boxes.data(), count, 4);
+	EXPECT_TRUE(bvh.validate());
+
+	// Remove a few, add some back and move the rest
+	std::vector<bool> alive(count, true);
+	for (uint32_t i = 0; i < count; i += 7) {
+		bvh.remove(i);
+		alive[i] = false;
+	}
+	for (uint32_t i = 0; i < 300; i++) {
+		Engine::AABB box = randomBox();
+		uint32_t id = bvh.insert(box);
+		if (id >= boxes.size()) {
+			boxes.resize(id + 1);
+			alive.resize(id + 1);
+		}
+		boxes[id] = box;
+		alive[id] = true;
+	}
+	for (uint32_t i = 1; i < boxes.size(); i += 3) {
+		if (!alive[i]) continue;
+		boxes[i].min += glm::vec3(5.f, 0.f, -5.f);
+		boxes[i].max += glm::vec3(5.f, 0.f, -5.f);
+		bvh.update(i, boxes[i]);
+	}
+	bvh.refit();
+	EXPECT_TRUE(bvh.validate());
+
+	std::vector<uint32_t> live;
+	for (uint32_t i = 0; i < boxes.size(); i++) if (alive[i]) live.push_back(i);
+	EXPECT_EQ(bvh.getObjectCount(), live.size());
+
+	auto sorted = [](std::vector<uint32_t> ids) { std::sort(ids.begin(), ids.end()); return ids; };
+
+	glm::mat4 viewProjection = glm::perspective(glm::radians(60.f), 1.f, 0.1f, 80.f);
+	Engine::Frustum frustum = Engine::Culling::extractFrustum(viewProjection);
+	Engine::AABB region;
+	region.min = glm::vec3(-20.f);
+	region.max = glm::vec3(20.f);
+	Engine::Ray ray;
+	ray.origin = { -110.f, 1.f, 2.f };
+	ray.direction = glm::normalize(boxes[live[live.size() / 2]].centre() - ray.origin); // Through at least one box
+	glm::vec3 inverseDirection = 1.f / ray.direction;
+
+	std::vector<uint32_t> inFrustum, inRegion, onRay;
+	uint32_t nearest = 0;
+	float nearestDistance = std::numeric_limits<float>::max();
+	for (uint32_t i : live) {
+		bool inside;
+		float distance;
+		if (Engine::Culling::intersects(frustum, boxes[i], inside)) inFrustum.push_back(i);
+		if (boxes[i].overlaps(region)) inRegion.push_back(i);
+		if (Engine::Culling::intersects(ray, inverseDirection, boxes[i], distance)) {
+			onRay.push_back(i);
+			if (distance < nearestDistance) {
+				nearestDistance = distance;
+				nearest = i;
+			}
+		}
+	}
+
+	std::vector<uint32_t> result;
+	bvh.queryFrustum(frustum, result);
+	EXPECT_EQ(sorted(result), inFrustum);
+	result.clear();
+	bvh.queryAABB(region, result);
+	EXPECT_EQ(sorted(result), inRegion);
+	result.clear();
+	bvh.queryRay(ray, result);
+	EXPECT_EQ(sorted(result), onRay);
+
+	uint32_t hit;
+	float hitDistance;
+	ASSERT_FALSE(onRay.empty());
+	ASSERT_TRUE(bvh.raycast(ray, hit, hitDistance));
+	EXPECT_EQ(hit, nearest);
+	EXPECT_FLOAT_EQ(hitDistance, nearestDistance);
+}
+
+// Levels only change once a threshold is passed by the hysteresis margin, and a change cross-fades over the fade frames
+TEST(Rendering, LODSelectionHysteresis) {
+	Engine::LODSet lods(0.1f, 4);
+	Engine::LODLevel level;
+	level.screenSize = 0.2f;
+	lods.addLevel(level);
+	level.screenSize = 0.05f;
+	lods.addLevel(level);
+
+	EXPECT_EQ(lods.select(0.5f, Engine::LODState::none), 0u);
+	EXPECT_EQ(lods.select(0.1f, Engine::LODState::none), 1u);
+	EXPECT_EQ(lods.select(0.01f, Engine::LODState::none), 2u);
+
+	EXPECT_EQ(lods.select(0.19f, 0), 0u); // Inside the margin below level 0
+	EXPECT_EQ(lods.select(0.17f, 0), 1u);
+	EXPECT_EQ(lods.select(0.21f, 1), 1u); // Inside the margin above level 0
+	EXPECT_EQ(lods.select(0.23f, 1), 0u);
+	EXPECT_EQ(lods.select(0.01f, 0), 2u);
+	EXPECT_EQ(lods.select(0.5f, 2), 0u);
+
+	Engine::LODState state;
+	lods.update(0.5f, state);
+	EXPECT_EQ(state.level, 0u);
+	EXPECT_EQ(state.fade, 1.f); // Nothing to fade from on the first selection
+
+	lods.update(0.1f, state);
+	EXPECT_EQ(state.level, 1u);
+	EXPECT_EQ(state.previous, 0u);
+	EXPECT_FLOAT_EQ(state.fade, 0.25f);
+	for (int i = 0; i < 3; i++) lods.update(0.1f, state);
+	EXPECT_FLOAT_EQ(state.fade, 1.f);
+
+	// A sphere of radius 1 at distance 10 with a 90 degree vertical field of view covers a tenth of the screen height
+	glm::mat4 projection = glm::perspective(glm::radians(90.f), 1.f, 0.1f, 100.f);
+	float size = Engine::LODSet::projectedSize({ 0.f, 0.f, -10.f, 1.f }, glm::mat4(1.f), projection);
+	EXPECT_NEAR(size, 0.1f, 0.0001f);
+	EXPECT_GT(Engine::LODSet::adjustBias(0.f, 1.f / 30.f, 1.f / 60.f), 0.f);
+	EXPECT_EQ(Engine::LODSet::adjustBias(0.f, 1.f / 120.f, 1.f / 60.f), 0.f);
+}
+
+// Threaded binning lists a light in every cluster its sphere reaches, never in a cluster whose box it misses, in submission order
+TEST(Rendering, LightClustersCoverLights) {
+	glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 100.f);
+	glm::mat4 view = glm::lookAt(glm::vec3(3.f, 2.f, 10.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+
+	std::vector<Engine::Light> lights;
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> position(-60.f, 60.f), range(0.5f, 15.f), unit(-1.f, 1.f), angle(0.1f, 1.4f);
+	for (uint32_t i = 0; i < 300; i++) {
+		glm::vec3 p = { position(rng), position(rng), position(rng) };
+		if (i % 3 == 0) lights.push_back(Engine::Light::spot(p, { unit(rng), unit(rng), unit(rng) + 0.01f }, range(rng), angle(rng), glm::vec3(1.f)));
+		else lights.push_back(Engine::Light::point(p, range(rng), glm::vec3(1.f)));
+	}
+
+	const glm::uvec3 grid = { 8, 6, 12 };
+	Engine::LightClusters clusters(grid);
+	clusters.bin(lights.data(), static_cast<uint32_t>(lights.size()), view, projection, 4);
+
+	const auto& ranges = clusters.getClusters();
+	const auto& indices = clusters.getLightIndices();
+	auto clusterLights = [&](uint32_t c) { return std::vector<uint32_t>(indices.begin() + ranges[c].offset, indices.begin() + ranges[c].offset + ranges[c].count); };
+	auto viewSphere = [&](uint32_t i) {
+		glm::vec4 sphere = lights[i].getBoundingSphere();
+		glm::vec4 centre = view * glm::vec4(sphere.x, sphere.y, sphere.z, 1.f);
+		return glm::vec4(centre.x, centre.y, centre.z, sphere.w);
+	};
+
+	uint32_t assigned = 0;
+	for (uint32_t c = 0; c < clusters.getClusterCount(); c++) {
+		std::vector<uint32_t> lightsInCluster = clusterLights(c);
+		EXPECT_TRUE(std::is_sorted(lightsInCluster.begin(), lightsInCluster.end()));
+		for (uint32_t i : lightsInCluster) EXPECT_TRUE(Engine::LightClusters::intersects(viewSphere(i), clusters.getClusterBounds(c)));
+		assigned += ranges[c].count;
+	}
+	EXPECT_EQ(assigned, indices.size());
+	EXPECT_GT(assigned, 0u);
+
+	// Points inside each sphere which are on screen must find the light in their cluster, the same lookup the shader does
+	Engine::ClusterHeader header = clusters.getHeader(static_cast<uint32_t>(lights.size()));
+	uint32_t checked = 0;
+	for (uint32_t i = 0; i < lights.size(); i++) {
+		glm::vec4 sphere = viewSphere(i);
+		for (uint32_t sample = 0; sample < 20; sample++) {
+			glm::vec3 offset = { unit(rng), unit(rng), unit(rng) };
+			if (glm::length(offset) > 1.f) continue;
+			glm::vec4 point = glm::vec4(glm::vec3(sphere.x, sphere.y, sphere.z) + offset * sphere.w, 1.f);
+			glm::vec4 clip = projection * point;
+			float depth = -point.z;
+			if (depth < header.depth.x || depth > header.depth.y || std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w) continue;
+
+			uint32_t x = std::min(grid.x - 1, static_cast<uint32_t>((clip.x / clip.w * 0.5f + 0.5f) * grid.x));
+			uint32_t y = std::min(grid.y - 1, static_cast<uint32_t>((clip.y / clip.w * 0.5f + 0.5f) * grid.y));
+			uint32_t z = std::min(grid.z - 1, static_cast<uint32_t>(std::log(depth / header.depth.x) * header.depth.z));
+			std::vector<uint32_t> lightsInCluster = clusterLights(clusters.getClusterIndex(x, y, z));
+			EXPECT_TRUE(std::find(lightsInCluster.begin(), lightsInCluster.end(), i) != lightsInCluster.end()) << "light " << i;
+			checked++;
+		}
+	}
+	EXPECT_GT(checked, 100u);
+
+	// Every point of a spot cone is inside its bounding sphere
+	Engine::Light spot = Engine::Light::spot(glm::vec3(1.f, 2.f, 3.f), glm::vec3(0.f, 0.f, -1.f), 10.f, 0.3f, glm::vec3(1.f));
+	glm::vec4 sphere = spot.getBoundingSphere();
+	glm::vec3 tip = glm::vec3(1.f, 2.f, 3.f) + glm::vec3(std::sin(0.3f), 0.f, -std::cos(0.3f)) * 10.f;
+	EXPECT_LE(glm::length(tip - glm::vec3(sphere.x, sphere.y, sphere.z)), sphere.w + 0.0001f);
+	EXPECT_LT(sphere.w, 10.f);
+}
+
+TEST(Rendering, OcclusionCullerHidesBoxesBehindOccluders) {
+	glm::mat4 projection = glm::perspective(glm::radians(60.f), 2.f, 0.1f, 100.f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+
+	// A wall 4 x 4 units across, 5 units in front of the camera
+	const float wall[4 * 3] = { -2.f, -2.f, -5.f, 2.f, -2.f, -5.f, 2.f, 2.f, -5.f, -2.f, 2.f, -5.f };
+	const uint32_t wallIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	Engine::OcclusionCuller culler(256, 128);
+	culler.begin(projection * view);
+	EXPECT_FALSE(culler.hasOccluders());
+	culler.addOccluder(wall, 4, sizeof(float) * 3, 0, wallIndices, 6, glm::mat4(1.f));
+	culler.rasterize(2);
+	EXPECT_EQ(culler.getStats().occluderTriangles, 2u);
+
+	auto box = [](glm::vec3 centre, float half) { return Engine::AABB{ centre - glm::vec3(half), centre + glm::vec3(half) }; };
+	EXPECT_FALSE(culler.isVisible(box({ 0.f, 0.f, -10.f }, 0.5f))); // Behind the wall
+	EXPECT_FALSE(culler.isVisible(box({ 0.5f, -0.5f, -30.f }, 2.f))); // Far behind, covering many texels
+	EXPECT_TRUE(culler.isVisible(box({ 0.f, 0.f, -3.f }, 0.5f))); // In front of the wall
+	EXPECT_TRUE(culler.isVisible(box({ 0.f, 0.f, -5.f }, 0.5f))); // Passing through the wall
+	EXPECT_TRUE(culler.isVisible(box({ 4.f, 0.f, -10.f }, 0.5f))); // Beside the wall
+	EXPECT_TRUE(culler.isVisible(box({ 0.f, 0.f, 5.f }, 0.5f))); // Behind the camera
+	EXPECT_TRUE(culler.isVisible(box({ 0.f, 0.f, -10.f }, 6.f))); // Larger than the wall
+	EXPECT_EQ(culler.getStats().tested, 7u);
+	EXPECT_EQ(culler.getStats().occluded, 2u);
+
+	// Each level keeps the furthest depth beneath it
+	for (uint32_t level = 1; level < culler.getLevelCount(); level++) {
+		const std::vector<float>& fine = culler.getLevel(level - 1);
+		const std::vector<float>& coarse = culler.getLevel(level);
+		uint32_t fineWidth = std::max(1u, culler.getWidth() >> (level - 1));
+		uint32_t coarseWidth = std::max(1u, culler.getWidth() >> level);
+		for (uint32_t i = 0; i < fine.size(); i++) {
+			uint32_t x = std::min(coarseWidth - 1, (i % fineWidth) / 2), y = (i / fineWidth) / 2;
+			y = std::min(y, static_cast<uint32_t>(coarse.size() / coarseWidth) - 1);
+			EXPECT_LE(fine[i], coarse[y * coarseWidth + x]);
+		}
+	}
+	EXPECT_EQ(culler.getLevel(culler.getLevelCount() - 1).size(), 1u);
+
+	// A wall tilted through the near plane, its lower half lies between the eye and the near plane and is clipped away
+	const float nearWall[4 * 3] = { -0.02f, -0.02f, -0.05f, 0.02f, -0.02f, -0.05f, 0.02f, 0.02f, -0.15f, -0.02f, 0.02f, -0.15f };
+	culler.begin(projection * view);
+	culler.addOccluder(nearWall, 4, sizeof(float) * 3, 0, wallIndices, 6, glm::mat4(1.f));
+	culler.rasterize(1);
+	EXPECT_TRUE(culler.isVisible(box({ 0.f, -1.73f, -10.f }, 0.1f))); // Behind the clipped half
+	EXPECT_FALSE(culler.isVisible(box({ 0.f, 0.4f, -10.f }, 0.1f))); // Behind the kept half
+
+	// A floor running from behind the camera still occludes with the part in front of the near plane
+	const float floor[4 * 3] = { -0.1f, -0.02f, 0.05f, 0.1f, -0.02f, 0.05f, 0.1f, 0.02f, -0.25f, -0.1f, 0.02f, -0.25f };
+	culler.begin(projection * view);
+	culler.addOccluder(floor, 4, sizeof(float) * 3, 0, wallIndices, 6, glm::mat4(1.f));
+	culler.rasterize(1);
+	EXPECT_GT(culler.getStats().occluderTriangles, 0u);
+	EXPECT_FALSE(culler.isVisible(box({ 0.f, 0.4f, -10.f }, 0.1f)));
+	EXPECT_TRUE(culler.isVisible(box({ 0.f, -1.73f, -10.f }, 0.1f)));
+
+	// A new frame without occluders keeps everything
+	culler.begin(projection * view);
+	culler.rasterize(1);
+	EXPECT_TRUE(culler.isVisible(box({ 0.f, 0.f, -10.f }, 0.5f)));
+}
+
+TEST(Rendering, TextureUnitsEvictLeastRecentlyUsed) {
+	Engine::TextureUnitManager units(4);
+	uint32_t unit;
+
+	// Textures 1 to 4 fill the units in order, a second lookup is resident
+	for (uint32_t texture = 1; texture <= 4; texture++) {
+		EXPECT_TRUE(units.getUnit(texture, unit));
+		EXPECT_EQ(unit, texture - 1);
+	}
+	EXPECT_FALSE(units.getUnit(3, unit));
+	EXPECT_EQ(unit, 2u);
+	EXPECT_TRUE(units.full());
+
+	// Every unit is read by the current batch
+	EXPECT_TRUE(units.getUnit(5, unit));
+	EXPECT_EQ(unit, static_cast<uint32_t>(-1));
+
+	// After the batch is drawn the least recently used texture goes, 1 then 2, and 3 was used after 4
+	units.nextBatch();
+	EXPECT_FALSE(units.full());
+	EXPECT_FALSE(units.getUnit(1, unit));
+	EXPECT_TRUE(units.getUnit(5, unit));
+	EXPECT_EQ(unit, 1u);
+	EXPECT_TRUE(units.getUnit(6, unit));
+	EXPECT_EQ(unit, 3u);
+	EXPECT_TRUE(units.getUnit(7, unit));
+	EXPECT_EQ(unit, 2u);
+	EXPECT_FALSE(units.getUnit(1, unit));
+	EXPECT_EQ(unit, 0u);
+
+	// A deleted texture frees its unit, which is reused before anything is evicted
+	units.nextBatch();
+	units.evict(6);
+	EXPECT_TRUE(units.getUnit(8, unit));
+	EXPECT_EQ(unit, 3u);
+
+	const Engine::TextureUnitStats& stats = units.getStats();
+	EXPECT_EQ(stats.hits, 3u);
+	EXPECT_EQ(stats.binds, 8u);
+	EXPECT_EQ(stats.evictions, 3u);
+
+	// Units past the capacity are never handed out
+	Engine::TextureUnitManager wide(Engine::TextureUnitManager::maxUnits);
+	for (uint32_t texture = 0; texture < 100; texture++) {
+		if (texture % 32 == 0) wide.nextBatch();
+		wide.getUnit(texture * 7 + 1, unit);
+		EXPECT_LT(unit, Engine::TextureUnitManager::maxUnits);
+		EXPECT_FALSE(wide.getUnit(texture * 7 + 1, unit));
+	}
+}
+
+TEST(Rendering, RenderThreadRunsPacketsInOrder) {
+	Engine::RenderThread renderThread;
+	std::vector<int> executed;
+	std::thread::id game = std::this_thread::get_id();
+
+	// Before start packets run on the calling thread at submit
+	renderThread.getPacket().enqueue([&]() { executed.push_back(0); });
+	EXPECT_EQ(renderThread.getPacket().getCommandCount(), 1u);
+	renderThread.submitFrame();
+	ASSERT_EQ(executed.size(), 1u);
+
+	std::atomic<bool> startedOnRenderThread{ false };
+	renderThread.start([&]() { startedOnRenderThread = std::this_thread::get_id() != game; });
+	EXPECT_TRUE(renderThread.isRunning());
+	EXPECT_FALSE(renderThread.isRenderThread());
+
+	std::atomic<int> lastFrame{ 0 };
+	std::shared_ptr<int> resource = std::make_shared<int>(7);
+	std::weak_ptr<int> watch = resource;
+	for (int frame = 1; frame <= 20; frame++) {
+		// The previous frame has finished once submit returns, so latency is at most one frame
+		EXPECT_GE(lastFrame.load(), frame - 2);
+
+		Engine::FramePacket& packet = renderThread.getPacket();
+		int value = frame * 10;
+		int* copy = packet.snapshot(&value);
+		value = -1;
+		packet.enqueue([&, copy, frame]() {
+			EXPECT_TRUE(renderThread.isRenderThread());
+			EXPECT_EQ(*copy, frame * 10);
+			EXPECT_EQ(lastFrame.load(), frame - 1);
+			executed.push_back(frame);
+			lastFrame = frame;
+		});
+		if (frame == 10) packet.release(std::move(resource));
+		renderThread.submitFrame();
+	}
+	renderThread.finish();
+	EXPECT_EQ(lastFrame.load(), 20);
+	EXPECT_TRUE(watch.expired());
+	EXPECT_TRUE(startedOnRenderThread);
+
+	renderThread.stop();
+	EXPECT_FALSE(renderThread.isRunning());
+	ASSERT_EQ(executed.size(), 21u);
+	for (int frame = 0; frame <= 20; frame++) EXPECT_EQ(executed[frame], frame);
+	EXPECT_EQ(renderThread.getStats().frames, 21u);
+
+	// Commands which never run are still destroyed
+	std::shared_ptr<int> dropped = std::make_shared<int>(1);
+	renderThread.getPacket().enqueue([dropped]() {});
+	renderThread.getPacket().clear();
+	EXPECT_EQ(dropped.use_count(), 1);
+}
+
+namespace {
+	class RecordingDevice : public Engine::FrameGraphDevice {
+	public:
+		uint32_t nextTexture = 100;
+		uint32_t acquired = 0;
+		uint32_t released = 0;
+		std::vector<uint32_t> binds;
+		std::vector<uint32_t> barriers;
+		std::vector<std::string> timed;
+
+		uint32_t acquireTexture(const Engine::FrameGraphTextureDesc& desc) override { acquired++; return nextTexture++; }
+		void releaseTextures() override { released++; }
+		void bindRenderTargets(const uint32_t* colour, uint32_t colourCount, uint32_t depth, const Engine::FrameGraphTextureDesc& desc) override { binds.push_back(colourCount ? colour[0] : depth); }
+		void barrier(uint32_t bits) override { barriers.push_back(bits); }
+		void beginTimer(const std::string& pass) override { timed.push_back(pass); }
+		void endTimer() override {}
+		float getGPUTime(const std::string& pass) override { return 0.001f; }
+	};
+}
+
+TEST(Rendering, FrameGraphCullsOrdersAndAliases) {
+	Engine::FrameGraph graph;
+	Engine::FrameGraphTextureDesc colourDesc = { 64, 64, Engine::FrameGraphFormat::RGBA8 };
+	Engine::FrameGraphTextureDesc depthDesc = { 64, 64, Engine::FrameGraphFormat::Depth24Stencil8 };
+	Engine::FrameGraphResource backbuffer = graph.importTexture("backbuffer", colourDesc, 0);
+	Engine::FrameGraphResource lights = graph.importBuffer("lights", 7);
+	std::vector<std::string> executed;
+	auto record = [&](const char* name) { return [&executed, name](const Engine::FrameGraphPassResources&) { executed.push_back(name); }; };
+
+	// A chain of three transients, the first and last never overlap so they can share a texture
+	Engine::FrameGraphResource a, b, c, unused;
+	graph.addPass("A", [&](Engine::FrameGraphBuilder& builder) { a = builder.write(builder.create("a", colourDesc)); return record("A"); });
+	graph.addPass("B", [&](Engine::FrameGraphBuilder& builder) { builder.read(a); b = builder.write(builder.create("b", colourDesc)); return record("B"); });
+	graph.addPass("Unused", [&](Engine::FrameGraphBuilder& builder) { builder.read(a); unused = builder.write(builder.create("unused", colourDesc)); return record("Unused"); });
+	graph.addPass("C", [&](Engine::FrameGraphBuilder& builder) { builder.read(b); c = builder.write(builder.create("c", colourDesc)); return record("C"); });
+	graph.addPass("Bin", [&](Engine::FrameGraphBuilder& builder) { lights = builder.write(lights, Engine::FrameGraphAccess::StorageWrite); return record("Bin"); });
+	graph.addPass("Present", [&](Engine::FrameGraphBuilder& builder) {
+		builder.read(c);
+		builder.read(lights, Engine::FrameGraphAccess::StorageRead);
+		backbuffer = builder.write(backbuffer);
+		return [&, c](const Engine::FrameGraphPassResources& resources) {
+			executed.push_back("Present");
+			EXPECT_EQ(resources.get(backbuffer), 0u);
+			EXPECT_EQ(resources.get(lights), 7u);
+			EXPECT_GE(resources.get(c), 100u);
+			EXPECT_EQ(resources.getDesc(c).width, 64u);
+		};
+	});
+	graph.compile();
+
+	EXPECT_TRUE(graph.isCulled(2));
+	EXPECT_EQ(graph.getOrder().size(), 5u);
+	EXPECT_EQ(graph.getPhysicalTexture(unused), -1);
+	EXPECT_EQ(graph.getPhysicalTexture(a), graph.getPhysicalTexture(c));
+	EXPECT_NE(graph.getPhysicalTexture(a), graph.getPhysicalTexture(b));
+	EXPECT_EQ(graph.getBarriers(5), static_cast<uint32_t>(Engine::FrameGraphBarrier::Storage));
+	EXPECT_EQ(graph.getBarriers(3), static_cast<uint32_t>(Engine::FrameGraphBarrier::None));
+
+	const Engine::FrameGraphStats& stats = graph.getStats();
+	EXPECT_EQ(stats.passes, 6u);
+	EXPECT_EQ(stats.culledPasses, 1u);
+	EXPECT_EQ(stats.transientTextures, 3u);
+	EXPECT_EQ(stats.physicalTextures, 2u);
+	EXPECT_EQ(stats.barriers, 1u);
+
+	RecordingDevice device;
+	graph.execute(device);
+	EXPECT_EQ(executed, (std::vector<std::string>{ "A", "B", "C", "Bin", "Present" }));
+	EXPECT_EQ(device.timed, executed);
+	EXPECT_EQ(device.acquired, 2u);
+	EXPECT_EQ(device.released, 1u);
+	ASSERT_EQ(device.barriers.size(), 1u);
+	EXPECT_EQ(device.binds.size(), 4u);
+	EXPECT_EQ(device.binds.back(), 0u);
+	ASSERT_EQ(graph.getTimings().size(), 5u);
+	EXPECT_EQ(graph.getTimings()[4].name, "Present");
+	EXPECT_FLOAT_EQ(graph.getTimings()[4].gpuTime, 0.001f);
+
+	// Passes rendering to the same target run together when the dependencies allow it
+	graph.reset();
+	executed.clear();
+	backbuffer = graph.importTexture("backbuffer", colourDesc, 0);
+	Engine::FrameGraphResource shadow;
+	graph.addPass("Shadow1", [&](Engine::FrameGraphBuilder& builder) { shadow = builder.write(builder.create("shadow", depthDesc), Engine::FrameGraphAccess::DepthTarget); return record("Shadow1"); });
+	graph.addPass("Sky", [&](Engine::FrameGraphBuilder& builder) { backbuffer = builder.write(backbuffer); return record("Sky"); });
+	graph.addPass("Shadow2", [&](Engine::FrameGraphBuilder& builder) { shadow = builder.write(shadow, Engine::FrameGraphAccess::DepthTarget); return record("Shadow2"); });
+	graph.addPass("Lit", [&](Engine::FrameGraphBuilder& builder) { builder.read(shadow); backbuffer = builder.write(backbuffer); return record("Lit"); });
+
+	RecordingDevice grouped;
+	graph.execute(grouped);
+	EXPECT_EQ(executed, (std::vector<std::string>{ "Shadow1", "Shadow2", "Sky", "Lit" }));
+	EXPECT_EQ(graph.getStats().targetBinds, 2u);
+	EXPECT_EQ(grouped.binds.size(), 2u);
+	EXPECT_TRUE(grouped.barriers.empty());
+}
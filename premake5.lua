@@ -151,6 +151,7 @@ project "Sandbox"
 			"engine/enginecode/",
 			"engine/enginecode/include/independent",
 			"engine/enginecode/include/platform",
+			"engine/enginecode/include/",
 			"engine/precompiled/",
 			"vendor/spdlog/include",
 			"vendor/glfw/include",
@@ -195,6 +196,7 @@ project "Spike"
 		"engine/enginecode/",
 		"engine/enginecode/include/independent",
 		"engine/enginecode/include/platform",
+		"engine/enginecode/include/",
 		"engine/precompiled/",
 		"%{prj.name}/include",
 		"vendor/spdlog/include",
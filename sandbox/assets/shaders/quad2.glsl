@@ -39,5 +39,13 @@ uniform sampler2D[32] u_texData;
 
 void main()
 {	
-	colour = texture(u_texData[texUnit], texCoord) * tint;
+	// Bit 8 of the unit marks a signed distance field glyph, the edge sits at 0.5 in alpha
+	vec4 texel = texture(u_texData[texUnit & 0xFF], texCoord);
+	if ((texUnit & 0x100) != 0)
+	{
+		float distance = texel.a;
+		float width = max(fwidth(distance), 0.0001);
+		texel = vec4(1.0, 1.0, 1.0, smoothstep(0.5 - width, 0.5 + width, distance));
+	}
+	colour = texel * tint;
 }
\ No newline at end of file
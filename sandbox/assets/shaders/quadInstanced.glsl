@@ -0,0 +1,60 @@
+#region Vertex
+
+#version 440 core
+
+layout(location = 0) in vec2 a_translate;
+layout(location = 1) in vec2 a_scale;
+layout(location = 2) in vec4 a_uvRect;
+layout(location = 3) in vec2 a_rotation;
+layout(location = 4) in int a_texUnit;
+layout(location = 5) in vec4 a_tint;
+
+out vec2 texCoord;
+out flat int texUnit;
+out vec4 tint;
+
+layout (std140) uniform b_cameraQuad
+{
+	mat4 u_projection;
+	mat4 u_view;
+};
+
+void main()
+{
+	// Corner order matches Renderer2D: (-,-), (-,+), (+,+), (+,-)
+	int corner = gl_VertexID & 3;
+	vec2 unitCorner = vec2((corner >> 1) & 1, ((corner + 1) >> 1) & 1);
+
+	vec2 local = (unitCorner - 0.5) * a_scale;
+	vec2 rotated = vec2(local.x * a_rotation.x - local.y * a_rotation.y, local.x * a_rotation.y + local.y * a_rotation.x);
+
+	texCoord = mix(a_uvRect.xy, a_uvRect.zw, unitCorner);
+	texUnit = a_texUnit;
+	tint = a_tint;
+	gl_Position = u_projection * u_view * vec4(a_translate + rotated, 1.0, 1.0);
+}
+
+#region Fragment
+
+#version 440 core
+			
+layout(location = 0) out vec4 colour;
+
+in vec2 texCoord;
+in flat int texUnit;
+in vec4 tint;
+
+uniform sampler2D[32] u_texData;
+
+void main()
+{	
+	// Bit 8 of the unit marks a signed distance field glyph, the edge sits at 0.5 in alpha
+	vec4 texel = texture(u_texData[texUnit & 0xFF], texCoord);
+	if ((texUnit & 0x100) != 0)
+	{
+		float distance = texel.a;
+		float width = max(fwidth(distance), 0.0001);
+		texel = vec4(1.0, 1.0, 1.0, smoothstep(0.5 - width, 0.5 + width, distance));
+	}
+	colour = texel * tint;
+}
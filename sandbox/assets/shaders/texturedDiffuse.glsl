@@ -0,0 +1,94 @@
+#region Vertex
+
+#version 440 core
+
+layout(location = 0) in vec3 a_vertexPosition;
+layout(location = 1) in vec3 a_vertexNormal;
+layout(location = 2) in vec2 a_texCoord;
+layout(location = 7) in uint a_drawId;
+
+out vec3 fragmentPos;
+out vec3 normal;
+out vec2 texCoord;
+flat out uint drawId;
+
+layout (std140) uniform b_camera
+{
+	mat4 u_projection;
+	mat4 u_view;
+};
+
+struct Transform
+{
+	mat4 model;
+	mat3 normal;
+};
+
+layout (std430, binding = 0) buffer b_transforms
+{
+	Transform u_transforms[];
+};
+
+void main()
+{
+	Transform transform = u_transforms[a_drawId];
+	drawId = a_drawId;
+	fragmentPos = vec3(transform.model * vec4(a_vertexPosition, 1.0));
+	normal = transform.normal * a_vertexNormal;
+	texCoord = vec2(a_texCoord.x, a_texCoord.y);
+	gl_Position =  u_projection * u_view * transform.model * vec4(a_vertexPosition,1.0);
+}
+
+#region Fragment
+
+#version 440 core
+			
+layout(location = 0) out vec4 colour;
+in vec3 normal;
+in vec3 fragmentPos;
+in vec2 texCoord;
+flat in uint drawId;
+
+layout (std140) uniform b_lights
+{
+	vec3 u_lightPos; 
+	vec3 u_viewPos; 
+	vec3 u_lightColour;
+};
+struct Material
+{
+	vec4 tint;
+	int texUnit;
+	float fade;
+	int fadeOut;
+};
+
+layout (std430, binding = 1) buffer b_materials
+{
+	Material u_materials[];
+};
+
+// One texture per multi draw, a sampler array indexed by the draw ID would not be dynamically uniform
+uniform sampler2D u_texData;
+
+// 4x4 ordered dither, the level fading in keeps pixels below its progress and the level fading out keeps the rest
+bool ditherDiscard(float fade, int fadeOut)
+{
+	const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+	ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+	bool covered = (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0 < fade;
+	return covered == (fadeOut != 0);
+}
+
+void main()
+{
+	if (u_materials[drawId].fade < 1.0 && ditherDiscard(u_materials[drawId].fade, u_materials[drawId].fadeOut)) discard;
+
+	float ambientStrength = 0.4;
+	vec3 ambient = ambientStrength * u_lightColour;
+	vec3 norm = normalize(normal);
+	vec3 lightDir = normalize(u_lightPos - fragmentPos);
+	float diff = max(dot(norm, lightDir), 0.0);
+	vec3 diffuse = diff * u_lightColour;
+	colour = vec4((ambient + diffuse), 1.0) * texture(u_texData, texCoord) * u_materials[drawId].tint;
+}
\ No newline at end of file
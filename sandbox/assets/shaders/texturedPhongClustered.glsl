@@ -0,0 +1,169 @@
+#region Vertex
+
+#version 440 core
+
+layout(location = 0) in vec3 a_vertexPosition;
+layout(location = 1) in vec3 a_vertexNormal;
+layout(location = 2) in vec2 a_texCoord;
+layout(location = 7) in uint a_drawId;
+
+out vec3 fragmentPos;
+out vec3 normal;
+out vec2 texCoord;
+flat out uint drawId;
+out vec4 clipPosition;
+out float viewDepth;
+
+layout (std140) uniform b_camera
+{
+	mat4 u_projection;
+	mat4 u_view;
+};
+
+struct Transform
+{
+	mat4 model;
+	mat3 normal;
+};
+
+layout (std430, binding = 0) buffer b_transforms
+{
+	Transform u_transforms[];
+};
+
+void main()
+{
+	Transform transform = u_transforms[a_drawId];
+	drawId = a_drawId;
+	fragmentPos = vec3(transform.model * vec4(a_vertexPosition, 1.0));
+	normal = transform.normal * a_vertexNormal;
+	texCoord = vec2(a_texCoord.x, a_texCoord.y);
+	vec4 viewPosition = u_view * vec4(fragmentPos, 1.0);
+	viewDepth = -viewPosition.z;
+	clipPosition = u_projection * viewPosition;
+	gl_Position = clipPosition;
+}
+
+#region Fragment
+
+#version 440 core
+			
+layout(location = 0) out vec4 colour;
+in vec3 normal;
+in vec3 fragmentPos;
+in vec2 texCoord;
+flat in uint drawId;
+in vec4 clipPosition;
+in float viewDepth;
+
+layout (std140) uniform b_lights
+{
+	vec3 u_lightPos; 
+	vec3 u_viewPos; 
+	vec3 u_lightColour;
+};
+struct Material
+{
+	vec4 tint;
+	int texUnit;
+	float fade;
+	int fadeOut;
+};
+
+layout (std430, binding = 1) buffer b_materials
+{
+	Material u_materials[];
+};
+
+struct Light
+{
+	vec4 position;
+	vec4 colour;
+	vec4 direction;
+};
+
+layout (std430, binding = 2) buffer b_sceneLights
+{
+	Light u_sceneLights[];
+};
+
+layout (std430, binding = 3) buffer b_clusters
+{
+	uvec4 u_clusterGrid;
+	vec4 u_clusterDepth;
+	uvec2 u_clusters[];
+};
+
+layout (std430, binding = 4) buffer b_lightIndices
+{
+	uint u_lightIndices[];
+};
+
+// One texture per multi draw, a sampler array indexed by the draw ID would not be dynamically uniform
+uniform sampler2D u_texData;
+
+// Screen tile from the interpolated clip position, depth slice from the log of the view depth, matching LightClusters
+uint clusterIndex()
+{
+	vec2 ndc = clipPosition.xy / clipPosition.w;
+	uvec2 tile = uvec2(clamp((ndc * 0.5 + 0.5) * vec2(u_clusterGrid.xy), vec2(0.0), vec2(u_clusterGrid.xy) - 1.0));
+	uint slice = uint(clamp(log(viewDepth / u_clusterDepth.x) * u_clusterDepth.z, 0.0, float(u_clusterGrid.z) - 1.0));
+	return (slice * u_clusterGrid.y + tile.y) * u_clusterGrid.x + tile.x;
+}
+
+vec3 shadeLight(Light light, vec3 norm, vec3 viewDir)
+{
+	vec3 toLight = light.position.xyz - fragmentPos;
+	float distance = length(toLight);
+	if (distance >= light.position.w) return vec3(0.0);
+	vec3 lightDir = toLight / distance;
+
+	// Inverse square falloff windowed to reach zero at the light's range
+	float window = clamp(1.0 - pow(distance / light.position.w, 4.0), 0.0, 1.0);
+	float attenuation = window * window / (distance * distance + 1.0);
+
+	// Spot lights fade out over the outer tenth of the cone
+	if (light.direction.w > -1.0)
+	{
+		float cosAngle = dot(-lightDir, light.direction.xyz);
+		attenuation *= smoothstep(light.direction.w, mix(light.direction.w, 1.0, 0.1), cosAngle);
+	}
+
+	float diff = max(dot(norm, lightDir), 0.0);
+	vec3 reflectDir = reflect(-lightDir, norm);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), 64);
+	return (diff + 0.8 * spec) * light.colour.rgb * light.colour.a * attenuation;
+}
+
+// 4x4 ordered dither, the level fading in keeps pixels below its progress and the level fading out keeps the rest
+bool ditherDiscard(float fade, int fadeOut)
+{
+	const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+	ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+	bool covered = (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0 < fade;
+	return covered == (fadeOut != 0);
+}
+
+void main()
+{
+	if (u_materials[drawId].fade < 1.0 && ditherDiscard(u_materials[drawId].fade, u_materials[drawId].fadeOut)) discard;
+
+	float ambientStrength = 0.4;
+	vec3 ambient = ambientStrength * u_lightColour;
+	vec3 norm = normalize(normal);
+	vec3 lightDir = normalize(u_lightPos - fragmentPos);
+	float diff = max(dot(norm, lightDir), 0.0);
+	vec3 diffuse = diff * u_lightColour;
+	float specularStrength = 0.8;
+	vec3 viewDir = normalize(u_viewPos - fragmentPos);
+	vec3 reflectDir = reflect(-lightDir, norm);  
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), 64);
+	vec3 specular = specularStrength * spec * u_lightColour;  
+	
+	// Only the lights binned into this fragment's cluster
+	vec3 clustered = vec3(0.0);
+	uvec2 cluster = u_clusters[clusterIndex()];
+	for (uint i = 0; i < cluster.y; i++) clustered += shadeLight(u_sceneLights[u_lightIndices[cluster.x + i]], norm, viewDir);
+
+	colour = vec4((ambient + diffuse + specular + clustered), 1.0) * texture(u_texData, texCoord) * u_materials[drawId].tint;
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+/** \file benchmarks.h */
+#pragma once
+
+void benchmarkQuadBatch(); //!< Compare the scalar and SIMD quad writers
+void benchmarkBVH(); //!< Compare BVH queries against testing every object
+void benchmarkLightClusters(); //!< Time light binning against light count and threads
+void benchmarkOcclusion(); //!< Time occluder rasterization and report the cull rate behind walls
+void benchmarkRenderThread(); //!< Compare recording and executing frames on one thread against executing them on a render thread
@@ -1,4 +1,11 @@
+#include "benchmarks.h"
+
 int main()
 {
+	benchmarkQuadBatch();
+	benchmarkBVH();
+	benchmarkLightClusters();
+	benchmarkOcclusion();
+	benchmarkRenderThread();
 	return 0;
-}
\ No newline at end of file
+}
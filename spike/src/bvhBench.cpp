@@ -0,0 +1,119 @@
+/** \file bvhBench.cpp */
+#include "benchmarks.h"
+#include "rendering/bvh.h"
+#include "core/timer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+void benchmarkBVH()
+{
+	const uint32_t counts[] = { 1000, 10000, 100000 };
+	const uint32_t queries = 100;
+
+	for (uint32_t count : counts) {
+		// Keep the density constant so each query returns a similar fraction of the scene
+		float extent = 10.f * std::cbrt(static_cast<float>(count));
+		std::mt19937 rng(count);
+		std::uniform_real_distribution<float> position(-extent, extent), size(0.5f, 3.f), unit(-1.f, 1.f);
+
+		std::vector<Engine::AABB> boxes(count);
+		for (auto& box : boxes) {
+			box.min = { position(rng), position(rng), position(rng) };
+			box.max = box.min + glm::vec3(size(rng), size(rng), size(rng));
+		}
+
+		std::vector<Engine::Frustum> frustums(queries);
+		std::vector<Engine::Ray> rays(queries);
+		std::vector<glm::vec3> inverseDirections(queries);
+		std::vector<Engine::AABB> regions(queries);
+		glm::mat4 projection = glm::perspective(glm::radians(45.f), 16.f / 9.f, 0.1f, extent);
+		for (uint32_t i = 0; i < queries; i++) {
+			glm::vec3 eye = { position(rng), position(rng), position(rng) };
+			glm::vec3 direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)));
+			frustums[i] = Engine::Culling::extractFrustum(projection * glm::lookAt(eye, eye + direction, { 0.f, 1.f, 0.f }));
+			rays[i].origin = eye;
+			rays[i].direction = direction;
+			inverseDirections[i] = 1.f / direction;
+			regions[i].min = eye - glm::vec3(10.f);
+			regions[i].max = eye + glm::vec3(10.f);
+		}
+
+		Engine::BVH bvh;
+		Engine::MiliTimer timer;
+
+		timer.start();
+		bvh.build(boxes.data(), count, 1);
+		float buildSingle = timer.getElapsedTime() * 1000.f;
+
+		timer.reset();
+		bvh.build(boxes.data(), count);
+		float buildParallel = timer.getElapsedTime() * 1000.f;
+
+		std::vector<uint32_t> results;
+		results.reserve(count);
+		uint32_t found = 0;
+		float distance;
+
+		timer.reset();
+		for (uint32_t i = 0; i < queries; i++) {
+			results.clear();
+			for (uint32_t j = 0; j < count; j++) {
+				bool inside;
+				if (Engine::Culling::intersects(frustums[i], boxes[j], inside)) results.push_back(j);
+			}
+			found += static_cast<uint32_t>(results.size());
+		}
+		float frustumBrute = timer.getElapsedTime() * 1000.f / queries;
+
+		timer.reset();
+		for (uint32_t i = 0; i < queries; i++) {
+			results.clear();
+			bvh.queryFrustum(frustums[i], results);
+			found += static_cast<uint32_t>(results.size());
+		}
+		float frustumBVH = timer.getElapsedTime() * 1000.f / queries;
+
+		timer.reset();
+		for (uint32_t i = 0; i < queries; i++) {
+			float nearest = std::numeric_limits<float>::max();
+			for (uint32_t j = 0; j < count; j++) {
+				if (Engine::Culling::intersects(rays[i], inverseDirections[i], boxes[j], distance) && distance < nearest) nearest = distance;
+			}
+			found += nearest < std::numeric_limits<float>::max();
+		}
+		float rayBrute = timer.getElapsedTime() * 1000.f / queries;
+
+		timer.reset();
+		for (uint32_t i = 0; i < queries; i++) {
+			uint32_t object;
+			found += bvh.raycast(rays[i], object, distance);
+		}
+		float rayBVH = timer.getElapsedTime() * 1000.f / queries;
+
+		timer.reset();
+		for (uint32_t i = 0; i < queries; i++) {
+			results.clear();
+			for (uint32_t j = 0; j < count; j++) if (boxes[j].overlaps(regions[i])) results.push_back(j);
+			found += static_cast<uint32_t>(results.size());
+		}
+		float overlapBrute = timer.getElapsedTime() * 1000.f / queries;
+
+		timer.reset();
+		for (uint32_t i = 0; i < queries; i++) {
+			results.clear();
+			bvh.queryAABB(regions[i], results);
+			found += static_cast<uint32_t>(results.size());
+		}
+		float overlapBVH = timer.getElapsedTime() * 1000.f / queries;
+
+		std::cout << "BVH, " << count << " objects (" << found << " hits)" << std::endl;
+		std::cout << "  build:   " << buildSingle << " ms single thread, " << buildParallel << " ms parallel" << std::endl;
+		std::cout << "  frustum: " << frustumBrute << " ms brute force, " << frustumBVH << " ms BVH (" << frustumBrute / frustumBVH << "x)" << std::endl;
+		std::cout << "  ray:     " << rayBrute << " ms brute force, " << rayBVH << " ms BVH (" << rayBrute / rayBVH << "x)" << std::endl;
+		std::cout << "  overlap: " << overlapBrute << " ms brute force, " << overlapBVH << " ms BVH (" << overlapBrute / overlapBVH << "x)" << std::endl;
+	}
+}
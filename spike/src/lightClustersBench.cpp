@@ -0,0 +1,48 @@
+/** \file lightClustersBench.cpp */
+#include "benchmarks.h"
+#include "rendering/lightClusters.h"
+#include "core/timer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+void benchmarkLightClusters()
+{
+	const uint32_t counts[] = { 64, 256, 1024, 4096 };
+	const uint32_t runs = 50;
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.f), 16.f / 9.f, 0.1f, 100.f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.f, 5.f, 20.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+	uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint32_t count : counts) {
+		std::mt19937 rng(count);
+		std::uniform_real_distribution<float> position(-40.f, 40.f), range(1.f, 6.f), unit(-1.f, 1.f);
+
+		std::vector<Engine::Light> lights;
+		for (uint32_t i = 0; i < count; i++) {
+			glm::vec3 p = { position(rng), position(rng) * 0.25f, position(rng) };
+			if (i % 4 == 0) lights.push_back(Engine::Light::spot(p, { unit(rng), -1.f, unit(rng) }, range(rng) * 2.f, 0.5f, glm::vec3(1.f)));
+			else lights.push_back(Engine::Light::point(p, range(rng), glm::vec3(1.f)));
+		}
+
+		Engine::LightClusters clusters;
+		clusters.bin(lights.data(), count, view, projection, 1); // Builds the cluster boxes outside the timing
+		Engine::MiliTimer timer;
+
+		timer.start();
+		for (uint32_t i = 0; i < runs; i++) clusters.bin(lights.data(), count, view, projection, 1);
+		float single = timer.getElapsedTime() * 1000.f / runs;
+
+		timer.reset();
+		for (uint32_t i = 0; i < runs; i++) clusters.bin(lights.data(), count, view, projection, threads);
+		float parallel = timer.getElapsedTime() * 1000.f / runs;
+
+		std::cout << "Light clusters, " << count << " lights (" << clusters.getLightIndices().size() << " assignments over " << clusters.getClusterCount() << " clusters)" << std::endl;
+		std::cout << "  1 thread:  " << single << " ms" << std::endl;
+		std::cout << "  " << threads << " threads: " << parallel << " ms (" << single / parallel << "x)" << std::endl;
+	}
+}
@@ -0,0 +1,70 @@
+/** \file occlusionBench.cpp */
+#include "benchmarks.h"
+#include "rendering/occlusionCuller.h"
+#include "core/timer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+void benchmarkOcclusion()
+{
+	const uint32_t wallCounts[] = { 4, 32, 256 };
+	const uint32_t boxCount = 10000;
+	const uint32_t runs = 50;
+
+	glm::mat4 projection = glm::perspective(glm::radians(60.f), 2.f, 0.1f, 200.f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.f, 2.f, 0.f), glm::vec3(0.f, 2.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+	uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+	// A unit quad in the xy plane, scaled and placed per wall
+	const float quad[4 * 3] = { -0.5f, -0.5f, 0.f, 0.5f, -0.5f, 0.f, 0.5f, 0.5f, 0.f, -0.5f, 0.5f, 0.f };
+	const uint32_t quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	for (uint32_t wallCount : wallCounts) {
+		std::mt19937 rng(wallCount);
+		std::uniform_real_distribution<float> x(-30.f, 30.f), wallZ(-20.f, -5.f), boxZ(-150.f, -25.f), size(2.f, 8.f), half(0.25f, 2.f);
+
+		std::vector<glm::mat4> walls;
+		for (uint32_t i = 0; i < wallCount; i++) {
+			float s = size(rng);
+			glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3(x(rng), s * 0.5f, wallZ(rng)));
+			walls.push_back(glm::scale(model, glm::vec3(s * 1.5f, s, 1.f)));
+		}
+
+		std::vector<Engine::AABB> boxes(boxCount);
+		for (Engine::AABB& box : boxes) {
+			glm::vec3 centre = { x(rng) * 3.f, half(rng), boxZ(rng) };
+			glm::vec3 extent = glm::vec3(half(rng));
+			box = { centre - extent, centre + extent };
+		}
+		std::vector<uint8_t> visible(boxCount);
+
+		Engine::OcclusionCuller culler;
+		auto rasterize = [&](uint32_t threadCount) {
+			culler.begin(projection * view);
+			for (const glm::mat4& model : walls) culler.addOccluder(quad, 4, sizeof(float) * 3, 0, quadIndices, 6, model);
+			culler.rasterize(threadCount);
+		};
+		Engine::MiliTimer timer;
+
+		timer.start();
+		for (uint32_t i = 0; i < runs; i++) rasterize(1);
+		float single = timer.getElapsedTime() * 1000.f / runs;
+
+		timer.reset();
+		for (uint32_t i = 0; i < runs; i++) rasterize(threads);
+		float parallel = timer.getElapsedTime() * 1000.f / runs;
+
+		timer.reset();
+		uint32_t visibleCount = culler.testVisibility(boxes.data(), boxCount, visible.data());
+		float test = timer.getElapsedTime() * 1000.f;
+
+		std::cout << "Occlusion culling, " << wallCount << " walls into " << culler.getWidth() << "x" << culler.getHeight() << std::endl;
+		std::cout << "  Rasterize, 1 thread:  " << single << " ms" << std::endl;
+		std::cout << "  Rasterize, " << threads << " threads: " << parallel << " ms (" << single / parallel << "x)" << std::endl;
+		std::cout << "  Test " << boxCount << " boxes: " << test << " ms, " << boxCount - visibleCount << " culled (" << 100.f * (boxCount - visibleCount) / boxCount << "%)" << std::endl;
+	}
+}
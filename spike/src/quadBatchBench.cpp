@@ -0,0 +1,40 @@
+/** \file quadBatchBench.cpp */
+#include "benchmarks.h"
+#include "rendering/Renderer2D.h"
+#include "rendering/quadBatch.h"
+#include "core/timer.h"
+
+#include <iostream>
+#include <vector>
+
+void benchmarkQuadBatch()
+{
+	const uint32_t quadCount = 50000;
+	const uint32_t runs = 100;
+
+	std::vector<Engine::QuadInstance> quads(quadCount);
+	std::vector<uint32_t> texUnits(quadCount);
+	std::vector<glm::vec4> uvRects(quadCount, glm::vec4(0.f, 0.f, 1.f, 1.f));
+	std::vector<Engine::Renderer2DVertex> vertices(quadCount * 4);
+
+	for (uint32_t i = 0; i < quadCount; i++) {
+		quads[i].translate = { static_cast<float>(i % 1024), static_cast<float>(i / 1024) };
+		quads[i].scale = { 8.f, 8.f };
+		quads[i].setRotation(static_cast<float>(i) * 0.01f);
+		texUnits[i] = i % 32;
+	}
+
+	Engine::MiliTimer timer;
+
+	timer.start();
+	for (uint32_t i = 0; i < runs; i++) Engine::QuadBatch::writeVerticesScalar(quads.data(), texUnits.data(), uvRects.data(), quadCount, vertices.data());
+	float scalar = timer.getElapsedTime() * 1000.f / runs;
+
+	timer.reset();
+	for (uint32_t i = 0; i < runs; i++) Engine::QuadBatch::writeVertices(quads.data(), texUnits.data(), uvRects.data(), quadCount, vertices.data());
+	float simd = timer.getElapsedTime() * 1000.f / runs;
+
+	std::cout << "Quad batch, " << quadCount << " quads" << std::endl;
+	std::cout << "  scalar: " << scalar << " ms" << std::endl;
+	std::cout << "  SIMD:   " << simd << " ms (" << scalar / simd << "x)" << std::endl;
+}
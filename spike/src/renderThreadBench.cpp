@@ -0,0 +1,97 @@
+/** \file renderThreadBench.cpp */
+#include "benchmarks.h"
+#include "rendering/renderThread.h"
+#include "rendering/culling.h"
+#include "rendering/radixSort.h"
+#include "rendering/transformBatch.h"
+#include "rendering/lightClusters.h"
+#include "core/timer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <random>
+#include <vector>
+
+void benchmarkRenderThread()
+{
+	const uint32_t objectCounts[] = { 2000, 10000, 40000 };
+	const uint32_t lightCount = 256;
+	const uint32_t submitCost = 64; // Simulated driver work per draw, there is no context here
+	const uint32_t frames = 100;
+
+	glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 200.f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.f, 5.f, 20.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+	Engine::Frustum frustum = Engine::Culling::extractFrustum(projection * view);
+
+	for (uint32_t objectCount : objectCounts) {
+		std::mt19937 rng(objectCount);
+		std::uniform_real_distribution<float> position(-60.f, 60.f), range(1.f, 6.f);
+
+		std::vector<glm::mat4> models(objectCount);
+		for (glm::mat4& model : models) model = glm::translate(glm::mat4(1.f), glm::vec3(position(rng), position(rng) * 0.1f, position(rng)));
+		std::vector<Engine::Light> lights;
+		for (uint32_t i = 0; i < lightCount; i++) lights.push_back(Engine::Light::point({ position(rng), 1.f, position(rng) }, range(rng), glm::vec3(1.f)));
+
+		std::vector<glm::vec4> spheres(objectCount);
+		std::vector<uint8_t> visible(objectCount);
+		std::vector<Engine::SortEntry> entries, scratch;
+		std::vector<Engine::ObjectTransform> transforms;
+		Engine::LightClusters clusters;
+		uint64_t sink = 0;
+
+		// What Renderer3D::end does on the game thread, then the draw loop the render thread is left with
+		auto recordFrame = [&](Engine::FramePacket& packet, float time) {
+			for (glm::mat4& model : models) model = glm::rotate(model, time, glm::vec3(0.f, 1.f, 0.f));
+			for (uint32_t i = 0; i < objectCount; i++) spheres[i] = Engine::Culling::transformSphere({ 0.f, 0.f, 0.f, 0.87f }, models[i]);
+			Engine::Culling::cullSpheres(frustum, spheres.data(), objectCount, visible.data());
+
+			entries.clear();
+			for (uint32_t i = 0; i < objectCount; i++) {
+				if (visible[i]) entries.push_back({ static_cast<uint64_t>(-(view * models[i][3]).z * 1000.f), i });
+			}
+			uint32_t count = static_cast<uint32_t>(entries.size());
+			scratch.resize(count);
+			Engine::radixSort(entries.data(), scratch.data(), count);
+
+			transforms.resize(count);
+			for (uint32_t i = 0; i < count; i++) transforms[i].model = models[entries[i].index];
+			Engine::TransformBatch::writeNormalMatrices(transforms.data(), count);
+			clusters.bin(lights.data(), lightCount, view, projection, 1);
+
+			const Engine::ObjectTransform* frameTransforms = packet.snapshot(transforms.data(), count);
+			packet.enqueue([&sink, frameTransforms, count, submitCost]() {
+				for (uint32_t i = 0; i < count; i++) {
+					const float* values = &frameTransforms[i].model[0][0];
+					uint64_t hash = i;
+					for (uint32_t n = 0; n < submitCost; n++) hash = hash * 31 + static_cast<uint64_t>(values[n & 15] * 1000.f);
+					sink += hash;
+				}
+			});
+		};
+
+		auto run = [&](bool threaded) {
+			Engine::RenderThread renderThread;
+			if (threaded) renderThread.start();
+
+			Engine::MiliTimer timer;
+			timer.start();
+			for (uint32_t frame = 0; frame < frames; frame++) {
+				recordFrame(renderThread.getPacket(), 0.001f);
+				renderThread.submitFrame();
+			}
+			renderThread.finish();
+			float elapsed = timer.getElapsedTime() * 1000.f / frames;
+
+			renderThread.stop();
+			return elapsed;
+		};
+
+		float inlineTime = run(false);
+		float threadedTime = run(true);
+
+		std::cout << "Render thread, " << objectCount << " objects, " << lightCount << " lights" << std::endl;
+		std::cout << "  Record and execute inline: " << inlineTime << " ms per frame" << std::endl;
+		std::cout << "  Execute on render thread:  " << threadedTime << " ms per frame (" << inlineTime / threadedTime << "x)" << std::endl;
+		std::cout << "  Checksum " << sink << std::endl;
+	}
+}